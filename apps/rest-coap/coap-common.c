@@ -52,6 +52,11 @@ void init_packet(coap_packet_t* packet)
   packet->query_len = 0;
   packet->payload = NULL;
   packet->payload_len = 0;
+  packet->port = 0;
+  packet->block_offset = 0;
+  packet->block_size = 0;
+  packet->block_more = 0;
+  packet->block = 0;
 }
 
 int serialize_packet(coap_packet_t* packet, uint8_t* buffer)
@@ -101,7 +106,7 @@ int serialize_packet(coap_packet_t* packet, uint8_t* buffer)
 
     memcpy((char*)&buffer[index], option->value, option->len);
     index += option->len;
-    option_delta += option->option;
+    option_delta = option->option;
   }
 
   if(packet->payload){
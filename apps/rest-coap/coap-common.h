@@ -88,6 +88,9 @@ typedef enum {
 
 #define REQUEST_BUFFER_SIZE 200
 
+/*largest encoded message sent by the server*/
+#define MAX_PAYLOAD_LEN 120
+
 #define DEFAULT_CONTENT_TYPE 0
 #define DEFAULT_MAX_AGE 60
 #define DEFAULT_URI_AUTHORITY ""
@@ -126,6 +129,11 @@ typedef struct
   uint16_t payload_len;
   uint8_t* payload;
   uip_ipaddr_t addr;
+  uint16_t port;
+  uint32_t block_offset; //offset of the payload in the whole representation
+  uint16_t block_size;
+  uint8_t block_more; //more blocks follow
+  uint8_t block; //the packet carries a block option
 } coap_packet_t;
 
 /*error definitions*/
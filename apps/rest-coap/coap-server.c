@@ -7,6 +7,7 @@
 
 #include "buffer.h"
 #include "coap-server.h"
+#include "coap-transactions.h"
 #include "rest-util.h"
 #include "rest.h" /*added for periodic_resource*/
 
@@ -28,15 +29,69 @@
 #define PRINTLLADDR(addr)
 #endif
 
-#define MAX_PAYLOAD_LEN 120
 #define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
 static struct uip_udp_conn *server_conn;
 
 static uint16_t current_tid;
 
+MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
+
+/*
+ * A notification is serialized once and then sent to the observers of
+ * the resource one datagram per COAP_NOTIFY_INTERVAL, patching in the
+ * remaining lifetime of each subscription. Each copy is a confirmable
+ * transaction, so at most COAP_MAX_TRANSACTIONS are unacknowledged.
+ */
+struct notification_t {
+  periodic_resource_t* resource; /*NULL if the slot is free*/
+  coap_observer_t* next_observer; /*next observer to send to*/
+  uint16_t seq;
+  uint16_t tid;
+  uint16_t len;
+  uint16_t lifetime_offset; /*offset of the 4 byte lifetime value in buf*/
+  uint8_t buf[MAX_PAYLOAD_LEN];
+};
+static struct notification_t notifications[COAP_NOTIFY_QUEUE];
+
+/*
+ * An upload in progress. Downloads need no state since every request
+ * names the block it wants.
+ */
+struct block_transfer_t {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint32_t next_offset;
+  struct timer timeout; /*slot is free once expired*/
+};
+static struct block_transfer_t transfers[COAP_BLOCK_TRANSFERS];
+static uint8_t next_notification;
+static struct uip_udp_conn *notify_conn;
+static struct etimer notify_timer;
+
 static service_callback service_cbk = NULL;
 
+/*Returns the buffer that holds the packets of one request or NULL.*/
+static uint8_t*
+open_buffer(void)
+{
+#if COAP_ZERO_COPY
+  /*allocated once and then reused*/
+  uint8_t* buffer = reset_buffer();
+  return buffer ? buffer : init_buffer(COAP_DATA_BUFF_SIZE);
+#else /*COAP_ZERO_COPY*/
+  return init_buffer(COAP_DATA_BUFF_SIZE);
+#endif /*COAP_ZERO_COPY*/
+}
+
+static void
+close_buffer(void)
+{
+#if !COAP_ZERO_COPY
+  delete_buffer();
+#endif /*!COAP_ZERO_COPY*/
+}
+
 void
 coap_set_service_callback(service_callback callback)
 {
@@ -122,7 +177,7 @@ parse_message(coap_packet_t* packet, uint8_t* buf, uint16_t size)
 
   /*If query is not already provided via Uri_Query option then check URL*/
   if (packet->url && !packet->query) {
-    if ((packet->query = strchr(packet->url, '?'))) {
+    if ((packet->query = memchr(packet->url, '?', packet->url_len))) {
       uint16_t total_url_len = packet->url_len;
       /*set query len and update url len so that it does not include query part now*/
       packet->url_len = packet->query - packet->url;
@@ -385,6 +440,22 @@ coap_set_code(coap_packet_t* packet, status_code_t code)
   packet->code = (uint8_t)code;
 }
 
+int
+coap_get_block(coap_packet_t* request, uint32_t* offset, uint16_t* size, uint8_t* more)
+{
+  *offset = request->block_offset;
+  *size = request->block_size;
+  *more = request->block_more;
+  return 1;
+}
+
+void
+coap_set_block_more(coap_packet_t* response, uint8_t more)
+{
+  response->block = 1;
+  response->block_more = more;
+}
+
 coap_method_t
 coap_get_method(coap_packet_t* packet)
 {
@@ -397,28 +468,168 @@ coap_set_method(coap_packet_t* packet, coap_method_t method)
   packet->code = (uint8_t)method;
 }
 
-static void send_request(coap_packet_t* request, struct uip_udp_conn *client_conn)
+static struct block_transfer_t*
+find_transfer(coap_packet_t* request, int create)
 {
-  char buf[MAX_PAYLOAD_LEN];
-  int data_size = 0;
+  struct block_transfer_t* transfer;
+  struct block_transfer_t* free_transfer = NULL;
+  int i;
+
+  for (i = 0; i < COAP_BLOCK_TRANSFERS; i++) {
+    transfer = &transfers[i];
+    if (timer_expired(&transfer->timeout)) {
+      free_transfer = transfer;
+    } else if (transfer->port == request->port && uip_ipaddr_cmp(&transfer->addr, &request->addr)) {
+      return transfer;
+    }
+  }
 
-  data_size = serialize_packet(request, buf);
+  if (create && free_transfer) {
+    uip_ipaddr_copy(&free_transfer->addr, &request->addr);
+    free_transfer->port = request->port;
+    return free_transfer;
+  }
+  return NULL;
+}
 
-  PRINTF("Created a connection with the server ");
-  PRINT6ADDR(&client_conn->ripaddr);
-  PRINTF(" local/remote port %u/%u\n",
-      uip_htons(client_conn->lport), uip_htons(client_conn->rport));
+/*
+ * Decodes the block option of a request. Returns 0 if the request is an
+ * upload block that does not continue a transfer of the peer.
+ */
+static int
+start_block(coap_packet_t* request)
+{
+  struct block_transfer_t* transfer;
+  block_option_t block;
+  uint16_t size;
+
+  request->block_size = COAP_MAX_BLOCK_SIZE;
+  if (!coap_get_header_block(request, &block)) {
+    return 1;
+  }
+
+  size = 16 << block.size;
+  request->block = 1;
+  request->block_offset = block.number * size;
+  request->block_more = block.more;
 
-  PRINTF("Sending to: ");
-  PRINT6ADDR(&client_conn->ripaddr);
-  uip_udp_packet_send(client_conn, buf, data_size);
+  if (!request->payload) {
+    /*download, serve at most our block size*/
+    if (size < request->block_size) {
+      request->block_size = size;
+    }
+    return 1;
+  }
+
+  /*upload, blocks must arrive in order*/
+  request->block_size = size;
+  transfer = find_transfer(request, request->block_offset == 0);
+  if (!transfer || (request->block_offset && request->block_offset != transfer->next_offset)) {
+    PRINTF("Unexpected block %lu\n", request->block_offset);
+    return 0;
+  }
+  if (block.more) {
+    transfer->next_offset = request->block_offset + size;
+    timer_set(&transfer->timeout, COAP_BLOCK_TIMEOUT);
+  } else {
+    /*last block, free the slot*/
+    timer_set(&transfer->timeout, 0);
+  }
+  return 1;
 }
 
+/*Returns whether the response goes out in one datagram as it is.*/
 static int
-handle_incoming_data(void)
+fits_packet(coap_packet_t* response)
+{
+  header_option_t* option;
+  uint16_t len = 4 + response->payload_len;
+
+  for (option = response->options; option; option = option->next) {
+    len += (option->len < 0xF ? 1 : 2) + option->len;
+  }
+  return len <= MAX_PAYLOAD_LEN;
+}
+
+/*
+ * Adds the block option to a successful response and cuts a whole
+ * representation set by the handler down to the requested block. A
+ * whole representation is only cut without a Block option in the
+ * request if it does not fit the datagram.
+ */
+static void
+finish_block(coap_packet_t* request, coap_packet_t* response)
+{
+  uint16_t size = request->block_size;
+  uint8_t more;
+
+  if (response->code >= BAD_REQUEST_400) {
+    return;
+  }
+
+  if (request->block && request->payload) {
+    /*acknowledge the upload block*/
+    more = request->block_more;
+  } else if (response->block) {
+    /*streaming handler produced the block itself*/
+    if (response->payload_len > size) {
+      response->payload_len = size;
+    }
+    more = response->block_more;
+  } else if (request->block ? request->block_offset || response->payload_len > size :
+             !fits_packet(response)) {
+    if (request->block_offset >= response->payload_len) {
+      coap_set_code(response, BAD_REQUEST_400);
+      response->payload = NULL;
+      response->payload_len = 0;
+      return;
+    }
+    response->payload += request->block_offset;
+    response->payload_len -= request->block_offset;
+    more = response->payload_len > size;
+    if (more) {
+      response->payload_len = size;
+    }
+  } else if (request->block) {
+    more = 0;
+  } else {
+    return;
+  }
+
+  if (!coap_set_header_block(response, request->block_offset / size, more, size)) {
+    /*without the option the client would take the block for the whole*/
+    coap_set_code(response, INTERNAL_SERVER_ERROR_500);
+    response->payload = NULL;
+    response->payload_len = 0;
+  }
+}
+
+/*Answers from the connection the request came in on, so from the port it was sent to.*/
+static void
+send_response(struct uip_udp_conn* conn, uint8_t* buf, uint16_t len, uip_ipaddr_t* addr, u16_t port)
+{
+  uip_ipaddr_copy(&conn->ripaddr, addr);
+  conn->rport = port;
+
+  PRINTF("Responding with message size: %d\n",len);
+  uip_udp_packet_send(conn, buf, len);
+  /* Restore the connection to allow data from any node */
+  memset(&conn->ripaddr, 0, sizeof(conn->ripaddr));
+  conn->rport = 0;
+}
+
+/*Serializes the response into buf, the headers of the request may be overwritten.*/
+static int
+handle_request(uint8_t* buf)
 {
   int error=NO_ERROR;
-  char buf[MAX_PAYLOAD_LEN];
+  uint8_t type;
+  uint16_t tid;
+  uint8_t* cached;
+  uint16_t cached_len;
+  uip_ipaddr_t addr;
+  u16_t port;
+  struct uip_udp_conn* conn = uip_udp_conn;
 
   PRINTF("uip_datalen received %u \n",(u16_t)uip_datalen());
 
@@ -428,29 +639,67 @@ handle_incoming_data(void)
   int data_size = 0;
 
   if (uip_newdata()) {
+#if !COAP_ZERO_COPY
     ((char *)data)[datalen] = 0;
-    PRINTF("Server received: '%s' (port:%u) from ", (char *)data, uip_htons(UIP_UDP_BUF->srcport));
+#endif /*!COAP_ZERO_COPY*/
+    PRINTF("Server received %u bytes (port:%u) from ", datalen, uip_htons(UIP_UDP_BUF->srcport));
     PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
     PRINTF("\n");
 
-    if (init_buffer(COAP_DATA_BUFF_SIZE)) {
+    uip_ipaddr_copy(&addr, &UIP_IP_BUF->srcipaddr);
+    port = UIP_UDP_BUF->srcport;
+
+    if (datalen < 4) {
+      return error;
+    }
+    type = (data[0] & COAP_HEADER_TYPE_MASK) >> COAP_HEADER_TYPE_POSITION;
+    tid = ((uint8_t)data[2] << 8) + (uint8_t)data[3];
+
+    if (type == MESSAGE_TYPE_ACK || type == MESSAGE_TYPE_RST) {
+      coap_handle_ack(tid, &addr, port, type == MESSAGE_TYPE_RST);
+      return error;
+    }
+
+    /*the notification port has no remote address set, it only takes
+      the replies of the observers*/
+    if (conn == notify_conn) {
+      PRINTF("Request to the notification port dropped\n");
+      return error;
+    }
+
+    /*a retransmitted request gets the response it got before*/
+    if (type == MESSAGE_TYPE_CON &&
+        (cached = coap_find_response(tid, &addr, port, &cached_len))) {
+      PRINTF("Duplicate request %u\n", tid);
+      send_response(conn, cached, cached_len, &addr, port);
+      return error;
+    }
+
+    if (open_buffer()) {
       coap_packet_t* request = (coap_packet_t*)allocate_buffer(sizeof(coap_packet_t));
       parse_message(request, (uint8_t*)data, datalen);
 
-      uip_ipaddr_copy(&request->addr, &UIP_IP_BUF->srcipaddr);
+      uip_ipaddr_copy(&request->addr, &addr);
+      request->port = port;
 
       if (request->type != MESSAGE_TYPE_ACK) {
         coap_packet_t* response = (coap_packet_t*)allocate_buffer(sizeof(coap_packet_t));
         init_response(request, response);
 
-        if (service_cbk) {
+        if (!start_block(request)) {
+          coap_set_code(response, BAD_REQUEST_400);
+        } else if (service_cbk) {
           service_cbk(request, response);
+          finish_block(request, response);
         }
 
         data_size = serialize_packet(response, buf);
 
+        if (type == MESSAGE_TYPE_CON) {
+          coap_cache_response(tid, &request->addr, request->port, buf, data_size);
+        }
       }
-      delete_buffer();
+      close_buffer();
     } else {
       PRINTF("Memory Alloc Error\n");
       error = MEMORY_ALLOC_ERR;
@@ -460,19 +709,28 @@ handle_incoming_data(void)
       data_size = serialize_packet(&error_packet, buf);
     }
 
-    uip_ipaddr_copy(&server_conn->ripaddr, &UIP_IP_BUF->srcipaddr);
-    server_conn->rport = UIP_UDP_BUF->srcport;
-
-    PRINTF("Responding with message size: %d\n",data_size);
-    uip_udp_packet_send(server_conn, buf, data_size);
-    /* Restore server connection to allow data from any node */
-    memset(&server_conn->ripaddr, 0, sizeof(server_conn->ripaddr));
-    server_conn->rport = 0;
+    send_response(conn, buf, data_size, &addr, port);
   }
 
   return error;
 }
 
+static int
+handle_incoming_data(void)
+{
+#if COAP_ZERO_COPY
+  if (uip_ext_len == 0) {
+    /*the response is serialized where uip_udp_packet_send() expects it*/
+    return handle_request(&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN]);
+  }
+#endif /*COAP_ZERO_COPY*/
+  {
+    /*IPv6 extension headers lie in front of the request, so the response is copied*/
+    uint8_t buf[MAX_PAYLOAD_LEN];
+    return handle_request(buf);
+  }
+}
+
 process_event_t resource_changed_event;
 
 void
@@ -481,6 +739,252 @@ resource_changed(struct periodic_resource_t* resource)
   process_post(&coap_server, resource_changed_event, (process_data_t)resource);
 }
 
+static void
+remove_observer(periodic_resource_t* resource, coap_observer_t* prev, coap_observer_t* observer)
+{
+  int i;
+
+  if (prev) {
+    prev->next = observer->next;
+  } else {
+    resource->observers = observer->next;
+  }
+
+  /*queued notifications must not point to it anymore*/
+  for (i = 0; i < COAP_NOTIFY_QUEUE; i++) {
+    if (notifications[i].next_observer == observer) {
+      notifications[i].next_observer = observer->next;
+    }
+  }
+
+  memb_free(&observers_memb, observer);
+}
+
+int
+coap_add_observer(struct periodic_resource_t* resource, uip_ipaddr_t* addr, uint32_t lifetime)
+{
+  periodic_resource_t* periodic;
+  coap_observer_t* observer;
+  coap_observer_t* prev = NULL;
+
+  for (observer = resource->observers; observer; prev = observer, observer = observer->next) {
+    if (uip_ipaddr_cmp(&observer->addr, addr)) {
+      break;
+    }
+  }
+
+  if (lifetime == 0) {
+    if (observer) {
+      remove_observer(resource, prev, observer);
+    }
+    return 1;
+  }
+
+  if (!observer) {
+    observer = (coap_observer_t*)memb_alloc(&observers_memb);
+    if (!observer) {
+      /*the pool is shared, expired observers of any resource make room*/
+      for (periodic = (periodic_resource_t*)list_head(rest_get_periodic_resources()); periodic; periodic = periodic->next) {
+        coap_count_observers(periodic);
+      }
+      observer = (coap_observer_t*)memb_alloc(&observers_memb);
+    }
+    if (!observer) {
+      PRINTF("No room for another observer\n");
+      return 0;
+    }
+    uip_ipaddr_copy(&observer->addr, addr);
+    /*it starts with the next notification*/
+    observer->seq = resource->seq;
+    observer->next = resource->observers;
+    resource->observers = observer;
+  }
+  stimer_set(&observer->lifetime, (clock_time_t)lifetime);
+
+  return 1;
+}
+
+int
+coap_count_observers(struct periodic_resource_t* resource)
+{
+  coap_observer_t* observer = resource->observers;
+  coap_observer_t* prev = NULL;
+  coap_observer_t* next;
+  int count = 0;
+
+  while (observer) {
+    next = observer->next;
+    if (stimer_expired(&observer->lifetime)) {
+      remove_observer(resource, prev, observer);
+    } else {
+      prev = observer;
+      count++;
+    }
+    observer = next;
+  }
+
+  return count;
+}
+
+/*Returns the offset of the value of option type in an encoded message or 0.*/
+static uint16_t
+find_option(uint8_t* buf, uint16_t size, option_type type)
+{
+  uint8_t count = buf[0] & COAP_HEADER_OPTION_COUNT_MASK;
+  uint16_t index = 4;
+  uint16_t option = 0;
+  uint16_t len;
+
+  while (count-- && index < size) {
+    option += (buf[index] & COAP_HEADER_OPTION_DELTA_MASK) >> COAP_HEADER_OPTION_DELTA_POSITION;
+    len = buf[index] & COAP_HEADER_OPTION_SHORT_LENGTH_MASK;
+    index++;
+    if (len == 0xf) {
+      len += buf[index];
+      index++;
+    }
+    if (option == type) {
+      return index;
+    }
+    index += len;
+  }
+
+  return 0;
+}
+
+static void
+queue_notification(periodic_resource_t* resource)
+{
+  struct notification_t* notification = NULL;
+  uint8_t lifetime[4] = {0, 0, 0, 0};
+  int i;
+
+  /*a newer state replaces the one still being sent*/
+  for (i = 0; i < COAP_NOTIFY_QUEUE; i++) {
+    if (notifications[i].resource == resource) {
+      notification = &notifications[i];
+      break;
+    }
+    if (!notification && !notifications[i].resource) {
+      notification = &notifications[i];
+    }
+  }
+  if (!notification) {
+    PRINTF("Notification queue full\n");
+    return;
+  }
+
+  if (open_buffer()) {
+    coap_packet_t* request = (coap_packet_t*)allocate_buffer(sizeof(coap_packet_t));
+    init_packet(request);
+    coap_set_code(request, COAP_GET);
+    request->tid = notification->tid = current_tid++;
+    /*fixed size so that each observer's lifetime can be written in place*/
+    coap_set_option(request, Option_Type_Subscription_Lifetime, sizeof(lifetime), lifetime);
+    coap_set_header_uri(request, (char *)resource->resource->url);
+    if (resource->periodic_request_generator) {
+      resource->periodic_request_generator(request);
+    }
+
+    notification->len = serialize_packet(request, notification->buf);
+    notification->lifetime_offset = find_option(notification->buf, notification->len, Option_Type_Subscription_Lifetime);
+    notification->seq = ++resource->seq;
+    notification->next_observer = resource->observers;
+    notification->resource = resource;
+
+    close_buffer();
+
+    if (etimer_expired(&notify_timer)) {
+      etimer_set(&notify_timer, COAP_NOTIFY_INTERVAL);
+    }
+  } else {
+    notification->resource = NULL;
+  }
+}
+
+/*An observer that does not acknowledge its notification is dropped.*/
+static void
+notification_done(coap_transaction_t* transaction, int acked)
+{
+  periodic_resource_t* resource = (periodic_resource_t*)transaction->data;
+  coap_observer_t* observer;
+  coap_observer_t* prev = NULL;
+
+  if (acked) {
+    return;
+  }
+
+  for (observer = resource->observers; observer; prev = observer, observer = observer->next) {
+    if (uip_ipaddr_cmp(&observer->addr, &transaction->addr)) {
+      PRINTF("Observer gone\n");
+      remove_observer(resource, prev, observer);
+      break;
+    }
+  }
+}
+
+/*
+ * Sends the next pending notification as a confirmable message. Returns
+ * 0 if none is left, or 1 if more are pending or all transactions are in
+ * flight.
+ */
+static int
+send_notification(void)
+{
+  struct notification_t* notification;
+  coap_observer_t* observer;
+  coap_transaction_t* transaction;
+  uint8_t slot;
+  int i;
+
+  for (i = 0; i < COAP_NOTIFY_QUEUE; i++) {
+    slot = (next_notification + i) % COAP_NOTIFY_QUEUE;
+    notification = &notifications[slot];
+    if (!notification->resource) {
+      continue;
+    }
+
+    while ((observer = notification->next_observer) &&
+           (observer->seq == notification->seq || stimer_expired(&observer->lifetime))) {
+      notification->next_observer = observer->next;
+    }
+
+    if (!observer) {
+      notification->resource = NULL;
+      continue;
+    }
+
+    transaction = coap_new_transaction(notify_conn, notification->tid, &observer->addr, uip_htons(MOTE_SERVER_LISTEN_PORT));
+    if (!transaction) {
+      /*wait for an acknowledgement*/
+      return 1;
+    }
+    notification->next_observer = observer->next;
+    observer->seq = notification->seq;
+
+    memcpy(transaction->buf, notification->buf, notification->len);
+    transaction->len = notification->len;
+    if (notification->lifetime_offset) {
+      write_int(transaction->buf + notification->lifetime_offset, stimer_remaining(&observer->lifetime), 4);
+    }
+    transaction->callback = notification_done;
+    transaction->data = notification->resource;
+
+    PRINTF("Notifying ");
+    PRINT6ADDR(&observer->addr);
+    PRINTF(" seq %u\n", notification->seq);
+    coap_send_transaction(transaction);
+
+    if (!notification->next_observer) {
+      notification->resource = NULL;
+    }
+    /*round robin between resources*/
+    next_notification = (slot + 1) % COAP_NOTIFY_QUEUE;
+    return 1;
+  }
+
+  return 0;
+}
 
 /*---------------------------------------------------------------------------*/
 
@@ -505,38 +1009,25 @@ PROCESS_THREAD(coap_server, ev, data)
   udp_bind(server_conn, uip_htons(MOTE_SERVER_LISTEN_PORT));
   PRINTF("Local/remote port %u/%u\n", uip_htons(server_conn->lport), uip_htons(server_conn->rport));
 
+  /*notifications are sent to the server port of the observers*/
+  memb_init(&observers_memb);
+  notify_conn = udp_new(NULL, uip_htons(0), NULL);
+  udp_bind(notify_conn, uip_htons(MOTE_CLIENT_LISTEN_PORT));
+
   while(1) {
     PROCESS_YIELD();
 
     if(ev == tcpip_event) {
       handle_incoming_data();
     } else if (ev == resource_changed_event) {
-      periodic_resource_t* resource = (periodic_resource_t*)data;
       PRINTF("resource_changed_event \n");
-
-      if (init_buffer(COAP_DATA_BUFF_SIZE)) {
-        coap_packet_t* request = (coap_packet_t*)allocate_buffer(sizeof(coap_packet_t));
-        init_packet(request);
-        coap_set_code(request, COAP_GET);
-        request->tid = current_tid++;
-        coap_set_header_subscription_lifetime(request, resource->lifetime);
-        coap_set_header_uri(request, (char *)resource->resource->url);
-        if (resource->periodic_request_generator) {
-          resource->periodic_request_generator(request);
-        }
-
-        if (!resource->client_conn) {
-          /*FIXME send port is fixed for now to 61616*/
-          resource->client_conn = udp_new(&resource->addr, uip_htons(61616), NULL);
-          udp_bind(resource->client_conn, uip_htons(MOTE_CLIENT_LISTEN_PORT));
-        }
-
-        if (resource->client_conn) {
-          send_request(request, resource->client_conn);
-        }
-
-        delete_buffer();
+      queue_notification((periodic_resource_t*)data);
+    } else if (ev == PROCESS_EVENT_TIMER && data == &notify_timer) {
+      if (send_notification()) {
+        etimer_reset(&notify_timer);
       }
+    } else if (ev == PROCESS_EVENT_TIMER) {
+      coap_check_transactions();
     }
   }
 
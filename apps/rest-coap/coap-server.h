@@ -6,6 +6,69 @@
 #include "contiki.h"
 #include "coap-common.h"
 
+/*
+ * Parse requests in place and write responses directly into the outgoing
+ * packet, with one buffer for all requests instead of one per request.
+ */
+#ifdef COAP_CONF_ZERO_COPY
+#define COAP_ZERO_COPY COAP_CONF_ZERO_COPY
+#else /*COAP_CONF_ZERO_COPY*/
+#define COAP_ZERO_COPY 1
+#endif /*COAP_CONF_ZERO_COPY*/
+
+/*Number of subscriptions over all periodic resources*/
+#ifdef COAP_CONF_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS COAP_CONF_MAX_OBSERVERS
+#else /*COAP_CONF_MAX_OBSERVERS*/
+#define COAP_MAX_OBSERVERS 8
+#endif /*COAP_CONF_MAX_OBSERVERS*/
+
+/*Number of encoded notifications waiting to be sent to their observers*/
+#ifdef COAP_CONF_NOTIFY_QUEUE
+#define COAP_NOTIFY_QUEUE COAP_CONF_NOTIFY_QUEUE
+#else /*COAP_CONF_NOTIFY_QUEUE*/
+#define COAP_NOTIFY_QUEUE 2
+#endif /*COAP_CONF_NOTIFY_QUEUE*/
+
+/*Time between two notification datagrams*/
+#ifdef COAP_CONF_NOTIFY_INTERVAL
+#define COAP_NOTIFY_INTERVAL COAP_CONF_NOTIFY_INTERVAL
+#else /*COAP_CONF_NOTIFY_INTERVAL*/
+#define COAP_NOTIFY_INTERVAL (CLOCK_SECOND / 16)
+#endif /*COAP_CONF_NOTIFY_INTERVAL*/
+
+/*Largest block of a block-wise transfer, 16 to 1024 in powers of two*/
+#ifdef COAP_CONF_MAX_BLOCK_SIZE
+#define COAP_MAX_BLOCK_SIZE COAP_CONF_MAX_BLOCK_SIZE
+#else /*COAP_CONF_MAX_BLOCK_SIZE*/
+#define COAP_MAX_BLOCK_SIZE 64
+#endif /*COAP_CONF_MAX_BLOCK_SIZE*/
+
+/*Number of block-wise uploads in progress at the same time*/
+#ifdef COAP_CONF_BLOCK_TRANSFERS
+#define COAP_BLOCK_TRANSFERS COAP_CONF_BLOCK_TRANSFERS
+#else /*COAP_CONF_BLOCK_TRANSFERS*/
+#define COAP_BLOCK_TRANSFERS 2
+#endif /*COAP_CONF_BLOCK_TRANSFERS*/
+
+/*Time after which an unfinished upload is abandoned*/
+#ifdef COAP_CONF_BLOCK_TIMEOUT
+#define COAP_BLOCK_TIMEOUT COAP_CONF_BLOCK_TIMEOUT
+#else /*COAP_CONF_BLOCK_TIMEOUT*/
+#define COAP_BLOCK_TIMEOUT (30 * CLOCK_SECOND)
+#endif /*COAP_CONF_BLOCK_TIMEOUT*/
+
+/*
+ * A client subscribed to a periodic resource.
+ */
+struct coap_observer_t {
+  struct coap_observer_t* next;
+  uip_ipaddr_t addr;
+  struct stimer lifetime;
+  uint16_t seq; /*sequence number of the last notification sent*/
+};
+typedef struct coap_observer_t coap_observer_t;
+
 /*Declare process*/
 PROCESS_NAME(coap_server);
 
@@ -26,6 +89,17 @@ int coap_set_header_subscription_lifetime(coap_packet_t* packet, uint32_t lifeti
 int coap_get_header_block(coap_packet_t* packet, block_option_t* block);
 int coap_set_header_block(coap_packet_t* packet, uint32_t number, uint8_t more, uint8_t size);
 
+/*
+ * Block-wise transfer seen by a resource handler. For a request with a
+ * payload, the payload is the block at offset and more is set if further
+ * blocks follow. Otherwise the handler may produce only the size bytes
+ * starting at offset and call coap_set_block_more() if the representation
+ * goes on. A handler that sets the whole representation instead gets it
+ * cut into blocks by the server.
+ */
+int coap_get_block(coap_packet_t* request, uint32_t* offset, uint16_t* size, uint8_t* more);
+void coap_set_block_more(coap_packet_t* response, uint8_t more);
+
 int coap_set_header_uri(coap_packet_t* packet, char* uri);
 int coap_set_header_etag(coap_packet_t* packet, uint8_t* etag, uint8_t size);
 
@@ -51,4 +125,15 @@ void coap_set_service_callback(service_callback callback);
 struct periodic_resource_t;
 void resource_changed(struct periodic_resource_t* resource);
 
+/*
+ * Subscribes addr to the resource for lifetime seconds, or cancels the
+ * subscription if lifetime is 0. Returns 0 if the observer table is full.
+ */
+int coap_add_observer(struct periodic_resource_t* resource, uip_ipaddr_t* addr, uint32_t lifetime);
+
+/*
+ * Removes expired subscriptions and returns the number of observers left.
+ */
+int coap_count_observers(struct periodic_resource_t* resource);
+
 #endif /* COAPSERVER_H_ */
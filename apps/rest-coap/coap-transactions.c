@@ -0,0 +1,192 @@
+/*
+ * coap-transactions.c
+ *
+ * Retransmission of outgoing CON messages and the cache of responses to
+ * incoming CON requests.
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "contiki-net.h"
+#include "lib/random.h"
+
+#include "coap-transactions.h"
+#include "coap-server.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+static coap_transaction_t transactions[COAP_MAX_TRANSACTIONS];
+
+struct cached_response_t {
+  uint16_t tid;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint16_t stamp; /*for least recently used replacement*/
+  struct timer lifetime; /*entry is unused once expired*/
+  uint16_t len;
+  uint8_t buf[MAX_PAYLOAD_LEN];
+};
+static struct cached_response_t responses[COAP_RESPONSE_CACHE];
+static uint16_t response_stamp;
+
+static void
+send_message(coap_transaction_t* transaction)
+{
+  struct uip_udp_conn* conn = transaction->conn;
+
+  uip_ipaddr_copy(&conn->ripaddr, &transaction->addr);
+  conn->rport = transaction->port;
+  uip_udp_packet_send(conn, transaction->buf, transaction->len);
+  /* Restore the connection to allow data from any node */
+  memset(&conn->ripaddr, 0, sizeof(conn->ripaddr));
+  conn->rport = 0;
+}
+
+coap_transaction_t*
+coap_new_transaction(struct uip_udp_conn* conn, uint16_t tid, uip_ipaddr_t* addr, uint16_t port)
+{
+  int i;
+
+  for (i = 0; i < COAP_MAX_TRANSACTIONS; i++) {
+    if (!transactions[i].conn) {
+      coap_transaction_t* transaction = &transactions[i];
+      transaction->conn = conn;
+      transaction->tid = tid;
+      uip_ipaddr_copy(&transaction->addr, addr);
+      transaction->port = port;
+      transaction->retransmissions = 0;
+      transaction->callback = NULL;
+      transaction->data = NULL;
+      transaction->len = 0;
+      return transaction;
+    }
+  }
+
+  return NULL;
+}
+
+void
+coap_send_transaction(coap_transaction_t* transaction)
+{
+  PRINTF("Sending transaction %u (%u)\n", transaction->tid, transaction->retransmissions);
+  send_message(transaction);
+
+  /*exponential back-off from a random initial timeout, drawn once*/
+  if (transaction->retransmissions == 0) {
+    transaction->timeout = COAP_RESPONSE_TIMEOUT + random_rand() % (COAP_RESPONSE_TIMEOUT / 2 + 1);
+  }
+
+  /*timer events go to the server process*/
+  PROCESS_CONTEXT_BEGIN(&coap_server);
+  etimer_set(&transaction->retransmit_timer, transaction->timeout << transaction->retransmissions);
+  PROCESS_CONTEXT_END(&coap_server);
+}
+
+void
+coap_clear_transaction(coap_transaction_t* transaction)
+{
+  etimer_stop(&transaction->retransmit_timer);
+  transaction->conn = NULL;
+}
+
+static void
+end_transaction(coap_transaction_t* transaction, int acked)
+{
+  coap_transaction_callback callback = transaction->callback;
+
+  coap_clear_transaction(transaction);
+  if (callback) {
+    callback(transaction, acked);
+  }
+}
+
+int
+coap_handle_ack(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, int reset)
+{
+  int i;
+
+  for (i = 0; i < COAP_MAX_TRANSACTIONS; i++) {
+    coap_transaction_t* transaction = &transactions[i];
+    if (transaction->conn && transaction->tid == tid &&
+        transaction->port == port && uip_ipaddr_cmp(&transaction->addr, addr)) {
+      PRINTF("Transaction %u %s\n", tid, reset ? "reset" : "acked");
+      end_transaction(transaction, !reset);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void
+coap_check_transactions(void)
+{
+  int i;
+
+  for (i = 0; i < COAP_MAX_TRANSACTIONS; i++) {
+    coap_transaction_t* transaction = &transactions[i];
+    if (transaction->conn && etimer_expired(&transaction->retransmit_timer)) {
+      if (transaction->retransmissions < COAP_MAX_RETRANSMIT) {
+        transaction->retransmissions++;
+        coap_send_transaction(transaction);
+      } else {
+        PRINTF("Transaction %u timed out\n", transaction->tid);
+        end_transaction(transaction, 0);
+      }
+    }
+  }
+}
+
+uint8_t*
+coap_find_response(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, uint16_t* len)
+{
+  int i;
+
+  for (i = 0; i < COAP_RESPONSE_CACHE; i++) {
+    struct cached_response_t* response = &responses[i];
+    if (!timer_expired(&response->lifetime) && response->tid == tid &&
+        response->port == port && uip_ipaddr_cmp(&response->addr, addr)) {
+      response->stamp = ++response_stamp;
+      *len = response->len;
+      return response->buf;
+    }
+  }
+
+  return NULL;
+}
+
+void
+coap_cache_response(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, uint8_t* buf, uint16_t len)
+{
+  struct cached_response_t* response = &responses[0];
+  int i;
+
+  if (len > MAX_PAYLOAD_LEN) {
+    return;
+  }
+
+  /*take an unused entry or else the least recently used one*/
+  for (i = 0; i < COAP_RESPONSE_CACHE; i++) {
+    if (timer_expired(&responses[i].lifetime)) {
+      response = &responses[i];
+      break;
+    }
+    if ((int16_t)(responses[i].stamp - response->stamp) < 0) {
+      response = &responses[i];
+    }
+  }
+
+  response->tid = tid;
+  uip_ipaddr_copy(&response->addr, addr);
+  response->port = port;
+  response->stamp = ++response_stamp;
+  timer_set(&response->lifetime, COAP_EXCHANGE_LIFETIME);
+  response->len = len;
+  memcpy(response->buf, buf, len);
+}
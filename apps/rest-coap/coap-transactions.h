@@ -0,0 +1,95 @@
+/*
+ * coap-transactions.h
+ *
+ * Confirmable exchanges: retransmission of outgoing CON messages until
+ * they are acknowledged, and a cache of the responses to incoming CON
+ * requests so that duplicates are answered without running the handler.
+ */
+
+#ifndef COAP_TRANSACTIONS_H_
+#define COAP_TRANSACTIONS_H_
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "coap-common.h"
+
+/*Number of outgoing CON messages waiting for their ACK*/
+#ifdef COAP_CONF_MAX_TRANSACTIONS
+#define COAP_MAX_TRANSACTIONS COAP_CONF_MAX_TRANSACTIONS
+#else /*COAP_CONF_MAX_TRANSACTIONS*/
+#define COAP_MAX_TRANSACTIONS 2
+#endif /*COAP_CONF_MAX_TRANSACTIONS*/
+
+/*Number of recent responses kept for duplicate requests*/
+#ifdef COAP_CONF_RESPONSE_CACHE
+#define COAP_RESPONSE_CACHE COAP_CONF_RESPONSE_CACHE
+#else /*COAP_CONF_RESPONSE_CACHE*/
+#define COAP_RESPONSE_CACHE 2
+#endif /*COAP_CONF_RESPONSE_CACHE*/
+
+/*Initial retransmission timeout, randomized up to 1.5 times*/
+#ifdef COAP_CONF_RESPONSE_TIMEOUT
+#define COAP_RESPONSE_TIMEOUT COAP_CONF_RESPONSE_TIMEOUT
+#else /*COAP_CONF_RESPONSE_TIMEOUT*/
+#define COAP_RESPONSE_TIMEOUT (2 * CLOCK_SECOND)
+#endif /*COAP_CONF_RESPONSE_TIMEOUT*/
+
+#ifdef COAP_CONF_MAX_RETRANSMIT
+#define COAP_MAX_RETRANSMIT COAP_CONF_MAX_RETRANSMIT
+#else /*COAP_CONF_MAX_RETRANSMIT*/
+#define COAP_MAX_RETRANSMIT 4
+#endif /*COAP_CONF_MAX_RETRANSMIT*/
+
+/*How long a peer may retransmit a request, bounds the response cache*/
+#define COAP_EXCHANGE_LIFETIME (COAP_RESPONSE_TIMEOUT * 3 / 2 * ((1 << COAP_MAX_RETRANSMIT) - 1))
+
+struct coap_transaction_t;
+
+/*Called once the message is acknowledged (acked 1) or given up (acked 0)*/
+typedef void (*coap_transaction_callback) (struct coap_transaction_t* transaction, int acked);
+
+struct coap_transaction_t {
+  uint16_t tid;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  struct uip_udp_conn* conn; /*NULL if unused*/
+  uint8_t retransmissions;
+  clock_time_t timeout; /*initial retransmission timeout*/
+  struct etimer retransmit_timer;
+  coap_transaction_callback callback;
+  void* data; /*for the callback*/
+  uint16_t len;
+  uint8_t buf[MAX_PAYLOAD_LEN];
+};
+typedef struct coap_transaction_t coap_transaction_t;
+
+/*
+ * Returns a free transaction for a message to addr and port (in network
+ * byte order) or NULL if all are in flight. The caller fills buf and len
+ * and then calls coap_send_transaction().
+ */
+coap_transaction_t* coap_new_transaction(struct uip_udp_conn* conn, uint16_t tid, uip_ipaddr_t* addr, uint16_t port);
+void coap_send_transaction(coap_transaction_t* transaction);
+void coap_clear_transaction(coap_transaction_t* transaction);
+
+/*
+ * Ends the transaction an incoming ACK or RST belongs to, returns 0 if
+ * there is none.
+ */
+int coap_handle_ack(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, int reset);
+
+/*
+ * Retransmits or gives up expired transactions, to be called by the
+ * coap_server process on timer events.
+ */
+void coap_check_transactions(void);
+
+/*
+ * Response cache for incoming CON requests. coap_find_response() returns
+ * the encoded response to an earlier request with the same tid from the
+ * same peer, or NULL.
+ */
+uint8_t* coap_find_response(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, uint16_t* len);
+void coap_cache_response(uint16_t tid, uip_ipaddr_t* addr, uint16_t port, uint8_t* buf, uint16_t len);
+
+#endif /* COAP_TRANSACTIONS_H_ */
@@ -19,6 +19,7 @@ delete_buffer(void)
 {
   if (data_buffer) {
     free(data_buffer);
+    data_buffer = NULL;
     buffer_index = 0;
     buffer_size = 0;
   }
@@ -37,6 +38,15 @@ init_buffer(uint16_t size)
   return data_buffer;
 }
 
+/*Frees everything allocated from the buffer but keeps the buffer itself.*/
+uint8_t*
+reset_buffer(void)
+{
+  buffer_index = 0;
+
+  return data_buffer;
+}
+
 uint8_t*
 allocate_buffer(uint16_t size)
 {
@@ -10,6 +10,7 @@
 
 void delete_buffer(void);
 uint8_t* init_buffer(uint16_t size);
+uint8_t* reset_buffer(void);
 uint8_t* allocate_buffer(uint16_t size);
 uint8_t* copy_to_buffer(void* data, uint16_t len);
 uint8_t* copy_text_to_buffer(char* text);
@@ -22,10 +22,38 @@ PROCESS_NAME(rest_manager_process);
 LIST(restful_services);
 LIST(restful_periodic_services);
 
+/*activated resources by hash of their url, chained through hash_next*/
+static resource_t* resource_hash[REST_HASH_SIZE];
+
+static uint16_t
+url_hash(const char* url, uint16_t url_len)
+{
+  uint16_t hash = 5381;
+
+  while (url_len--) {
+    hash = (hash << 5) + hash + (uint8_t)*url++;
+  }
+  return hash & (REST_HASH_SIZE - 1);
+}
+
+static resource_t*
+lookup_resource(const char* url, uint16_t url_len)
+{
+  resource_t* resource;
+
+  for (resource = resource_hash[url_hash(url, url_len)]; resource; resource = resource->hash_next) {
+    if (resource->url_len == url_len && memcmp(resource->url, url, url_len) == 0) {
+      return resource;
+    }
+  }
+  return NULL;
+}
+
 void
 rest_init(void)
 {
   list_init(restful_services);
+  memset(resource_hash, 0, sizeof(resource_hash));
 
 #ifdef WITH_COAP
   coap_set_service_callback(rest_invoke_restful_service);
@@ -40,14 +68,25 @@ rest_init(void)
 void
 rest_activate_resource(resource_t* resource)
 {
+  uint16_t hash;
+
   /*add it to the restful web service link list*/
   list_add(restful_services, resource);
+
+  /*and index it by url unless it is already there*/
+  resource->url_len = strlen(resource->url);
+  if (lookup_resource(resource->url, resource->url_len) != resource) {
+    hash = url_hash(resource->url, resource->url_len);
+    resource->hash_next = resource_hash[hash];
+    resource_hash[hash] = resource;
+  }
 }
 
 void
 rest_activate_periodic_resource(periodic_resource_t* periodic_resource)
 {
   list_add(restful_periodic_services, periodic_resource);
+  periodic_resource->resource->periodic = periodic_resource;
   rest_activate_resource(periodic_resource->resource);
 }
 
@@ -81,6 +120,12 @@ rest_get_resources(void)
   return restful_services;
 }
 
+list_t
+rest_get_periodic_resources(void)
+{
+  return restful_periodic_services;
+}
+
 void
 rest_set_response_status(RESPONSE* response, status_code_t status)
 {
@@ -178,6 +223,27 @@ rest_get_post_variable(REQUEST* request, const char *name, char* output, uint16_
 #endif /*WITH_COAP*/
 }
 
+int
+rest_get_block(REQUEST* request, uint32_t* offset, uint16_t* size, uint8_t* more)
+{
+#ifdef WITH_COAP
+  return coap_get_block(request, offset, size, more);
+#else
+  *offset = 0;
+  *size = 0;
+  *more = 0;
+  return 0;
+#endif /*WITH_COAP*/
+}
+
+void
+rest_set_block_more(RESPONSE* response, uint8_t more)
+{
+#ifdef WITH_COAP
+  coap_set_block_more(response, more);
+#endif /*WITH_COAP*/
+}
+
 content_type_t
 rest_get_header_content_type(REQUEST* request)
 {
@@ -224,51 +290,45 @@ rest_invoke_restful_service(REQUEST* request, RESPONSE* response)
 
   resource_t* resource = NULL;
 
-  for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next) {
-    /*if the web service handles that kind of requests and urls matches*/
-    if (url && strlen(resource->url) == url_len && strncmp(resource->url, url, url_len) == 0){
-      found = 1;
-      method_t method = rest_get_method_type(request);
-
-      PRINTF("method %u, resource->methods_to_handle %u\n", (uint16_t)method, resource->methods_to_handle);
-
-      if (resource->methods_to_handle & method) {
-
-        /*FIXME Need to move somewhere else*/
-        #ifdef WITH_COAP
-        uint32_t lifetime = 0;
-        if (coap_get_header_subscription_lifetime(request, &lifetime)) {
-          PRINTF("Lifetime %lu\n", lifetime);
-
-          periodic_resource_t* periodic_resource = NULL;
-          for (periodic_resource = (periodic_resource_t*)list_head(restful_periodic_services);
-               periodic_resource;
-               periodic_resource = periodic_resource->next) {
-            if (periodic_resource->resource == resource) {
-              PRINTF("Periodic Resource Found\n");
-              PRINT6ADDR(&request->addr);
-              periodic_resource->lifetime = lifetime;
-              stimer_set(periodic_resource->lifetime_timer, lifetime);
-              uip_ipaddr_copy(&periodic_resource->addr, &request->addr);
-            }
-          }
+  if (url) {
+    resource = lookup_resource(url, url_len);
+  }
+
+  if (resource) {
+    found = 1;
+    method_t method = rest_get_method_type(request);
+
+    PRINTF("method %u, resource->methods_to_handle %u\n", (uint16_t)method, resource->methods_to_handle);
+
+    if (resource->methods_to_handle & method) {
+
+      /*FIXME Need to move somewhere else*/
+      #ifdef WITH_COAP
+      uint32_t lifetime = 0;
+      periodic_resource_t* periodic_resource = resource->periodic;
+      if (periodic_resource && coap_get_header_subscription_lifetime(request, &lifetime)) {
+        PRINTF("Lifetime %lu\n", lifetime);
+        PRINTF("Periodic Resource Found\n");
+        PRINT6ADDR(&request->addr);
+        if (!coap_add_observer(periodic_resource, &request->addr, lifetime)) {
+          rest_set_response_status(response, INTERNAL_SERVER_ERROR_500);
+          return found;
         }
-        #endif /*WITH_COAP*/
+      }
+      #endif /*WITH_COAP*/
 
-        /*call pre handler if it exists*/
-        if (!resource->pre_handler || resource->pre_handler(request, response)) {
-          /* call handler function*/
-          resource->handler(request, response);
+      /*call pre handler if it exists*/
+      if (!resource->pre_handler || resource->pre_handler(request, response)) {
+        /* call handler function*/
+        resource->handler(request, response);
 
-          /*call post handler if it exists*/
-          if (resource->post_handler) {
-            resource->post_handler(request, response);
-          }
+        /*call post handler if it exists*/
+        if (resource->post_handler) {
+          resource->post_handler(request, response);
         }
-      } else {
-        rest_set_response_status(response, METHOD_NOT_ALLOWED_405);
       }
-      break;
+    } else {
+      rest_set_response_status(response, METHOD_NOT_ALLOWED_405);
     }
   }
 
@@ -305,21 +365,16 @@ PROCESS_THREAD(rest_manager_process, ev, data)
     if (ev == PROCESS_EVENT_TIMER) {
       for (periodic_resource = (periodic_resource_t*)list_head(restful_periodic_services);periodic_resource;periodic_resource = periodic_resource->next) {
         if (periodic_resource->period && etimer_expired(periodic_resource->handler_cb_timer)) {
-          PRINTF("Etimer expired for %s (period:%lu life:%lu)\n", periodic_resource->resource->url, periodic_resource->period, periodic_resource->lifetime);
+          PRINTF("Etimer expired for %s (period:%lu)\n", periodic_resource->resource->url, periodic_resource->period);
           /*call the periodic handler function if exists*/
           if (periodic_resource->periodic_handler) {
             if ((periodic_resource->periodic_handler)(periodic_resource->resource)) {
               PRINTF("RES CHANGE\n");
-              if (!stimer_expired(periodic_resource->lifetime_timer)) {
-                PRINTF("TIMER NOT EXPIRED\n");
+              /*notify only if someone is still subscribed*/
+              if (coap_count_observers(periodic_resource)) {
                 resource_changed(periodic_resource);
-                periodic_resource->lifetime = stimer_remaining(periodic_resource->lifetime_timer);
-              } else {
-                periodic_resource->lifetime = 0;
               }
             }
-
-            PRINTF("%s lifetime %lu (%lu) expired %d\n", periodic_resource->resource->url, stimer_remaining(periodic_resource->lifetime_timer), periodic_resource->lifetime, stimer_expired(periodic_resource->lifetime_timer));
           }
           etimer_reset(periodic_resource->handler_cb_timer);
         }
@@ -21,6 +21,25 @@
 #endif /*WITH_COAP*/
 
 struct resource_t;
+struct periodic_resource_t;
+struct coap_observer_t;
+
+/*
+ * Number of buckets of the URL hash used to dispatch requests, a power of
+ * two. Resources that share a bucket are chained, so a lookup compares
+ * about resources / REST_HASH_SIZE URLs. The default suits a few dozen
+ * resources; set REST_CONF_HASH_SIZE to the number of resources, rounded
+ * up to a power of two, for more.
+ */
+#ifdef REST_CONF_HASH_SIZE
+#define REST_HASH_SIZE REST_CONF_HASH_SIZE
+#else /*REST_CONF_HASH_SIZE*/
+#define REST_HASH_SIZE 16
+#endif /*REST_CONF_HASH_SIZE*/
+
+#if REST_HASH_SIZE <= 0 || (REST_HASH_SIZE & (REST_HASH_SIZE - 1)) != 0
+#error "REST_CONF_HASH_SIZE must be a power of two"
+#endif
 
 /*REST method types*/
 typedef enum {
@@ -49,6 +68,9 @@ struct resource_t {
   restful_pre_handler pre_handler; /*to be called before handler, may perform initializations*/
   restful_post_handler post_handler; /*to be called after handler, may perform finalizations (cleanup, etc)*/
   void* user_data; /*pointer to user specific data*/
+  struct resource_t *hash_next; /*next resource in the same hash bucket, set on activation*/
+  struct periodic_resource_t *periodic; /*periodic resource wrapping this one, if any*/
+  uint16_t url_len; /*length of url, set on activation*/
 };
 typedef struct resource_t resource_t;
 
@@ -57,12 +79,10 @@ struct periodic_resource_t {
   resource_t *resource;
   uint32_t period;
   struct etimer* handler_cb_timer;
-  struct stimer* lifetime_timer;
   restful_periodic_handler periodic_handler;
   restful_periodic_request_generator periodic_request_generator;
-  uint32_t lifetime;
-  uip_ipaddr_t addr;
-  struct uip_udp_conn *client_conn;
+  struct coap_observer_t *observers; /*subscribed clients, COAP only*/
+  uint16_t seq; /*sequence number of the latest notification*/
 };
 typedef struct periodic_resource_t periodic_resource_t;
 
@@ -82,8 +102,7 @@ RESOURCE(name, methods_to_handle, url); \
 int name##_periodic_handler(resource_t*); \
 void name##_periodic_request_generator(REQUEST*); \
 struct etimer handler_cb_timer_##name; \
-struct stimer lifetime_timer_##name; \
-periodic_resource_t periodic_resource_##name = {NULL, &resource_##name, period, &handler_cb_timer_##name, &lifetime_timer_##name, name##_periodic_handler, name##_periodic_request_generator, 0}
+periodic_resource_t periodic_resource_##name = {NULL, &resource_##name, period, &handler_cb_timer_##name, name##_periodic_handler, name##_periodic_request_generator, NULL, 0}
 
 
 /*
@@ -109,6 +128,11 @@ int rest_invoke_restful_service(REQUEST* request, RESPONSE* response);
  */
 list_t rest_get_resources(void);
 
+/*
+ * Returns the periodic resource list
+ */
+list_t rest_get_periodic_resources(void);
+
 /*
  * Returns query variable in the URL.
  * Returns true if the variable found, false otherwise.
@@ -126,6 +150,18 @@ int rest_get_post_variable(REQUEST* request, const char *name, char* output, uin
 method_t rest_get_method_type(REQUEST* request);
 void rest_set_method_type(REQUEST* request, method_t method);
 
+/*
+ * Block-wise transfer of large representations, see coap_get_block().
+ * Returns 0 if the protocol transfers representations in one piece, the
+ * handler then has to produce or consume the whole payload.
+ */
+int rest_get_block(REQUEST* request, uint32_t* offset, uint16_t* size, uint8_t* more);
+
+/*
+ * Tells the client that the representation continues after this block.
+ */
+void rest_set_block_more(RESPONSE* response, uint8_t more);
+
 /*
  * Getter for the request content type
  */
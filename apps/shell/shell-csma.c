@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell interface to the CSMA neighbor queues
+ */
+
+#include "contiki.h"
+#include "shell.h"
+#include "shell-csma.h"
+#include "net/mac/csma.h"
+
+#include <stdio.h>
+
+#define MAX_NEIGHBORS 8
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_csma_process, "csma");
+SHELL_COMMAND(csma_command,
+	      "csma",
+	      "csma: show the queue length and the sent and dropped packets of every CSMA neighbor",
+	      &shell_csma_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_csma_process, ev, data)
+{
+  struct csma_neighbor_stats stats[MAX_NEIGHBORS];
+  char buf[40];
+  int i, n;
+
+  PROCESS_BEGIN();
+
+  n = csma_neighbor_stats(stats, MAX_NEIGHBORS);
+  for(i = 0; i < n; i++) {
+    sprintf(buf, "%d.%d: %d queued, %u sent, %u dropped",
+            stats[i].addr.u8[0], stats[i].addr.u8[1], stats[i].queued,
+            stats[i].sent, stats[i].dropped);
+    shell_output_str(&csma_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_csma_init(void)
+{
+  shell_register_command(&csma_command);
+}
+/*---------------------------------------------------------------------------*/
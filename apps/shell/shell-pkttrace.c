@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell interface to the packet pipeline trace
+ */
+
+#include "contiki.h"
+#include "shell.h"
+#include "shell-pkttrace.h"
+#include "net/pkttrace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if PKTTRACE_ENABLED
+static const char *stage_names[PKTTRACE_STAGES] = {
+  "in rdc", "in mac", "in 6lowpan", "in tcpip", "in done",
+  "out tcpip", "out 6lowpan", "out mac", "out rdc", "out done"
+};
+
+static const char *drop_names[PKTTRACE_DROP_REASONS] = {
+  "none", "bad frame", "duplicate", "reassembly timeout",
+  "reassembly evicted", "too large", "queue full", "no route",
+  "mac collision", "mac noack", "mac error"
+};
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_pkttrace_process, "pkttrace");
+SHELL_COMMAND(pkttrace_command,
+	      "pkttrace",
+	      "pkttrace [reset]: show per-stage latency histograms and drops of the packet pipeline",
+	      &shell_pkttrace_process);
+PROCESS(shell_pkttrace_dump_process, "pkttrace-dump");
+SHELL_COMMAND(pkttrace_dump_command,
+	      "pkttrace-dump",
+	      "pkttrace-dump: output the packet pipeline trace in binary",
+	      &shell_pkttrace_dump_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_pkttrace_process, ev, data)
+{
+  char buf[8 * PKTTRACE_BUCKETS + 16];
+  int i, j, len;
+
+  PROCESS_BEGIN();
+
+  if(data != NULL && strcmp(data, "reset") == 0) {
+    pkttrace_reset();
+    PROCESS_EXIT();
+  }
+
+  sprintf(buf, "%lu packets, %lu ticks per second",
+          (unsigned long)pkttrace.packets, (unsigned long)RTIMER_SECOND);
+  shell_output_str(&pkttrace_command, buf, "");
+
+  /* one line per stage, with the counts of the latency buckets */
+  for(i = 0; i < PKTTRACE_STAGES; i++) {
+    len = 0;
+    for(j = 0; j < PKTTRACE_BUCKETS; j++) {
+      len += sprintf(buf + len, " %u", pkttrace.hist[i][j]);
+    }
+    shell_output_str(&pkttrace_command, (char *)stage_names[i], buf);
+  }
+
+  for(i = 1; i < PKTTRACE_DROP_REASONS; i++) {
+    if(pkttrace.drops[i] != 0) {
+      sprintf(buf, ": %u", pkttrace.drops[i]);
+      shell_output_str(&pkttrace_command, (char *)drop_names[i], buf);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+  return p + 2;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put32(uint8_t *p, uint32_t v)
+{
+  p = put16(p, v & 0xffff);
+  return put16(p, v >> 16);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_pkttrace_dump_process, ev, data)
+{
+  /* a histogram row is the largest part */
+  uint8_t buf[2 * PKTTRACE_BUCKETS + 2 * PKTTRACE_DROP_REASONS];
+  uint8_t *p;
+  int i, j;
+
+  PROCESS_BEGIN();
+
+  /* field by field, see net/pkttrace.h */
+  p = buf;
+  *p++ = PKTTRACE_VERSION;
+  *p++ = PKTTRACE_STAGES;
+  *p++ = PKTTRACE_BUCKETS;
+  *p++ = PKTTRACE_DROP_REASONS;
+  *p++ = PKTTRACE_RECORDS;
+  *p++ = PKTTRACE_DIR_STAGES;
+  p = put32(p, RTIMER_SECOND);
+  p = put32(p, pkttrace.packets);
+  shell_output(&pkttrace_dump_command, buf, p - buf, "", 0);
+
+  for(i = 0; i < PKTTRACE_STAGES; i++) {
+    p = buf;
+    for(j = 0; j < PKTTRACE_BUCKETS; j++) {
+      p = put16(p, pkttrace.hist[i][j]);
+    }
+    shell_output(&pkttrace_dump_command, buf, p - buf, "", 0);
+  }
+
+  p = buf;
+  for(i = 0; i < PKTTRACE_DROP_REASONS; i++) {
+    p = put16(p, pkttrace.drops[i]);
+  }
+  p = put16(p, pkttrace.head);
+  shell_output(&pkttrace_dump_command, buf, p - buf, "", 0);
+
+  for(i = 0; i < PKTTRACE_RECORDS; i++) {
+    p = buf;
+    for(j = 0; j < PKTTRACE_DIR_STAGES; j++) {
+      p = put32(p, pkttrace.ring[i].time[j]);
+    }
+    *p++ = pkttrace.ring[i].first;
+    *p++ = pkttrace.ring[i].seen;
+    *p++ = pkttrace.ring[i].drop;
+    shell_output(&pkttrace_dump_command, buf, p - buf, "", 0);
+  }
+
+  PROCESS_END();
+}
+#endif /* PKTTRACE_ENABLED */
+/*---------------------------------------------------------------------------*/
+void
+shell_pkttrace_init(void)
+{
+#if PKTTRACE_ENABLED
+  shell_register_command(&pkttrace_command);
+  shell_register_command(&pkttrace_dump_command);
+#endif /* PKTTRACE_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
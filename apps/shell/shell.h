@@ -358,6 +358,7 @@ struct shell_input {
 #include "shell-checkpoint.h"
 #include "shell-collect-view.h"
 #include "shell-coffee.h"
+#include "shell-csma.h"
 #include "shell-download.h"
 #include "shell-exec.h"
 #include "shell-file.h"
@@ -368,6 +369,7 @@ struct shell_input {
 #include "shell-netperf.h"
 #include "shell-netstat.h"
 #include "shell-ping.h"
+#include "shell-pkttrace.h"
 #include "shell-power.h"
 #include "shell-powertrace.h"
 #include "shell-ps.h"
@@ -83,6 +83,11 @@ int AES_set_encrypt_key(const u8 *userKey, AES_KEY *key);
 void AES_cfb128_encrypt(const u8 *in, u8 *out, u16 length, const AES_KEY *key,
                         unsigned char *ivec, s32 *num, const u8 enc);
 
+#if CHECK_CRYPTO
+/* Runs the known-answer tests, returns 0 if they pass. */
+int AES_known_answer_test();
+#endif
+
 #endif
 
 #endif /* !HEADER_AES_H */
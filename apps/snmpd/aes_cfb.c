@@ -185,6 +185,14 @@ void AES_cfb128_encrypt(const u8 *in, u8 *out, u16 length, const AES_KEY *key,
 	CRYPTO_cfb128_encrypt(in, out, length, key, ivec, num, enc,(block128_f)AES_encrypt);
 }
 
+static const u32 rcon[] = {
+	0x01000000, 0x02000000, 0x04000000, 0x08000000,
+	0x10000000, 0x20000000, 0x40000000, 0x80000000,
+	0x1B000000, 0x36000000, /* for 128-bit blocks, Rijndael never uses more than 10 rcon values */
+};
+
+#if ENABLE_AES_TABLES
+
 /*
 Te0[x] = S [x].[02, 01, 01, 03];
 Te1[x] = S [x].[03, 02, 01, 01];
@@ -466,11 +474,6 @@ static const u32 Te3u[256] PROGMEM = {
     0xb0b0cb7bU, 0x5454fca8U, 0xbbbbd66dU, 0x16163a2cU,
 };
 
-static const u32 rcon[] = {
-	0x01000000, 0x02000000, 0x04000000, 0x08000000,
-	0x10000000, 0x20000000, 0x40000000, 0x80000000,
-	0x1B000000, 0x36000000, /* for 128-bit blocks, Rijndael never uses more than 10 rcon values */
-};
 
 
 u32t getTe0(u16t index) {
@@ -659,4 +662,192 @@ void AES_encrypt(const u8 *in, u8 *out, const AES_KEY *key) {
 		rk[3];
 	PUTU32(out + 12, s3);
 }
+#else /* ENABLE_AES_TABLES */
+
+/*
+ * Compact byte-oriented AES, it needs only the 256-byte S-box instead of the 4 KB of T-tables.
+ */
+static const u8 Sbox[256] PROGMEM = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static u8 getSbox(u8 index) {
+#if CONTIKI_TARGET_AVR_RAVEN
+    return pgm_read_byte(&Sbox[index]);
+#else
+    return Sbox[index];
+#endif
+}
+
+/* multiplication by x in GF(2^8) */
+#define XTIME(x) ((u8)(((x) << 1) ^ (((x) & 0x80) ? 0x1b : 0x00)))
+
+/**
+ * Expand the cipher key into the encryption key schedule.
+ */
+int AES_set_encrypt_key(const u8 *userKey, AES_KEY *key) {
+    u32 *rk;
+    int i;
+    u32 temp;
+
+    if (!userKey || !key)
+        return -1;
+    rk = key->rd_key;
+
+    key->rounds = 10;
+
+    rk[0] = GETU32(userKey     );
+    rk[1] = GETU32(userKey +  4);
+    rk[2] = GETU32(userKey +  8);
+    rk[3] = GETU32(userKey + 12);
+
+    for (i = 0; i < 10; i++) {
+        temp  = rk[3];
+        rk[4] = rk[0] ^
+                ((u32)getSbox((temp >> 16) & 0xff) << 24) ^
+                ((u32)getSbox((temp >>  8) & 0xff) << 16) ^
+                ((u32)getSbox((temp      ) & 0xff) <<  8) ^
+                ((u32)getSbox((temp >> 24) & 0xff)      ) ^
+                rcon[i];
+        rk[5] = rk[1] ^ rk[4];
+        rk[6] = rk[2] ^ rk[5];
+        rk[7] = rk[3] ^ rk[6];
+        rk += 4;
+    }
+    return 0;
+}
+
+/*
+ * XOR a round key into the state, column c of the state is the word rk[c].
+ */
+static void add_round_key(u8 *state, const u32 *rk) {
+    u8 c;
+    for (c = 0; c < 4; c++) {
+        state[4 * c    ] ^= (u8)(rk[c] >> 24);
+        state[4 * c + 1] ^= (u8)(rk[c] >> 16);
+        state[4 * c + 2] ^= (u8)(rk[c] >>  8);
+        state[4 * c + 3] ^= (u8)(rk[c]      );
+    }
+}
+
+/*
+ * Encrypt a single block
+ * in and out can overlap
+ */
+void AES_encrypt(const u8 *in, u8 *out, const AES_KEY *key) {
+    const u32 *rk = key->rd_key;
+    u8 s[16], t[16];
+    u8 r, c, a0, a1, a2, a3, tmp;
+
+    memcpy(s, in, 16);
+    add_round_key(s, rk);
+
+    for (r = 1; r <= key->rounds; r++) {
+        /* SubBytes and ShiftRows: row i is rotated left by i columns */
+        for (c = 0; c < 4; c++) {
+            t[4 * c    ] = getSbox(s[4 * c]);
+            t[4 * c + 1] = getSbox(s[4 * ((c + 1) & 3) + 1]);
+            t[4 * c + 2] = getSbox(s[4 * ((c + 2) & 3) + 2]);
+            t[4 * c + 3] = getSbox(s[4 * ((c + 3) & 3) + 3]);
+        }
+        /* MixColumns, skipped in the last round */
+        if (r < key->rounds) {
+            for (c = 0; c < 4; c++) {
+                a0 = t[4 * c];
+                a1 = t[4 * c + 1];
+                a2 = t[4 * c + 2];
+                a3 = t[4 * c + 3];
+                tmp = a0 ^ a1 ^ a2 ^ a3;
+                t[4 * c    ] = a0 ^ tmp ^ XTIME(a0 ^ a1);
+                t[4 * c + 1] = a1 ^ tmp ^ XTIME(a1 ^ a2);
+                t[4 * c + 2] = a2 ^ tmp ^ XTIME(a2 ^ a3);
+                t[4 * c + 3] = a3 ^ tmp ^ XTIME(a3 ^ a0);
+            }
+        }
+        memcpy(s, t, 16);
+        add_round_key(s, rk + 4 * r);
+    }
+    memcpy(out, s, 16);
+}
+
+#endif /* ENABLE_AES_TABLES */
+
+#if CHECK_CRYPTO
+/*
+ * Known-answer tests, both AES implementations have to pass them.
+ */
+static const u8 kat_key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+
+/* FIPS-197, Appendix C.1 */
+static const u8 kat_plaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+};
+static const u8 kat_ciphertext[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+};
+
+/* NIST SP 800-38A, F.3.13 CFB128-AES128, the first 40 bytes */
+static const u8 kat_cfb_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+static const u8 kat_cfb_plaintext[40] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+};
+static const u8 kat_cfb_ciphertext[40] = {
+    0x3b, 0x3f, 0xd9, 0x2e, 0xb7, 0x2d, 0xad, 0x20, 0x33, 0x34, 0x49, 0xf8, 0xe8, 0x3c, 0xfb, 0x4a,
+    0xc8, 0xa6, 0x45, 0x37, 0xa0, 0xb3, 0xa9, 0x3f, 0xcd, 0xe3, 0xcd, 0xad, 0x9f, 0x1c, 0xe5, 0x8b,
+    0x26, 0x75, 0x1f, 0x67, 0xa3, 0xcb, 0xb1, 0x40,
+};
+
+int AES_known_answer_test() {
+    AES_KEY key;
+    u8 iv[16];
+    u8 buf[40];
+    s32 num = 0;
+
+    /* single block */
+    AES_set_encrypt_key(kat_key, &key);
+    AES_encrypt(kat_plaintext, buf, &key);
+    if (memcmp(buf, kat_ciphertext, 16)) {
+        return -1;
+    }
+
+    /* CFB128 encryption with a partial last block */
+    AES_set_encrypt_key(kat_cfb_key, &key);
+    memcpy(iv, kat_key, 16);
+    AES_cfb128_encrypt(kat_cfb_plaintext, buf, 40, &key, iv, &num, AES_ENCRYPT);
+    if (memcmp(buf, kat_cfb_ciphertext, 40)) {
+        return -1;
+    }
+
+    /* CFB128 decryption in place */
+    memcpy(iv, kat_key, 16);
+    num = 0;
+    AES_cfb128_encrypt(buf, buf, 40, &key, iv, &num, AES_DECRYPT);
+    if (memcmp(buf, kat_cfb_plaintext, 40)) {
+        return -1;
+    }
+    return 0;
+}
+#endif /* CHECK_CRYPTO */
+
 #endif
\ No newline at end of file
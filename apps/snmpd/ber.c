@@ -257,8 +257,8 @@ u8t ber_decode_oid_item(u8t* ptr, u8t len, u32t* value)
     *value = 0;
     while (i < len) {
         *value = (*value << 7) + (ptr[i] & 0x7F);
-        i++;
-        if (!(ptr[i] & 0x80)) {
+        /* the last octet of the element has the bit 8 cleared */
+        if (!(ptr[i++] & 0x80)) {
             break;
         }
     }
@@ -360,7 +360,7 @@ s8t ber_decode_pdu(u8t* const input, const u16t len, u16t* pos, pdu_t* pdu)
 {
     /* request PDU */
     u16t length;
-    s32t tmp;
+    s32t tmp, tmp2;
 
     /* pdu type */
     TRY(ber_decode_type_length(input, len, pos, &pdu->request_type, &length));
@@ -380,10 +380,21 @@ s8t ber_decode_pdu(u8t* const input, const u16t len, u16t* pos, pdu_t* pdu)
     snmp_log("error-status: %d\n", pdu->error_status);
 
     /* error-index */
-    TRY(ber_decode_integer(input, len, pos, &tmp));
-    pdu->error_index = (u8t)tmp;
+    TRY(ber_decode_integer(input, len, pos, &tmp2));
+    pdu->error_index = (u8t)tmp2;
     snmp_log("error-index: %d\n", pdu->error_index);
 
+    /* a GetBulkRequest carries non-repeaters and max-repetitions in place of error-status and error-index */
+    if (pdu->request_type == BER_TYPE_SNMP_GETBULK) {
+        pdu->non_repeaters = (u8t)max(0, min(tmp, 0xFF));
+        pdu->max_repetitions = (u8t)max(0, min(tmp2, 0xFF));
+        snmp_log("non-repeaters: %d, max-repetitions: %d\n", pdu->non_repeaters, pdu->max_repetitions);
+    }
+    /* error-status and error-index of a request are ignored (RFC 3416), a request
+       with them set would otherwise skip processing and release oids it does not own */
+    pdu->error_status = ERROR_STATUS_NO_ERROR;
+    pdu->error_index = 0;
+
     /* variable-bindings */
     pdu->varbind_index = *pos;
     snmp_log("varbind index %d\n", *pos);
@@ -407,6 +418,9 @@ s8t ber_decode_pdu(u8t* const input, const u16t len, u16t* pos, pdu_t* pdu)
 
         /* OID */
         cur_ptr->varbind.oid_ptr = oid_create();
+        if (!cur_ptr->varbind.oid_ptr) {
+            return ERR_MEMORY_ALLOCATION;
+        }
         TRY(ber_decode_oid(input, len, pos, cur_ptr->varbind.oid_ptr));
 
         /* void value */
@@ -415,39 +429,89 @@ s8t ber_decode_pdu(u8t* const input, const u16t len, u16t* pos, pdu_t* pdu)
     return 0;
 }
 
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded length field.
+ */
+static u8t ber_encoded_length_length(u16t length)
+{
+    if (length > 0xFF) {
+        return 3;
+    } else if (length > 0x7F) {
+        return 2;
+    }
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded integer value (without type and length).
+ */
+static u8t ber_encoded_integer_length(const s32t value)
+{
+    if (value < -16777216 || value > 16777215) {
+        return 4;
+    } else if (value < -32768 || value > 32767) {
+        return 3;
+    } else if (value < -128 || value > 127) {
+        return 2;
+    }
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded TLV with the value of the given length.
+ */
+u16t ber_encoded_tlv_length(const u16t len)
+{
+    return 1 + ber_encoded_length_length(len) + len;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded integer (type, length and value).
+ */
+u16t ber_encoded_integer_tlv_length(const s32t value)
+{
+    return 2 + ber_encoded_integer_length(value);
+}
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Write a BER encoded length to the buffer
  */
-s8t ber_encode_length(u8t* output, s16t* pos, u16t length)
+s8t ber_encode_length(u8t* output, u16t* pos, const u16t max_len, u16t length)
 {
     if (length > 0xFF) {
-        DECN(pos, 3);
+        CHECK_SPACE(pos, 3, max_len);
         /* first "the length of the length" goes in octets */
         /* the bit 0x80 of the first byte is set to show that the length is composed of multiple octets */
         output[*pos] = 0x82;
         output[*pos + 1] = (length >> 8) & 0xFF;
         output[*pos + 2] = length & 0xFF;
+        *pos += 3;
     } else if (length > 0x7F) {
-        DECN(pos, 2);
+        CHECK_SPACE(pos, 2, max_len);
         output[*pos] = 0x81;
-	output[*pos + 1] = length & 0xFF;
+        output[*pos + 1] = length & 0xFF;
+        *pos += 2;
     } else {
-        DEC(pos);
-        output[*pos] = length & 0x7F;
+        CHECK_SPACE(pos, 1, max_len);
+        output[(*pos)++] = length & 0x7F;
     }
     return 0;
 }
 
 /*-----------------------------------------------------------------------------------*/
 /*
- * Write a BER encoded variable binding to the buffer
+ * Write a BER encoded type and length to the buffer
  */
-s8t ber_encode_type_length(u8t* output, s16t* pos, u8t type, u16t len)
+s8t ber_encode_type_length(u8t* output, u16t* pos, const u16t max_len, u8t type, u16t len)
 {
-    TRY(ber_encode_length(output, pos, len));
-    DEC(pos);
-    output[*pos] = type;
+    CHECK_SPACE(pos, 1, max_len);
+    output[(*pos)++] = type;
+    TRY(ber_encode_length(output, pos, max_len, len));
     return 0;
 }
 
@@ -487,16 +551,28 @@ s8t ber_encode_oid_item(u32t value, u8t* ptr) {
     return 0;
 }
 
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Write raw bytes to the buffer
+ */
+static s8t ber_encode_raw(u8t* output, u16t* pos, const u16t max_len, const u8t* const ptr, const u16t len)
+{
+    CHECK_SPACE(pos, len, max_len);
+    memcpy(output + *pos, ptr, len);
+    *pos += len;
+    return 0;
+}
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Write a BER encoded oid to the buffer
  */
-s8t ber_encode_oid(u8t* output, s16t* pos, u8t* ptr, u16t len)
+s8t ber_encode_oid(u8t* output, u16t* pos, const u16t max_len, u8t* ptr, u16t len)
 {
-    DECN(pos, len);
-    memcpy(&output[*pos], ptr, len);
     /* type and length */
-    TRY(ber_encode_type_length(output, pos, BER_TYPE_OID, len));
+    TRY(ber_encode_type_length(output, pos, max_len, BER_TYPE_OID, len));
+    /* oid value */
+    TRY(ber_encode_raw(output, pos, max_len, ptr, len));
     return 0;
 }
 
@@ -505,32 +581,23 @@ s8t ber_encode_oid(u8t* output, s16t* pos, u8t* ptr, u16t len)
 /*
  * Write a BER encoded integer to the buffer
  */
-s8t ber_encode_integer(u8t* output, s16t* pos, u8t type, const s32t value)
+s8t ber_encode_integer(u8t* output, u16t* pos, const u16t max_len, u8t type, const s32t value)
 {
-    s16t init_pos = *pos;
     u16t length;
     s8t j;
 
     /* get the length of the BER encoded integer value in bytes */
-    if (value < -16777216 || value > 16777215) {
-        length = 4;
-    } else if (value < -32768 || value > 32767) {
-        length = 3;
-    } else if (value < -128 || value > 127) {
-        length = 2;
-    } else {
-        length = 1;
-    }
+    length = ber_encoded_integer_length(value);
+
+    /* write type and length */
+    TRY(ber_encode_type_length(output, pos, max_len, type, length));
 
     /* write integer value */
-    DECN(pos, length);
+    CHECK_SPACE(pos, length, max_len);
     for (j = length - 1; j >= 0; j--) {
-        output[*pos + (length - 1) - j] = (((u32t)value) >> (8 * j)) & 0xFF;
+        output[(*pos)++] = (((u32t)value) >> (8 * j)) & 0xFF;
     }
 
-    /* write type and length */
-    TRY(ber_encode_type_length(output, pos, type, init_pos - *pos));
-
     return 0;
 }
 
@@ -538,9 +605,8 @@ s8t ber_encode_integer(u8t* output, s16t* pos, u8t type, const s32t value)
 /*
  * Write a BER encoded unsigned integer to the buffer
  */
-s8t ber_encode_unsigned_integer(u8t* output, s16t* pos, const u8t type, const u32t value)
+s8t ber_encode_unsigned_integer(u8t* output, u16t* pos, const u16t max_len, const u8t type, const u32t value)
 {
-    s16t init_pos = *pos;
     u16t length;
     s8t j;
 
@@ -555,15 +621,15 @@ s8t ber_encode_unsigned_integer(u8t* output, s16t* pos, const u8t type, const u3
         length = 1;
     }
 
+    /* write type and length */
+    TRY(ber_encode_type_length(output, pos, max_len, type, length));
+
     /* write integer value */
-    DECN(pos, length);
+    CHECK_SPACE(pos, length, max_len);
     for (j = length - 1; j >= 0; j--) {
-        output[*pos + (length - 1) - j] = (value >> (8 * j)) & 0xFF;
+        output[(*pos)++] = (value >> (8 * j)) & 0xFF;
     }
 
-    /* write type and length */
-    TRY(ber_encode_type_length(output, pos, type, init_pos - *pos));
-
     return 0;
 }
 
@@ -571,14 +637,13 @@ s8t ber_encode_unsigned_integer(u8t* output, s16t* pos, const u8t type, const u3
 /*
  * Write a BER encoded string value to the buffer
  */
-s8t ber_encode_fixed_string(u8t* output, s16t* pos, const u8t* const str_value, const u16t len)
+s8t ber_encode_fixed_string(u8t* output, u16t* pos, const u16t max_len, const u8t* const str_value, const u16t len)
 {
-    /* string value */
-    DECN(pos, len);
-    memcpy(output + *pos, str_value, len);
-
     /* type and length */
-    TRY(ber_encode_type_length(output, pos, BER_TYPE_OCTET_STRING, len));
+    TRY(ber_encode_type_length(output, pos, max_len, BER_TYPE_OCTET_STRING, len));
+
+    /* string value */
+    TRY(ber_encode_raw(output, pos, max_len, str_value, len));
 
     return 0;
 }
@@ -588,110 +653,184 @@ s8t ber_encode_fixed_string(u8t* output, s16t* pos, const u8t* const str_value,
 /*
  * Write a BER encoded string value to the buffer
  */
-s8t ber_encode_string(u8t* output, s16t* pos, const u8t* const str_value)
+s8t ber_encode_string(u8t* output, u16t* pos, const u16t max_len, const u8t* const str_value)
+{
+    return ber_encode_fixed_string(output, pos, max_len, str_value, strlen((char*)str_value));
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of a BER encoded variable binding (without the sequence header).
+ */
+static u16t ber_encoded_var_bind_content_length(const varbind_t* const varbind)
+{
+    u16t len;
+    /* value */
+    switch (varbind->value_type) {
+        case BER_TYPE_OCTET_STRING:
+        case BER_TYPE_OID:
+            len = ber_encoded_tlv_length(varbind->value.p_value.len);
+            break;
+
+        case BER_TYPE_INTEGER:
+        case BER_TYPE_COUNTER:
+        case BER_TYPE_GAUGE:
+        case BER_TYPE_TIME_TICKS:
+            len = ber_encoded_integer_tlv_length(varbind->value.i_value);
+            break;
+
+        case BER_TYPE_NULL:
+            len = ber_void_null.len;
+            break;
+
+#if SNMP_VERSION_3
+        case BER_TYPE_NO_SUCH_OBJECT:
+        case BER_TYPE_NO_SUCH_INSTANCE:
+        case BER_TYPE_END_OF_MIB:
+            len = 2;
+            break;
+#endif
+        default:
+            len = 0;
+            break;
+    }
+    /* oid */
+    return len + ber_encoded_tlv_length(varbind->oid_ptr->len);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded variable binding.
+ */
+u16t ber_encoded_var_bind_length(const varbind_t* const varbind)
 {
-    return ber_encode_fixed_string(output, pos, str_value, strlen((char*)str_value));
+    /* sequence header and content */
+    return ber_encoded_tlv_length(ber_encoded_var_bind_content_length(varbind));
 }
 
 /*-----------------------------------------------------------------------------------*/
 /*
  * Write a BER encoded variable binding to the buffer
  */
-s8t ber_encode_var_bind(u8t* output, s16t* pos, const varbind_t* const varbind)
+s8t ber_encode_var_bind(u8t* output, u16t* pos, const u16t max_len, const varbind_t* const varbind)
 {
-    /* write the variable binding in the reverse order */
-    u16t len_pos = *pos;
+    /* sequence header*/
+    TRY(ber_encode_type_length(output, pos, max_len, BER_TYPE_SEQUENCE, ber_encoded_var_bind_content_length(varbind)));
+
+    /* oid */
+    TRY(ber_encode_oid(output, pos, max_len, varbind->oid_ptr->ptr, varbind->oid_ptr->len));
+
     /* value */
     switch (varbind->value_type) {
         case BER_TYPE_OCTET_STRING:
-            TRY(ber_encode_fixed_string(output, pos, varbind->value.p_value.ptr, varbind->value.p_value.len));
+            TRY(ber_encode_fixed_string(output, pos, max_len, varbind->value.p_value.ptr, varbind->value.p_value.len));
             break;
 
         case BER_TYPE_INTEGER:
         case BER_TYPE_COUNTER:
         case BER_TYPE_GAUGE:
         case BER_TYPE_TIME_TICKS:
-            TRY(ber_encode_integer(output, pos, varbind->value_type, varbind->value.i_value));
+            TRY(ber_encode_integer(output, pos, max_len, varbind->value_type, varbind->value.i_value));
             break;
 
         case BER_TYPE_NULL:
-            DECN(pos, ber_void_null.len);
-            memcpy(output + (*pos), ber_void_null.buffer, ber_void_null.len);
+            TRY(ber_encode_raw(output, pos, max_len, ber_void_null.buffer, ber_void_null.len));
             break;
 
         case BER_TYPE_OID:
-            TRY(ber_encode_oid(output, pos, varbind->value.p_value.ptr, varbind->value.p_value.len));
+            TRY(ber_encode_oid(output, pos, max_len, varbind->value.p_value.ptr, varbind->value.p_value.len));
             break;
 
 #if SNMP_VERSION_3
         case BER_TYPE_NO_SUCH_OBJECT:
-            DECN(pos, ber_no_such_object.len);
-            memcpy(output + (*pos), ber_no_such_object.buffer, ber_no_such_object.len);
+            TRY(ber_encode_raw(output, pos, max_len, ber_no_such_object.buffer, ber_no_such_object.len));
             break;
 
         case BER_TYPE_NO_SUCH_INSTANCE:
-            DECN(pos, ber_no_such_instance.len);
-            memcpy(output + (*pos), ber_no_such_instance.buffer, ber_no_such_instance.len);
+            TRY(ber_encode_raw(output, pos, max_len, ber_no_such_instance.buffer, ber_no_such_instance.len));
             break;
 
         case BER_TYPE_END_OF_MIB:
-            DECN(pos, ber_end_of_mib.len);
-            memcpy(output + (*pos), ber_end_of_mib.buffer, ber_end_of_mib.len);
+            TRY(ber_encode_raw(output, pos, max_len, ber_end_of_mib.buffer, ber_end_of_mib.len));
             break;
 #endif
         default:
             break;
     }
-    /* oid */
-    TRY(ber_encode_oid(output, pos, varbind->oid_ptr->ptr, varbind->oid_ptr->len));
-
-    /* sequence header*/
-    TRY(ber_encode_type_length(output, pos, BER_TYPE_SEQUENCE, len_pos - *pos));
     return 0;
 }
 
 /*-----------------------------------------------------------------------------------*/
 /*
- * Encode SNMP PDU
+ * Get the length of the BER encoded variable binding list (without the sequence header).
+ * If an error is reported the variable bindings of the request are sent back unchanged.
  */
-s8t ber_encode_pdu(u8t* output, s16t* pos, const u8t* const input, u16t input_len, const pdu_t* const  pdu, const u16t max_output_len)
+static u16t ber_encoded_var_bind_list_length(const u16t input_len, const pdu_t* const pdu)
 {
-    /* write in the reverse order */
+    u16t len = 0;
+    varbind_list_item_t* ptr;
+
+    if (pdu->error_status != ERROR_STATUS_NO_ERROR) {
+        return input_len - pdu->varbind_index;
+    }
+    for (ptr = pdu->varbind_first_ptr; ptr; ptr = ptr->next_ptr) {
+        len += ber_encoded_var_bind_length(&ptr->varbind);
+    }
+    return len;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of a BER encoded SNMP PDU (without the PDU header).
+ */
+static u16t ber_encoded_pdu_content_length(const u16t input_len, const pdu_t* const pdu)
+{
+    u16t len = ber_encoded_var_bind_list_length(input_len, pdu);
     if (pdu->error_status == ERROR_STATUS_NO_ERROR) {
-	/* 
-	 * the code below (double while) looks inefficient but for short lists
-	 * it is unbeatable because it doesn't require extra memory
-	 * and it keeps the list unmodified
-	 *
-	 */
-	
-        varbind_list_item_t* ptrLast = NULL;
-
-        while (ptrLast != pdu->varbind_first_ptr) {
-	  /* variable binding list */	
-	  varbind_list_item_t* ptr = pdu->varbind_first_ptr;
-	  
-	  while (ptr && ptr->next_ptr != ptrLast) {
-	    ptr = ptr->next_ptr;
-	  }	 
-	  TRY(ber_encode_var_bind(output, pos, &ptr->varbind));
-	  ptrLast = ptr;
-        }
-        TRY(ber_encode_type_length(output, pos, BER_TYPE_SEQUENCE, max_output_len - *pos));
-    } else {
-        DECN(pos, (input_len - pdu->varbind_index));
-        memcpy(&output[*pos], &input[pdu->varbind_index], input_len - pdu->varbind_index);
+        len = ber_encoded_tlv_length(len);
     }
+    return len + ber_encoded_integer_tlv_length(pdu->request_id) +
+            ber_encoded_integer_tlv_length(pdu->error_status) +
+            ber_encoded_integer_tlv_length(pdu->error_index);
+}
 
-    /* error index */
-    TRY(ber_encode_integer(output, pos, BER_TYPE_INTEGER, pdu->error_index));
-    /* error status */
-    TRY(ber_encode_integer(output, pos, BER_TYPE_INTEGER, pdu->error_status));
-    /* request id */
-    TRY(ber_encode_integer(output, pos, BER_TYPE_INTEGER, pdu->request_id));
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of a BER encoded SNMP PDU
+ */
+u16t ber_encoded_pdu_length(const u16t input_len, const pdu_t* const pdu)
+{
+    return ber_encoded_tlv_length(ber_encoded_pdu_content_length(input_len, pdu));
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Encode SNMP PDU
+ */
+s8t ber_encode_pdu(u8t* output, u16t* pos, const u16t max_len, const u8t* const input, u16t input_len, const pdu_t* const pdu)
+{
+    varbind_list_item_t* ptr;
 
     /* sequence header*/
-    TRY(ber_encode_type_length(output, pos, pdu->response_type, max_output_len - *pos));
+    TRY(ber_encode_type_length(output, pos, max_len, pdu->response_type, ber_encoded_pdu_content_length(input_len, pdu)));
+
+    /* request id */
+    TRY(ber_encode_integer(output, pos, max_len, BER_TYPE_INTEGER, pdu->request_id));
+    /* error status */
+    TRY(ber_encode_integer(output, pos, max_len, BER_TYPE_INTEGER, pdu->error_status));
+    /* error index */
+    TRY(ber_encode_integer(output, pos, max_len, BER_TYPE_INTEGER, pdu->error_index));
+
+    if (pdu->error_status == ERROR_STATUS_NO_ERROR) {
+        /* variable binding list */
+        TRY(ber_encode_type_length(output, pos, max_len, BER_TYPE_SEQUENCE, ber_encoded_var_bind_list_length(input_len, pdu)));
+        for (ptr = pdu->varbind_first_ptr; ptr; ptr = ptr->next_ptr) {
+            TRY(ber_encode_var_bind(output, pos, max_len, &ptr->varbind));
+        }
+    } else {
+        /* the variable binding list of the request */
+        TRY(ber_encode_raw(output, pos, max_len, &input[pdu->varbind_index], input_len - pdu->varbind_index));
+    }
 
     return 0;
 }
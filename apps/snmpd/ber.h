@@ -132,12 +132,56 @@ u8t ber_decode_oid_item(u8t* ptr, u8t len, u32t* value);
  */
 s8t ber_encode_oid_item(u32t value, u8t* ptr);
 
-s8t ber_encode_type_length(u8t* output, s16t* pos, u8t type, u16t len);
+/**
+ * \brief Determines the length in bytes of a BER encoded TLV.
+ * \param len     Length in bytes of the value.
+ * \return Length in bytes of the type, length and value fields.
+ * \hideinitializer
+ */
+u16t ber_encoded_tlv_length(const u16t len);
+
+/**
+ * \brief Determines the length in bytes of a BER encoded integer.
+ * \param value   A 32-bit signed integer value.
+ * \return Length in bytes of the type, length and value fields.
+ * \hideinitializer
+ */
+u16t ber_encoded_integer_tlv_length(const s32t value);
+
+s8t ber_encode_type_length(u8t* output, u16t* pos, const u16t max_len, u8t type, u16t len);
+
+s8t ber_encode_integer(u8t* output, u16t* pos, const u16t max_len, u8t type, const s32t value);
+
+s8t ber_encode_fixed_string(u8t* output, u16t* pos, const u16t max_len, const u8t* const str_value, const u16t len);
 
-s8t ber_encode_integer(u8t* output, s16t* pos, u8t type, const s32t value);
+/**
+ * \brief Determines the length in bytes of a BER encoded variable binding.
+ * \param varbind   A pointer to the variable binding.
+ * \return Length in bytes of the variable binding in the BER encoding.
+ * \hideinitializer
+ */
+u16t ber_encoded_var_bind_length(const varbind_t* const varbind);
 
-s8t ber_encode_fixed_string(u8t* output, s16t* pos, const u8t* const str_value, const u16t len);
+/**
+ * \brief Determines the length in bytes of a BER encoded SNMP PDU.
+ * \param input_len   Length of the request, used when the request variable bindings are sent back.
+ * \param pdu         A pointer to the PDU.
+ * \return Length in bytes of the PDU in the BER encoding.
+ * \hideinitializer
+ */
+u16t ber_encoded_pdu_length(const u16t input_len, const pdu_t* const pdu);
 
-s8t ber_encode_pdu(u8t* output, s16t* pos, const u8t* const input, u16t input_len, const pdu_t* const  pdu, const u16t max_output_len);
+/**
+ * \brief Writes a BER encoded SNMP PDU front-to-back.
+ * \param output      A pointer to the output buffer.
+ * \param pos         Position in the output buffer, advanced past the PDU.
+ * \param max_len     Size of the output buffer.
+ * \param input       A pointer to the request.
+ * \param input_len   Length of the request.
+ * \param pdu         A pointer to the PDU.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ * \hideinitializer
+ */
+s8t ber_encode_pdu(u8t* output, u16t* pos, const u16t max_len, const u8t* const input, u16t input_len, const pdu_t* const pdu);
 #endif	/* __BER_H__ */
 
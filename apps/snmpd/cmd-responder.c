@@ -19,6 +19,7 @@
  *
  */
 #include <string.h>
+#include <stdlib.h>
 
 #include "cmd-responder.h"
 
@@ -31,6 +32,9 @@
 
 #endif
 
+/** \brief Room left in a GetBulk response for length fields growing beyond the ones in the request. */
+#define GETBULK_RESERVED_LEN    16
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Handle an SNMP GET request
@@ -76,6 +80,98 @@ static s8t snmp_get_next(message_t* message)
 }
 
 
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Handle an SNMP GETBULK request. The repetitions are appended to the variable binding list
+ * only as long as their encoding fits into max_len bytes, so the response is truncated
+ * at a variable binding boundary instead of failing with tooBig.
+ */
+static s8t snmp_get_bulk(message_t* message, const u16t max_len)
+{
+    u16t len = 0, item_len;
+    u8t i, r, repeaters_num = 0, end_of_mib;
+    varbind_list_item_t *ptr = message->pdu.varbind_first_ptr, *last = 0, *repeaters, *src, *cur;
+
+    /* non-repeaters are handled as in a GETNEXT request */
+    for (i = 0; ptr && i < message->pdu.non_repeaters; i++) {
+        mib_get_next(&ptr->varbind);
+        len += ber_encoded_var_bind_length(&ptr->varbind);
+        last = ptr;
+        ptr = ptr->next_ptr;
+    }
+
+    /* detach the repeaters, the repetitions are appended after the non-repeaters */
+    repeaters = ptr;
+    if (last) {
+        last->next_ptr = 0;
+    } else {
+        message->pdu.varbind_first_ptr = 0;
+    }
+    for (ptr = repeaters; ptr; ptr = ptr->next_ptr) {
+        repeaters_num++;
+    }
+
+    src = repeaters;
+    for (r = 0; r < message->pdu.max_repetitions && repeaters_num; r++) {
+        end_of_mib = 1;
+        /* every repetition starts from the successors found in the previous one */
+        ptr = src;
+        for (i = 0; i < repeaters_num; i++) {
+            if (!(cur = varbind_list_append(last))) {
+                break;
+            }
+            if (!(cur->varbind.oid_ptr = oid_create())) {
+                varbind_list_item_free(cur);
+                break;
+            }
+            /* the oid is shared with the previous repetition until mib_get_next copies the successor */
+            cur->varbind.oid_ptr->ptr = ptr->varbind.oid_ptr->ptr;
+            cur->varbind.oid_ptr->len = ptr->varbind.oid_ptr->len;
+            cur->varbind.value_type = BER_TYPE_NULL;
+            mib_get_next(&cur->varbind);
+
+            item_len = ber_encoded_var_bind_length(&cur->varbind);
+            if (len + item_len > max_len) {
+                /* the response is full */
+                if (cur->varbind.value_type != BER_TYPE_END_OF_MIB) {
+                    oid_data_free(cur->varbind.oid_ptr->ptr);
+                }
+                oid_free(cur->varbind.oid_ptr);
+                varbind_list_item_free(cur);
+                break;
+            }
+            len += item_len;
+            if (cur->varbind.value_type != BER_TYPE_END_OF_MIB) {
+                end_of_mib = 0;
+            }
+
+            if (!last) {
+                message->pdu.varbind_first_ptr = cur;
+            }
+            last = cur;
+            if (i == 0) {
+                src = cur;
+            }
+            ptr = ptr->next_ptr;
+        }
+        if (i < repeaters_num || end_of_mib) {
+            break;
+        }
+    }
+    if (last) {
+        last->next_ptr = 0;
+    }
+
+    /* release the request variable bindings of the repeaters */
+    while (repeaters) {
+        ptr = repeaters->next_ptr;
+        oid_free(repeaters->varbind.oid_ptr);
+        varbind_list_item_free(repeaters);
+        repeaters = ptr;
+    }
+    return 0;
+}
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Handle an SNMP SET request
@@ -155,7 +251,11 @@ static s8t snmp_set(message_t* message)
 /*
  *  Delegates processing of an incomming PDU to a certain application.
  */
-s8t handle(message_t* message) {
+s8t handle(message_t* message, const u16t max_output_len) {
+    /* a report has already been prepared by the security model */
+    if (message->pdu.response_type == BER_TYPE_SNMP_REPORT) {
+        return 0;
+    }
     /* dispatch the PDU to the application */
     if (message->pdu.error_status == ERROR_STATUS_NO_ERROR) {
         switch (message->pdu.request_type) {
@@ -167,6 +267,15 @@ s8t handle(message_t* message) {
                 snmp_get_next(message);
                 break;
 
+            case BER_TYPE_SNMP_GETBULK:
+                /* GetBulkRequest-PDU is not defined in SNMPv1 */
+                if (message->version == SNMP_VERSION_1 ||
+                        max_output_len < message->pdu.varbind_index + GETBULK_RESERVED_LEN) {
+                    return FAILURE;
+                }
+                snmp_get_bulk(message, max_output_len - message->pdu.varbind_index - GETBULK_RESERVED_LEN);
+                break;
+
             case BER_TYPE_SNMP_SET:
                 snmp_set(message);
                 break;
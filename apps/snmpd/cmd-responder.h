@@ -31,7 +31,13 @@
 
 #include "snmp.h"
 
-s8t handle(message_t* message);
+/**
+ * \brief Processes the PDU of an incoming request and fills in the response.
+ * \param message           A pointer to the decoded message.
+ * \param max_output_len    The length of the buffer the response is encoded into.
+ * \return 0 if the request has been processed, otherwise -1 and the request should be dropped.
+ */
+s8t handle(message_t* message, const u16t max_output_len);
 
 #endif	/* __CMD_RESPONDER_H_ */
 
@@ -28,7 +28,7 @@
 #include "utils.h"
 #include "cmd-responder.h"
 
-#if ENABLE_SNMPv1
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
 #include "msg-proc-v1.h"
 #endif
 
@@ -100,14 +100,17 @@ s8t dispatch(u8t* const input,  const u16t input_len, u8t* output, u16t* output_
     switch (tmp) {
 #if ENABLE_SNMPv1
         case SNMP_VERSION_1:
-            msg_ptr = malloc(sizeof(message_t));
-            memset(msg_ptr, 0, sizeof(message_t));
+#endif
+#if ENABLE_SNMPv2c
+        case SNMP_VERSION_2C:
+#endif
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
+            msg_ptr = message_create(sizeof(message_t));
             break;
 #endif
 #if ENABLE_SNMPv3
         case SNMP_VERSION_3:
-            msg_ptr = malloc(sizeof(message_v3_t));
-            memset(msg_ptr, 0, sizeof(message_v3_t));
+            msg_ptr = message_create(sizeof(message_v3_t));
             break;
 #endif
         default:
@@ -116,6 +119,7 @@ s8t dispatch(u8t* const input,  const u16t input_len, u8t* output, u16t* output_
             snmp_log("unsupported SNMP version %d\n", tmp);
             return ERR_UNSUPPORTED_VERSION;
     }
+    CHECK_PTR(msg_ptr);
     msg_ptr->version = (u8t)tmp;
     snmp_log("snmp version: %d\n", msg_ptr->version);
 
@@ -123,6 +127,11 @@ s8t dispatch(u8t* const input,  const u16t input_len, u8t* output, u16t* output_
     switch (msg_ptr->version) {
 #if ENABLE_SNMPv1
         case SNMP_VERSION_1:
+#endif
+#if ENABLE_SNMPv2c
+        case SNMP_VERSION_2C:
+#endif
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
             tmp = prepareDataElements_v1(input, input_len, &pos, (message_t*)msg_ptr);
             break;
 #endif
@@ -138,13 +147,23 @@ s8t dispatch(u8t* const input,  const u16t input_len, u8t* output, u16t* output_
         return FAILURE;
     }
 
-    /* delegate request processing to the Command Responder */
-    handle(msg_ptr);
+    /* delegate request processing to the Command Responder. It fails on
+       a PDU type the version does not have or on no room for a GetBulk
+       response; neither is an ASN.1 parse error, so none is counted. */
+    if (handle(msg_ptr, max_output_len) != ERR_NO_ERROR) {
+        free_message(msg_ptr);
+        return FAILURE;
+    }
 
     /* dispatch preparing the response to the version-specific Message Processing Model */
     switch (msg_ptr->version) {
 #if ENABLE_SNMPv1
         case SNMP_VERSION_1:
+#endif
+#if ENABLE_SNMPv2c
+        case SNMP_VERSION_2C:
+#endif
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
             tmp = prepareResponseMessage_v1((message_t*)msg_ptr, output, output_len, input, input_len, max_output_len);
             break;
 #endif
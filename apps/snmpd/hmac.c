@@ -0,0 +1,113 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+#include <string.h>
+
+#include "hmac.h"
+#include "utils.h"
+#include "logging.h"
+
+#if ENABLE_SNMPv3 && ENABLE_AUTH
+
+#define HMAC_BLOCK_LENGTH 64
+
+#define IPAD 0x36
+#define OPAD 0x5C
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Fill the block with the key XORed with the pad value.
+ */
+static void hmac_pad(u8t* block, const u8t* const kul, const u8t kul_len, const u8t pad)
+{
+    u8t i;
+    memset(block, 0, HMAC_BLOCK_LENGTH);
+    memcpy(block, kul, kul_len);
+    for (i = 0; i < HMAC_BLOCK_LENGTH; i++) {
+        block[i] ^= pad;
+    }
+}
+
+s8t hmac_key_init(hmac_key_t* key, const u8t protocol, const u8t* const kul)
+{
+    u8t block[HMAC_BLOCK_LENGTH];
+
+    key->protocol = protocol;
+    switch (protocol) {
+        case USM_AUTH_HMAC_MD5:
+            hmac_pad(block, kul, 16, IPAD);
+            MD5Init(&key->inner.md5);
+            MD5Update(&key->inner.md5, block, HMAC_BLOCK_LENGTH);
+
+            hmac_pad(block, kul, 16, OPAD);
+            MD5Init(&key->outer.md5);
+            MD5Update(&key->outer.md5, block, HMAC_BLOCK_LENGTH);
+            break;
+#if ENABLE_AUTH_SHA
+        case USM_AUTH_HMAC_SHA:
+            hmac_pad(block, kul, SHA1_DIGEST_LENGTH, IPAD);
+            SHA1Init(&key->inner.sha1);
+            SHA1Update(&key->inner.sha1, block, HMAC_BLOCK_LENGTH);
+
+            hmac_pad(block, kul, SHA1_DIGEST_LENGTH, OPAD);
+            SHA1Init(&key->outer.sha1);
+            SHA1Update(&key->outer.sha1, block, HMAC_BLOCK_LENGTH);
+            break;
+#endif
+        default:
+            snmp_log("unsupported authentication protocol %d\n", protocol);
+            return FAILURE;
+    }
+    return 0;
+}
+
+void hmac_96(const hmac_key_t* const key, u8t* input, u16t input_len, u8t* mac)
+{
+    switch (key->protocol) {
+        case USM_AUTH_HMAC_MD5: {
+            u8t digest[16];
+            MD5_CTX MD = key->inner.md5;
+            MD5Update(&MD, input, input_len);
+            MD5Final(&MD, digest);
+
+            MD = key->outer.md5;
+            MD5Update(&MD, digest, 16);
+            MD5Final(&MD, digest);
+            memcpy(mac, digest, HMAC_96_LENGTH);
+            break;
+        }
+#if ENABLE_AUTH_SHA
+        case USM_AUTH_HMAC_SHA: {
+            u8t digest[SHA1_DIGEST_LENGTH];
+            SHA1_CTX SHA = key->inner.sha1;
+            SHA1Update(&SHA, input, input_len);
+            SHA1Final(&SHA, digest);
+
+            SHA = key->outer.sha1;
+            SHA1Update(&SHA, digest, SHA1_DIGEST_LENGTH);
+            SHA1Final(&SHA, digest);
+            memcpy(mac, digest, HMAC_96_LENGTH);
+            break;
+        }
+#endif
+    }
+}
+
+#endif
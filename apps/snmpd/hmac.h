@@ -0,0 +1,84 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         HMAC-MD5-96 and HMAC-SHA-96 authentication protocols of the USM (RFC 3414).
+ */
+
+#ifndef __HMAC_H__
+#define	__HMAC_H__
+
+#include "snmpd-types.h"
+#include "snmpd-conf.h"
+
+#if ENABLE_SNMPv3 && ENABLE_AUTH
+
+#include "md5.h"
+#if ENABLE_AUTH_SHA
+#include "sha1.h"
+#endif
+
+/** \brief length of the truncated message authentication code in bytes. */
+#define HMAC_96_LENGTH 12
+
+/** \brief Hash state of an authentication key after absorbing its ipad and opad.
+ *         It is computed once per key and cloned for every message. */
+typedef struct {
+    /** \brief authentication protocol, USM_AUTH_HMAC_MD5 or USM_AUTH_HMAC_SHA. */
+    u8t protocol;
+    /** \brief inner hash state, after the ipad block. */
+    union {
+        MD5_CTX md5;
+#if ENABLE_AUTH_SHA
+        SHA1_CTX sha1;
+#endif
+    } inner;
+    /** \brief outer hash state, after the opad block. */
+    union {
+        MD5_CTX md5;
+#if ENABLE_AUTH_SHA
+        SHA1_CTX sha1;
+#endif
+    } outer;
+} hmac_key_t;
+
+/**
+ * \brief Precomputes the ipad and opad hash states of a localized authentication key.
+ * \param key       A pointer to the key state to initialize.
+ * \param protocol  USM_AUTH_HMAC_MD5 (16-byte key) or USM_AUTH_HMAC_SHA (20-byte key).
+ * \param kul       The localized key.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t hmac_key_init(hmac_key_t* key, const u8t protocol, const u8t* const kul);
+
+/**
+ * \brief Computes the message authentication code truncated to 96 bits.
+ * \param key         A pointer to the precomputed key state, it is not modified.
+ * \param input       A pointer to the message.
+ * \param input_len   Length of the message.
+ * \param mac         A buffer for the HMAC_96_LENGTH bytes of the message authentication code.
+ */
+void hmac_96(const hmac_key_t* const key, u8t* input, u16t input_len, u8t* mac);
+
+#endif
+
+#endif	/* __HMAC_H__ */
@@ -18,26 +18,266 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  *
  */
+#include <string.h>
+
 #include "keytools.h"
 
 #if ENABLE_SNMPv3
 
 #include "snmpd-conf.h"
+#include "utils.h"
+#include "logging.h"
+
+#if ENABLE_USM_USERS_FILE
+#include "cfs/cfs.h"
+#endif
+
+/* localized keys of the default user */
+#if USM_AUTH_PROTOCOL == USM_AUTH_HMAC_SHA
+/* localized from the password "maplesyrup" */
+static const u8t authKul[20] = {0x40, 0x2c, 0xf5, 0x7c, 0x76, 0x05, 0x78, 0x8e, 0x88, 0x66, 0xdb, 0xdb, 0xdc, 0x19, 0x65, 0xfa, 0x7a, 0x06, 0x62, 0x1d};
+#else
+static const u8t authKul[16] = {0x6e, 0x53, 0x61, 0xd8, 0xb3, 0xec, 0x95, 0x4f, 0xfb, 0x98, 0x2c, 0x57, 0x45, 0x9e, 0x54, 0x83};
+#endif
+
+static const u8t privKul[16] = {0x9f, 0x99, 0x76, 0x2b, 0x85, 0x29, 0xb9, 0x22, 0x70, 0x98, 0x9c, 0xe0, 0xc7, 0x0d, 0xcc, 0x71};
+
+/* number of hash buckets, a power of two */
+#define USM_USER_BUCKETS 8
+
+static usm_user_t usm_users[USM_USERS_MAX];
+static u8t usm_users_num = 0;
+static usm_user_t* usm_user_buckets[USM_USER_BUCKETS];
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Hash bucket of a user name.
+ */
+static u8t usm_user_hash(const u8t* name, const u16t name_len)
+{
+    u8t hash = 0;
+    u16t i;
+    for (i = 0; i < name_len; i++) {
+        hash = hash * 31 + name[i];
+    }
+    return hash & (USM_USER_BUCKETS - 1);
+}
+
+usm_user_t* usm_user_find(const u8t* name, const u16t name_len)
+{
+    usm_user_t* user;
+    for (user = usm_user_buckets[usm_user_hash(name, name_len)]; user; user = user->next_ptr) {
+        if (user->name_len == name_len && !memcmp(user->name, name, name_len)) {
+            return user;
+        }
+    }
+    return 0;
+}
+
+s8t usm_user_add(const u8t* name, const u8t name_len, const u8t auth_protocol, const u8t* authKul, const u8t priv_protocol, const u8t* privKul)
+{
+    usm_user_t entry;
+    usm_user_t* user;
+    u8t bucket;
+
+    if (!name_len || name_len > USM_USER_NAME_LENGTH) {
+        snmp_log("bad user name length %d\n", name_len);
+        return FAILURE;
+    }
+    /* privacy requires authentication */
+    if (priv_protocol != USM_PRIV_NONE && auth_protocol == USM_AUTH_NONE) {
+        return FAILURE;
+    }
 
+    /* The keys are computed before the table is touched, so that a user
+       that cannot be given the requested security level is neither
+       added nor downgraded. */
+    entry.auth_protocol = auth_protocol;
+    entry.priv_protocol = priv_protocol;
+    if (auth_protocol != USM_AUTH_NONE) {
+#if ENABLE_AUTH
+        TRY(hmac_key_init(&entry.auth_key, auth_protocol, authKul));
+#else
+        return FAILURE;
+#endif
+    }
+    if (priv_protocol != USM_PRIV_NONE) {
+#if ENABLE_PRIVACY
+        if (priv_protocol != USM_PRIV_AES) {
+            return FAILURE;
+        }
+        AES_set_encrypt_key(privKul, &entry.priv_key);
+#else
+        return FAILURE;
+#endif
+    }
 
-u8t authKul[16] = {0x6e, 0x53, 0x61, 0xd8, 0xb3, 0xec, 0x95, 0x4f, 0xfb, 0x98, 0x2c, 0x57, 0x45, 0x9e, 0x54, 0x83};
+    user = usm_user_find(name, name_len);
+    if (!user) {
+        if (usm_users_num == USM_USERS_MAX) {
+            snmp_log("the usmUserTable is full\n");
+            return FAILURE;
+        }
+        user = &usm_users[usm_users_num++];
+        memcpy(user->name, name, name_len);
+        user->name_len = name_len;
+        bucket = usm_user_hash(name, name_len);
+        user->next_ptr = usm_user_buckets[bucket];
+        usm_user_buckets[bucket] = user;
+    }
 
-u8t privKul[16] = {0x9f, 0x99, 0x76, 0x2b, 0x85, 0x29, 0xb9, 0x22, 0x70, 0x98, 0x9c, 0xe0, 0xc7, 0x0d, 0xcc, 0x71};
+    user->auth_protocol = entry.auth_protocol;
+    user->priv_protocol = entry.priv_protocol;
+#if ENABLE_AUTH
+    if (entry.auth_protocol != USM_AUTH_NONE) {
+        memcpy(&user->auth_key, &entry.auth_key, sizeof(hmac_key_t));
+    }
+#endif
+#if ENABLE_PRIVACY
+    if (entry.priv_protocol != USM_PRIV_NONE) {
+        memcpy(&user->priv_key, &entry.priv_key, sizeof(AES_KEY));
+    }
+#endif
+    return 0;
+}
+
+#if ENABLE_USM_USERS_FILE
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Decode a hex string of exactly len bytes.
+ */
+static s8t hex_decode(const char* hex, u8t* out, const u8t len)
+{
+    u8t i, c, value = 0;
+    if (strlen(hex) != 2 * len) {
+        return FAILURE;
+    }
+    for (i = 0; i < 2 * len; i++) {
+        c = hex[i];
+        if (c >= '0' && c <= '9') {
+            c -= '0';
+        } else if (c >= 'a' && c <= 'f') {
+            c -= 'a' - 10;
+        } else if (c >= 'A' && c <= 'F') {
+            c -= 'A' - 10;
+        } else {
+            return FAILURE;
+        }
+        value = (value << 4) | c;
+        if (i & 1) {
+            out[i >> 1] = value;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Split the next space separated word off the line.
+ */
+static char* next_word(char** line)
+{
+    char* word;
+    while (**line == ' ' || **line == '\t') {
+        (*line)++;
+    }
+    if (!**line) {
+        return 0;
+    }
+    word = *line;
+    while (**line && **line != ' ' && **line != '\t') {
+        (*line)++;
+    }
+    if (**line) {
+        *(*line)++ = 0;
+    }
+    return word;
+}
 
-u8t* getAuthKul()
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Parse a user entry: <name> <md5|sha|none> [auth key] [<aes|none> [priv key]]
+ * The keys are the localized keys in hex.
+ */
+static s8t usm_user_parse(char* line)
 {
-    return authKul;
+    char *name, *word;
+    u8t auth_protocol = USM_AUTH_NONE, priv_protocol = USM_PRIV_NONE;
+    u8t authKul[20], privKul[16];
+
+    if (!(name = next_word(&line)) || !(word = next_word(&line))) {
+        return FAILURE;
+    }
+    if (!strcmp(word, "md5") || !strcmp(word, "sha")) {
+        auth_protocol = word[0] == 'm' ? USM_AUTH_HMAC_MD5 : USM_AUTH_HMAC_SHA;
+        if (!(word = next_word(&line)) || hex_decode(word, authKul, auth_protocol == USM_AUTH_HMAC_MD5 ? 16 : 20) != ERR_NO_ERROR) {
+            return FAILURE;
+        }
+    } else if (strcmp(word, "none")) {
+        return FAILURE;
+    }
+
+    if ((word = next_word(&line))) {
+        if (!strcmp(word, "aes")) {
+            priv_protocol = USM_PRIV_AES;
+            if (!(word = next_word(&line)) || hex_decode(word, privKul, 16) != ERR_NO_ERROR) {
+                return FAILURE;
+            }
+        } else if (strcmp(word, "none")) {
+            return FAILURE;
+        }
+    }
+    return usm_user_add((u8t*)name, strlen(name), auth_protocol, authKul, priv_protocol, privKul);
 }
 
-u8t* getPrivKul()
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Load the users from a file, one user per line, lines starting with # are ignored.
+ */
+static void usm_users_load(const char* file)
 {
-    return privKul;
+    char line[USM_USER_LINE_LENGTH];
+    u8t len = 0, overflow = 0, eof = 0;
+    char c;
+    int fd = cfs_open(file, CFS_READ);
+
+    if (fd < 0) {
+        return;
+    }
+    while (!eof) {
+        if (cfs_read(fd, &c, 1) != 1) {
+            /* the last line may miss the line break */
+            c = '\n';
+            eof = 1;
+        }
+        if (c == '\n' || c == '\r') {
+            line[len] = 0;
+            if (len && !overflow && line[0] != '#' && usm_user_parse(line) != ERR_NO_ERROR) {
+                snmp_log("bad user entry in %s\n", file);
+            }
+            len = overflow = 0;
+        } else if (len < USM_USER_LINE_LENGTH - 1) {
+            line[len++] = c;
+        } else {
+            overflow = 1;
+        }
+    }
+    cfs_close(fd);
 }
+#endif /* ENABLE_USM_USERS_FILE */
 
+s8t usm_users_init()
+{
+    /* the default user */
+#if ENABLE_PRIVACY
+    TRY(usm_user_add(getUserName(), strlen((char*)getUserName()), USM_AUTH_PROTOCOL, authKul, USM_PRIV_AES, privKul));
+#else
+    TRY(usm_user_add(getUserName(), strlen((char*)getUserName()), USM_AUTH_PROTOCOL, authKul, USM_PRIV_NONE, privKul));
+#endif
+#if ENABLE_USM_USERS_FILE
+    usm_users_load(USM_USERS_FILE);
+#endif
+    return 0;
+}
 
-#endif
\ No newline at end of file
+#endif
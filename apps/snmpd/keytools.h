@@ -21,7 +21,7 @@
 
 /**
  * \file
- *         Key tools.
+ *         Key tools, the usmUserTable with the precomputed keys of every user.
  * \author
  *         Siarhei Kuryla <kurilo@gmail.com>
  */
@@ -34,11 +34,60 @@
 
 #if ENABLE_SNMPv3
 
-u8t* getAuthKul();
+#if ENABLE_AUTH
+#include "hmac.h"
+#endif
 
-u8t* getPrivKul();
+#if ENABLE_PRIVACY
+#include "aes.h"
+#endif
 
+/** \brief An entry of the usmUserTable. Only the keys precomputed from the localized keys are kept. */
+typedef struct usm_user_t {
+    /** \brief user name. */
+    u8t name[USM_USER_NAME_LENGTH];
+    /** \brief length of the user name. */
+    u8t name_len;
+    /** \brief authentication protocol, USM_AUTH_NONE, USM_AUTH_HMAC_MD5 or USM_AUTH_HMAC_SHA. */
+    u8t auth_protocol;
+    /** \brief privacy protocol, USM_PRIV_NONE or USM_PRIV_AES. */
+    u8t priv_protocol;
+#if ENABLE_AUTH
+    /** \brief ipad and opad hash states of the authentication key. */
+    hmac_key_t auth_key;
 #endif
+#if ENABLE_PRIVACY
+    /** \brief expanded privacy key. */
+    AES_KEY priv_key;
+#endif
+    /** \brief next user in the same hash bucket. */
+    struct usm_user_t* next_ptr;
+} usm_user_t;
 
-#endif	/* __KEYTOOLS_H__ */
+/**
+ * \brief Adds a user to the usmUserTable or replaces the keys of an existing one.
+ * \param name            user name.
+ * \param name_len        length of the user name.
+ * \param auth_protocol   authentication protocol.
+ * \param authKul         localized authentication key, 16 bytes for HMAC-MD5-96, 20 bytes for HMAC-SHA-96.
+ * \param priv_protocol   privacy protocol.
+ * \param privKul         localized privacy key, 16 bytes.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t usm_user_add(const u8t* name, const u8t name_len, const u8t auth_protocol, const u8t* authKul, const u8t priv_protocol, const u8t* privKul);
 
+/**
+ * \brief Looks a user up by the user name.
+ * \return a pointer to the user or 0 if the user is unknown.
+ */
+usm_user_t* usm_user_find(const u8t* name, const u16t name_len);
+
+/**
+ * \brief Adds the default user and loads the users from USM_USERS_FILE if enabled.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t usm_users_init();
+
+#endif
+
+#endif	/* __KEYTOOLS_H__ */
@@ -29,6 +29,8 @@
 #ifndef __CRYPTO_H__
 #define	__CRYPTO_H__
 
+#include <stdint.h>
+
 #include "snmpd-types.h"
 #include "snmpd-conf.h"
 
@@ -73,8 +75,8 @@
  **********************************************************************
  */
 
-/* typedef a 32 bit type */
-typedef u32t UINT4;
+/* typedef a 32 bit type, u32t is wider on 64-bit hosts and breaks the rotations */
+typedef uint32_t UINT4;
 
 /* Data structure for MD5 (Message Digest) computation */
 typedef struct {
@@ -73,29 +73,30 @@ static ptr_t oid_entPhySensorEntry PROGMEM              = {ber_oid_entPhySensorE
 static u8t ber_oid_snmpSetSerialNo[] PROGMEM            = {0x2b, 0x06, 0x01, 0x06, 0x03, 0x01, 0x01, 0x06, 0x01, 0x00};
 static ptr_t oid_snmpSetSerialNo PROGMEM                = {ber_oid_snmpSetSerialNo, 10};
 
-ptr_t* handleTableNextOid2(u8t* oid, u8t len, u8t* columns, u8t columnNumber, u8t rowNumber) {
-    ptr_t* ret = 0;
+#if ENABLE_MIB_TABLE_CURSOR
+static mib_table_cursor_t ORTableCursor;
+static mib_table_cursor_t ifTableCursor;
+static mib_table_cursor_t ifXTableCursor;
+static mib_table_cursor_t entPhySensorTableCursor;
+#define ADD_TABLE(oid, gfp, gnofp, svfp, cursor) add_table_cursor(oid, gfp, gnofp, svfp, cursor)
+#else
+#define ADD_TABLE(oid, gfp, gnofp, svfp, cursor) add_table(oid, gfp, gnofp, svfp)
+#endif
+
+ptr_t* handleTableNextOid2(mib_object_t* object, u8t* oid, u8t len, u8t* columns, u8t columnNumber, u8t rowNumber) {
     u32t oid_el1, oid_el2;
     u8t i;
-    i = ber_decode_oid_item(oid, len, &oid_el1);
-    i = ber_decode_oid_item(oid + i, len - i, &oid_el2);
+    /* a walk continues from the row returned last */
+    if (!mib_table_resume(object, &oid_el1, &oid_el2)) {
+        i = ber_decode_oid_item(oid, len, &oid_el1);
+        i = ber_decode_oid_item(oid + i, len - i, &oid_el2);
+    }
     for (i = 0; i < columnNumber; i++) {
         if (oid_el1 < columns[i] || (oid_el1 == columns[i] && oid_el2 < rowNumber)) {
-            ret = oid_create();
-            CHECK_PTR_U(ret);
-            ret->len = 2;
-            ret->ptr = malloc(2);
-            CHECK_PTR_U(ret->ptr);
-            ret->ptr[0] = columns[i];
-            if (oid_el1 < columns[i]) {
-                ret->ptr[1] = 1;
-            } else {
-                ret->ptr[1] = oid_el2 + 1;
-            }
-            break;
+            return mib_table_instance(object, columns[i], oid_el1 < columns[i] ? 1 : oid_el2 + 1);
         }
     }
-    return ret;
+    return 0;
 }
 
 /*
@@ -175,7 +176,7 @@ s8t getOREntry(mib_object_t* object, u8t* oid, u8t len)
 
 ptr_t* getNextOREntry(mib_object_t* object, u8t* oid, u8t len)
 {
-    return handleTableNextOid2(oid, len, sysORTableColumns, 3, ORTableSize);
+    return handleTableNextOid2(object, oid, len, sysORTableColumns, 3, ORTableSize);
 }
 
 /*
@@ -432,7 +433,7 @@ u8t ifTableColumns[] = {ifIndex, ifDescr, ifType, ifMtu, ifSpeed, ifPhysAddress,
 
 ptr_t* getNextIfEntry(mib_object_t* object, u8t* oid, u8t len)
 {
-    return handleTableNextOid2(oid, len, ifTableColumns, 15, ifTableSize);
+    return handleTableNextOid2(object, oid, len, ifTableColumns, 15, ifTableSize);
 }
 
 /*
@@ -571,7 +572,7 @@ u8t ifXTableColumns[] = {ifName, ifInMulticastPkts, ifInBroadcastPkts, ifOutMult
 
 ptr_t* getNextIfXEntry(mib_object_t* object, u8t* oid, u8t len)
 {
-    return handleTableNextOid2(oid, len, ifXTableColumns, 9, ifTableSize);
+    return handleTableNextOid2(object, oid, len, ifXTableColumns, 9, ifTableSize);
 }
 
 /*
@@ -747,7 +748,7 @@ s8t getEntPhySensorEntry(mib_object_t* object, u8t* oid, u8t len)
 
 ptr_t* getNextEntPhySensorEntry(mib_object_t* object, u8t* oid, u8t len)
 {
-    return handleTableNextOid2(oid, len, entPhySensorTableColumns, 8, entPhySensorTableSize);
+    return handleTableNextOid2(object, oid, len, entPhySensorTableColumns, 8, entPhySensorTableSize);
 }
 
 /*
@@ -817,7 +818,7 @@ s8t mib_init()
         add_scalar(&oid_system_sysORLastChange, FLAG_ACCESS_READONLY, BER_TYPE_TIME_TICKS, 0, 0, 0) == -1) {
         return -1;
     }
-    if (add_table(&oid_system_sysOREntry, &getOREntry, &getNextOREntry, 0) == -1) {
+    if (ADD_TABLE(&oid_system_sysOREntry, &getOREntry, &getNextOREntry, 0, &ORTableCursor) == -1) {
         return -1;
     }
 
@@ -825,7 +826,7 @@ s8t mib_init()
     if (add_scalar(&oid_ifNumber, FLAG_ACCESS_READONLY, BER_TYPE_INTEGER, &ifNumber, 0, 0) != ERR_NO_ERROR) {
         return -1;
     }
-    if (add_table(&oid_ifEntry, &getIfEntry, &getNextIfEntry, 0) == -1) {
+    if (ADD_TABLE(&oid_ifEntry, &getIfEntry, &getNextIfEntry, 0, &ifTableCursor) == -1) {
         return -1;
     }
 
@@ -841,12 +842,12 @@ s8t mib_init()
     }
 
     // ifXTable
-    if (add_table(&oid_ifXEntry, &getIfXEntry, &getNextIfXEntry, 0) == -1) {
+    if (ADD_TABLE(&oid_ifXEntry, &getIfXEntry, &getNextIfXEntry, 0, &ifXTableCursor) == -1) {
         return -1;
     }
 
     // entPhySensorEntry
-    if (add_table(&oid_entPhySensorEntry, &getEntPhySensorEntry, &getNextEntPhySensorEntry, 0) == -1) {
+    if (ADD_TABLE(&oid_entPhySensorEntry, &getEntPhySensorEntry, &getNextEntPhySensorEntry, 0, &entPhySensorTableCursor) == -1) {
         return -1;
     }
     
@@ -92,26 +92,22 @@ s8t getIf(mib_object_t* object, u8t* oid, u8t len)
     return 0;
 }
 
+#if ENABLE_MIB_TABLE_CURSOR
+static mib_table_cursor_t if_table_cursor;
+#endif
+
 ptr_t* getNextIfOid(mib_object_t* object, u8t* oid, u8t len)
 {
     u32t oid_el1, oid_el2;
     u8t i;
-    i = ber_decode_oid_item(oid, len, &oid_el1);
-    i = ber_decode_oid_item(oid + i, len - i, &oid_el2);
+    /* a walk continues from the row returned last */
+    if (!mib_table_resume(object, &oid_el1, &oid_el2)) {
+        i = ber_decode_oid_item(oid, len, &oid_el1);
+        i = ber_decode_oid_item(oid + i, len - i, &oid_el2);
+    }
 
     if (oid_el1 < ifIndex || (oid_el1 == ifIndex && oid_el2 < ifNumber)) {
-        ptr_t* ret = oid_create();
-        CHECK_PTR_U(ret);
-        ret->len = 2;
-        ret->ptr = malloc(2);
-        CHECK_PTR_U(ret->ptr);
-        ret->ptr[0] = ifIndex;
-        if (oid_el1 < ifIndex) {
-            ret->ptr[1] = 1;
-        } else {
-            ret->ptr[1] = oid_el2 + 1;
-        }
-        return ret;
+        return mib_table_instance(object, ifIndex, oid_el1 < ifIndex ? 1 : oid_el2 + 1);
     }
     return 0;
 }
@@ -133,7 +129,11 @@ s8t mib_init()
         return -1;
     }
 
+#if ENABLE_MIB_TABLE_CURSOR
+    if (add_table_cursor(&oid_if_table, &getIf, &getNextIfOid, 0, &if_table_cursor) == -1) {
+#else
     if (add_table(&oid_if_table, &getIf, &getNextIfOid, 0) == -1) {
+#endif
         return -1;
     }
 
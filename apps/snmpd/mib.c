@@ -26,33 +26,96 @@
 #include "utils.h"
 #include "logging.h"
 
+#if CONTIKI_TARGET_AVR_RAVEN && ENABLE_PROGMEM
+#include <avr/pgmspace.h>
+#endif
+
+/*
+ * The MIB is kept in the lexicographical order of the oids. The objects themselves
+ * are never moved, instead a sorted index refers to them, so that both the lookup
+ * of an object and of its successor are done by a binary search.
+ */
 #if MIB_SIZE > 0
 static mib_object_t mib[MIB_SIZE];
-static u16t mib_length;
+/* offsets of the objects in the mib array sorted by their oids */
+static u16t mib_index[MIB_SIZE];
+#define MIB_AT(i) (&mib[mib_index[i]])
 
 #else
-static mib_object_t *mib_head = 0, *mib_tail = 0;
+/** \brief Number of index entries the dynamic MIB index grows by. */
+#define MIB_INDEX_CHUNK     8
+
+/* objects of the MIB sorted by their oids */
+static mib_object_t** mib_index = 0;
+static u16t mib_index_size = 0;
+#define MIB_AT(i) (mib_index[i])
 #endif
 
+static u16t mib_length = 0;
+
 /*-----------------------------------------------------------------------------------*/
 /*
- * Adds an object to the MIB.
- * TODO: sort while adding an object
+ * Returns the number of objects in the MIB which oids are less than or equal to the given one,
+ * i.e. the position of the first object that follows the oid.
  */
-void mib_add(mib_object_t* object) {
+static u16t mib_upper_bound(ptr_t* oid)
+{
+    u16t low = 0, high = mib_length, middle;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (oid_cmp_lex(oid, MIB_AT(middle)->varbind.oid_ptr) < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Adds an object to the MIB keeping the MIB sorted.
+ */
+static s8t mib_add(mib_object_t* object)
+{
+    u16t pos, i;
+    ptr_t oid;
+
+    #if CONTIKI_TARGET_AVR_RAVEN && ENABLE_PROGMEM
+    /* the oid of the object is stored in ROM, bring it to RAM for the comparison */
+    TRY(oid_copy(&oid, object->varbind.oid_ptr, 0));
+    pos = mib_upper_bound(&oid);
+    oid_data_free(oid.ptr);
+    #else
+    oid.ptr = object->varbind.oid_ptr->ptr;
+    oid.len = object->varbind.oid_ptr->len;
+    pos = mib_upper_bound(&oid);
+    #endif
+
     #if !MIB_SIZE
-    if (!mib_head) {
-        mib_head = object;
-        mib_tail = object;
-        object->next_ptr = 0;
-    } else {
-        mib_tail->next_ptr = object;
-        object->next_ptr = 0;
-        mib_tail = object;
+    if (mib_length == mib_index_size) {
+        mib_object_t** index = realloc(mib_index, (mib_index_size + MIB_INDEX_CHUNK) * sizeof(mib_object_t*));
+        CHECK_PTR(index);
+        mib_index = index;
+        mib_index_size += MIB_INDEX_CHUNK;
+    }
+    /* keep the list of objects in the same order as the index */
+    object->next_ptr = pos < mib_length ? MIB_AT(pos) : 0;
+    if (pos > 0) {
+        MIB_AT(pos - 1)->next_ptr = object;
     }
+    #endif
+
+    for (i = mib_length; i > pos; i--) {
+        mib_index[i] = mib_index[i - 1];
+    }
+    #if MIB_SIZE
+    mib_index[pos] = object - mib;
     #else
-    mib_length++;
+    mib_index[pos] = object;
     #endif
+    mib_length++;
+    return ERR_NO_ERROR;
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -63,9 +126,12 @@ s8t add_scalar(ptr_t* oid, u8t flags, u8t value_type, const void* const value, g
 {
     #if !MIB_SIZE
     mib_object_t* object = mib_object_create();
-    memset(object, 0, sizeof(mib_object_t));
     CHECK_PTR(object);
+    memset(object, 0, sizeof(mib_object_t));
     #else
+    if (mib_length >= MIB_SIZE) {
+        return -1;
+    }
     mib_object_t* object = &mib[mib_length];
     #endif
     /* set oid functions */
@@ -114,9 +180,7 @@ s8t add_scalar(ptr_t* oid, u8t flags, u8t value_type, const void* const value, g
     object->varbind.oid_ptr = oid;
     object->varbind.value_type = value_type;
 
-    mib_add(object);
-
-    return ERR_NO_ERROR;
+    return mib_add(object);
 }
 
 #if ENABLE_MIB_TABLE
@@ -124,7 +188,21 @@ s8t add_scalar(ptr_t* oid, u8t flags, u8t value_type, const void* const value, g
 /*
  * Adds a table to the MIB.
  */
+#if ENABLE_MIB_TABLE_CURSOR
 s8t add_table(ptr_t* oid_prefix, get_value_t  gfp, get_next_oid_t gnofp, set_value_t svfp)
+{
+    return add_table_cursor(oid_prefix, gfp, gnofp, svfp, 0);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Adds a table with a row cursor to the MIB.
+ */
+s8t add_table_cursor(ptr_t* oid_prefix, get_value_t gfp, get_next_oid_t gnofp, set_value_t svfp,
+                     mib_table_cursor_t* cursor)
+#else
+s8t add_table(ptr_t* oid_prefix, get_value_t  gfp, get_next_oid_t gnofp, set_value_t svfp)
+#endif
 {
     if (!gfp || !gnofp) {
         return -1;
@@ -132,7 +210,11 @@ s8t add_table(ptr_t* oid_prefix, get_value_t  gfp, get_next_oid_t gnofp, set_val
     #if !MIB_SIZE
     mib_object_t* object = mib_object_create();
     CHECK_PTR(object);
+    memset(object, 0, sizeof(mib_object_t));
     #else
+    if (mib_length >= MIB_SIZE) {
+        return -1;
+    }
     mib_object_t* object = &mib[mib_length];
     #endif
 
@@ -149,58 +231,107 @@ s8t add_table(ptr_t* oid_prefix, get_value_t  gfp, get_next_oid_t gnofp, set_val
         object->attrs = FLAG_ACCESS_READONLY;
     }
 
+    #if ENABLE_MIB_TABLE_CURSOR
+    if (cursor) {
+        memset(cursor, 0, sizeof(mib_table_cursor_t));
+        cursor->instance.ptr = cursor->buf;
+    }
+    object->cursor_ptr = cursor;
+    #endif
+
     /* mark the entry in the MIB as a table */
     object->varbind.value_type = BER_TYPE_NULL;
 
-    mib_add(object);
-    return ERR_NO_ERROR;
+    return mib_add(object);
 }
 
-#define GET_NEXT_OID_PTR ptr->get_next_oid_fnc_ptr
-#else
-#define GET_NEXT_OID_PTR 0
-#endif
-
-static mib_object_t* ptr;
-
-#if MIB_SIZE
-static u16t mib_cur_index;
-#endif
+#if ENABLE_MIB_TABLE_CURSOR
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Stores a (column, row) instance in a table cursor.
+ */
+ptr_t* mib_table_cursor_fill(mib_table_cursor_t* cursor, u32t column, u32t row)
+{
+    u8t len = ber_encoded_oid_item_length(column);
+    if (len + ber_encoded_oid_item_length(row) > MIB_TABLE_CURSOR_LENGTH) {
+        return 0;
+    }
+    ber_encode_oid_item(column, cursor->buf);
+    ber_encode_oid_item(row, cursor->buf + len);
+    cursor->instance.len = len + ber_encoded_oid_item_length(row);
+    cursor->column = column;
+    cursor->row = row;
+    return &cursor->instance;
+}
 
-void mib_iterator_init()
+/*
+ * Checks whether the instance is the one last returned by the table, i.e. a walk continues.
+ */
+static u8t mib_table_cursor_hit(mib_table_cursor_t* cursor, u8t* oid, u8t len)
 {
-    #if !MIB_SIZE
-    ptr = mib_head;
-    #else
-    mib_cur_index = 0;
-    ptr = &mib[0];
-    #endif    
+    return cursor->instance.len && len == cursor->instance.len && !memcmp(oid, cursor->buf, len);
 }
+#endif
 
-u8t mib_iterator_is_end()
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Gets the instance a walk continues from.
+ */
+u8t mib_table_resume(mib_object_t* object, u32t* column, u32t* row)
 {
-    #if !MIB_SIZE
-    return ptr == 0;
-    #else
-    return mib_cur_index >= mib_length;
+    #if ENABLE_MIB_TABLE_CURSOR
+    if (object->cursor_ptr && object->cursor_ptr->hit) {
+        *column = object->cursor_ptr->column;
+        *row = object->cursor_ptr->row;
+        return 1;
+    }
     #endif
+    return 0;
 }
 
-void mib_iterator_next() {
-    #if !MIB_SIZE
-    ptr = ptr->next_ptr;
-    #else
-    mib_cur_index++;
-    ptr = &mib[mib_cur_index];
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Creates the instance returned by a get next oid function.
+ */
+ptr_t* mib_table_instance(mib_object_t* object, u32t column, u32t row)
+{
+    ptr_t* ret;
+    u8t len;
+
+    #if ENABLE_MIB_TABLE_CURSOR
+    if (object->cursor_ptr) {
+        return mib_table_cursor_fill(object->cursor_ptr, column, row);
+    }
     #endif
+    ret = oid_create();
+    CHECK_PTR_U(ret);
+    len = ber_encoded_oid_item_length(column);
+    ret->len = len + ber_encoded_oid_item_length(row);
+    ret->ptr = malloc(ret->len);
+    if (!ret->ptr) {
+        oid_free(ret);
+        return 0;
+    }
+    ber_encode_oid_item(column, ret->ptr);
+    ber_encode_oid_item(row, ret->ptr + len);
+    return ret;
 }
 
-
-#if CONTIKI_TARGET_AVR_RAVEN
-#include <avr/pgmspace.h>
+#define GET_NEXT_OID_PTR(ptr) ptr->get_next_oid_fnc_ptr
 #else
+#define GET_NEXT_OID_PTR(ptr) 0
 #endif
 
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Checks whether the oid in the request addresses a non-existing instance of the scalar object.
+ */
+static u8t is_no_such_instance(varbind_t* req, mib_object_t* object)
+{
+    u16t oid_len = oid_length(object->varbind.oid_ptr);
+    return !GET_NEXT_OID_PTR(object) && oid_len - 1 <= req->oid_ptr->len + 1 &&
+            !oid_cmpn(req->oid_ptr, object->varbind.oid_ptr, oid_len - 1);
+}
 
 /*-----------------------------------------------------------------------------------*/
 /*
@@ -208,32 +339,33 @@ void mib_iterator_next() {
  */
 mib_object_t* mib_get(varbind_t* req)
 {
-    u16t oid_len;
-    
-    mib_iterator_init();
-    while (!mib_iterator_is_end()) {
+    mib_object_t* ptr = 0;
+    u16t oid_len = 0;
+    u16t pos = mib_upper_bound(req->oid_ptr);
+
+    /* the only candidate is the greatest object which is less than or equal to the oid */
+    if (pos > 0) {
+        ptr = MIB_AT(pos - 1);
         oid_len = oid_length(ptr->varbind.oid_ptr);
-        if (!GET_NEXT_OID_PTR) {
+        if (!GET_NEXT_OID_PTR(ptr)) {
             // scalar
-            if (oid_len == req->oid_ptr->len && !oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr)) {
-                break;
+            if (oid_len != req->oid_ptr->len || oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr)) {
+                ptr = 0;
             }
-            /* check noSuchInstance */
-            if (oid_len - 1 <= req->oid_ptr->len + 1 && !oid_cmpn(req->oid_ptr, ptr->varbind.oid_ptr, oid_len - 1)) {
-                req->value_type = BER_TYPE_NO_SUCH_INSTANCE;
-                snmp_log("noSuchInstance\n");
-                return 0;
-            }
-        }
-        if (GET_NEXT_OID_PTR && oid_len < req->oid_ptr->len &&
-                !oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr)) {
+        } else if (oid_len >= req->oid_ptr->len || oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr)) {
             // tabular
-            break;
+            ptr = 0;
         }
-        mib_iterator_next();
     }
 
-    if (mib_iterator_is_end()) {
+    if (!ptr) {
+        /* check noSuchInstance on the neighbours of the oid */
+        if ((pos > 0 && is_no_such_instance(req, MIB_AT(pos - 1))) ||
+                (pos < mib_length && is_no_such_instance(req, MIB_AT(pos)))) {
+            req->value_type = BER_TYPE_NO_SUCH_INSTANCE;
+            snmp_log("noSuchInstance\n");
+            return 0;
+        }
         req->value_type = BER_TYPE_NO_SUCH_OBJECT;
         snmp_log("noSuchObject\n");
         return 0;
@@ -259,51 +391,67 @@ mib_object_t* mib_get(varbind_t* req)
  */
 mib_object_t* mib_get_next(varbind_t* req)
 {
-    int cmp;
-    u16t oid_len;
-    
-    mib_iterator_init();
-    while (!mib_iterator_is_end()) {
-        // find the object
-        cmp = oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr);
+    mib_object_t* ptr = 0;
+    u16t oid_len = 0;
+    u16t pos = mib_upper_bound(req->oid_ptr);
+
+    /* a table which is a prefix of the oid may still contain successors of the oid */
+    if (pos > 0 && GET_NEXT_OID_PTR(MIB_AT(pos - 1)) &&
+            oid_length(MIB_AT(pos - 1)->varbind.oid_ptr) <= req->oid_ptr->len &&
+            !oid_cmp(req->oid_ptr, MIB_AT(pos - 1)->varbind.oid_ptr)) {
+        pos--;
+    }
+
+    for (; pos < mib_length; pos++) {
+        ptr = MIB_AT(pos);
         oid_len = oid_length(ptr->varbind.oid_ptr);
 
-        if (!GET_NEXT_OID_PTR) {
-            // handle a scalar object
-            if (cmp < 0 || (cmp == 0 && req->oid_ptr->len < oid_len)) {
-                #if ENABLE_MIB_TABLE || ENABLE_PROGMEM
-                    oid_copy(req->oid_ptr, ptr->varbind.oid_ptr, 0);
-                    CHECK_PTR_U(req->oid_ptr->ptr);
-                #else
-                    req->oid_ptr.len = ptr->varbind.oid_ptr.len;
-                    req->oid_ptr.ptr = ptr->varbind.oid_ptr.ptr;
-                #endif
-                break;
-            }
+        if (!GET_NEXT_OID_PTR(ptr)) {
+            // all the following scalar objects are successors
+            #if ENABLE_MIB_TABLE || ENABLE_PROGMEM
+                oid_copy(req->oid_ptr, ptr->varbind.oid_ptr, 0);
+                CHECK_PTR_U(req->oid_ptr->ptr);
+            #else
+                req->oid_ptr.len = ptr->varbind.oid_ptr.len;
+                req->oid_ptr.ptr = ptr->varbind.oid_ptr.ptr;
+            #endif
+            break;
         } else {
             #if ENABLE_MIB_TABLE
-            /* handle a tabular object */
-            if (cmp < 0 || cmp == 0) {
-                ptr_t* table_oid_ptr;
-                if ((table_oid_ptr = (ptr->get_next_oid_fnc_ptr)(ptr, (cmp < 0 ? 0 : &req->oid_ptr->ptr[oid_len]),
-                        cmp < 0 ? 0 : req->oid_ptr->len - oid_len)) != 0) {
-                    /* copy the mib object's oid */
-                    oid_copy(req->oid_ptr, ptr->varbind.oid_ptr, oid_len + table_oid_ptr->len);
-                    CHECK_PTR_U(req->oid_ptr->ptr);
-                    memcpy(&req->oid_ptr->ptr[oid_len], table_oid_ptr->ptr, table_oid_ptr->len);
-                    req->oid_ptr->len += table_oid_ptr->len;
-
+            /* handle a tabular object, start from its first row unless the oid points inside the table */
+            u8t inside = oid_len < req->oid_ptr->len && !oid_cmp(req->oid_ptr, ptr->varbind.oid_ptr);
+            ptr_t* table_oid_ptr;
+            #if ENABLE_MIB_TABLE_CURSOR
+            if (ptr->cursor_ptr) {
+                ptr->cursor_ptr->hit = inside && mib_table_cursor_hit(ptr->cursor_ptr,
+                        &req->oid_ptr->ptr[oid_len], req->oid_ptr->len - oid_len);
+            }
+            #endif
+            if ((table_oid_ptr = (ptr->get_next_oid_fnc_ptr)(ptr, (inside ? &req->oid_ptr->ptr[oid_len] : 0),
+                    inside ? req->oid_ptr->len - oid_len : 0)) != 0) {
+                /* copy the mib object's oid */
+                oid_copy(req->oid_ptr, ptr->varbind.oid_ptr, oid_len + table_oid_ptr->len);
+                CHECK_PTR_U(req->oid_ptr->ptr);
+                memcpy(&req->oid_ptr->ptr[oid_len], table_oid_ptr->ptr, table_oid_ptr->len);
+                req->oid_ptr->len += table_oid_ptr->len;
+
+                #if ENABLE_MIB_TABLE_CURSOR
+                /* the instance of a cursor is not allocated */
+                if (!ptr->cursor_ptr || table_oid_ptr != &ptr->cursor_ptr->instance) {
                     free(table_oid_ptr->ptr);
                     oid_free(table_oid_ptr);
-                    break;                    
                 }
+                #else
+                free(table_oid_ptr->ptr);
+                oid_free(table_oid_ptr);
+                #endif
+                break;
             }
             #endif
         }
-        mib_iterator_next();
     }
 
-    if (mib_iterator_is_end()) {
+    if (pos >= mib_length) {
         req->value_type = BER_TYPE_END_OF_MIB;
         snmp_log("mib does not contain next object\n");
         return 0;
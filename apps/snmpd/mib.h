@@ -40,6 +40,14 @@
 /** \brief Enables MIB dynamic tables. If enabled, every MIB object uses additional 2 bytes. */
 #define ENABLE_MIB_TABLE    1
 
+/** \brief Enables row cursors of dynamic tables, only used if ENABLE_MIB_TABLE is set. If enabled,
+ *         every MIB object uses additional 2 bytes.
+ */
+#define ENABLE_MIB_TABLE_CURSOR     1
+
+/** \brief Maximum length of the BER encoded instance oid kept in a table cursor. */
+#define MIB_TABLE_CURSOR_LENGTH     10
+
 /** \brief Enables program (ROM) memory for storing oids on the AVR Raven platform. */
 #define ENABLE_PROGMEM      1
 
@@ -64,6 +72,32 @@ typedef s8t(*get_value_t)(mib_object_t* object, u8t* oid, u8t len);
 typedef ptr_t* (*get_next_oid_t)(mib_object_t* object, u8t* oid, u8t len);
 #endif
 
+#if ENABLE_MIB_TABLE && ENABLE_MIB_TABLE_CURSOR
+/** \brief Cursor of a table which remembers the instance last returned by its get next oid function.
+ *
+ *  A get next oid function may return the instance of the cursor instead of an allocated oid.
+ *  When the next GetNext of a walk asks for the successor of that instance, the cursor is marked
+ *  as hit and the function resumes from the decoded column and row without decoding the oid.
+ *  The oid of the response is copied into the buffer of oid_data_alloc(), so a walk makes no heap allocation.
+ */
+typedef struct mib_table_cursor_t {
+    /** \brief The last returned instance, points to the buffer of the cursor. */
+    ptr_t instance;
+
+    /** \brief The column of the last returned instance. */
+    u32t column;
+
+    /** \brief The row index of the last returned instance. */
+    u32t row;
+
+    /** \brief Set if the oid passed to the get next oid function is the last returned instance. */
+    u8t hit;
+
+    /** \brief Buffer for the BER encoded instance. */
+    u8t buf[MIB_TABLE_CURSOR_LENGTH];
+} mib_table_cursor_t;
+#endif
+
 /** \brief Get value function type.
  *  \param object   a pointer to the MIB object.
  *  \param oid      a BER encoded oid which is used only for tabular objects. Specifies an object in the table.
@@ -97,6 +131,11 @@ struct mib_object_t {
     get_next_oid_t get_next_oid_fnc_ptr;
 #endif
 
+#if ENABLE_MIB_TABLE && ENABLE_MIB_TABLE_CURSOR
+    /** \brief A pointer to the row cursor. It is set only for tabular objects which have a cursor. */
+    mib_table_cursor_t* cursor_ptr;
+#endif
+
     /** \brief A pointer to the set value function. */
     set_value_t set_fnc_ptr;
 
@@ -128,6 +167,47 @@ s8t add_scalar(ptr_t* oid, u8t flags, u8t value_type, const void* const value, g
 s8t add_table(ptr_t* oid_prefix, get_value_t gfp, get_next_oid_t gnofp, set_value_t svfp);
 #endif
 
+#if ENABLE_MIB_TABLE && ENABLE_MIB_TABLE_CURSOR
+/** \brief Adds a tabular object with a row cursor to the MIB.
+ *  \param oid_prefix   oid prefix of the object.
+ *  \param gfp          a pointer to a get value function.
+ *  \param gnofp        a pointer to a get next oid function, it may return mib_table_cursor_fill().
+ *  \param svfp         a pointer to a set value function.
+ *  \param cursor       a preallocated cursor of the table.
+ *  \return 0 if successfully finished, otherwise -1.
+ */
+s8t add_table_cursor(ptr_t* oid_prefix, get_value_t gfp, get_next_oid_t gnofp, set_value_t svfp,
+                     mib_table_cursor_t* cursor);
+
+/** \brief Stores a (column, row) instance in a table cursor.
+ *  \param cursor   the cursor of the table.
+ *  \param column   the column of the instance.
+ *  \param row      the row index of the instance.
+ *  \return the instance of the cursor, 0 if it does not fit into the cursor.
+ */
+ptr_t* mib_table_cursor_fill(mib_table_cursor_t* cursor, u32t column, u32t row);
+#endif
+
+#if ENABLE_MIB_TABLE
+/** \brief Gets the instance a get next oid function continues from when a walk resumes.
+ *  \param object   the tabular object.
+ *  \param column   set to the column of the instance returned last.
+ *  \param row      set to the row index of the instance returned last.
+ *  \return 1 if the oid passed to the function is the instance returned last, otherwise 0,
+ *          always 0 for a table without a row cursor.
+ */
+u8t mib_table_resume(mib_object_t* object, u32t* column, u32t* row);
+
+/** \brief Creates the (column, row) instance returned by a get next oid function.
+ *  \param object   the tabular object.
+ *  \param column   the column of the instance.
+ *  \param row      the row index of the instance.
+ *  \return the instance of the row cursor of the table, or an allocated oid if the table has
+ *          no cursor, 0 on failure.
+ */
+ptr_t* mib_table_instance(mib_object_t* object, u32t column, u32t row);
+#endif
+
 /** \brief Gets an MIB object for a given variable binding.
  *  \param req   variable binding.
  *  \return a pointer to an object if such object exists, 0 otherwise.
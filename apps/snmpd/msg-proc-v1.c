@@ -27,7 +27,7 @@
 #include "logging.h"
 #include "dispatcher.h"
 
-#if ENABLE_SNMPv1
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
 
 s8t prepareDataElements_v1(u8t* const input, const u16t input_len, u16t* pos, message_t* request) {
     /* decode community string */
@@ -63,33 +63,40 @@ s8t prepareDataElements_v1(u8t* const input, const u16t input_len, u16t* pos, me
 }
 
 
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of a BER encoded SNMPv1 response message
+ */
+static u16t encoded_v1_response_length(const message_t* const message, u16t input_len)
+{
+    return ber_encoded_integer_tlv_length(message->version) +
+            ber_encoded_tlv_length(strlen(COMMUNITY_STRING)) +
+            ber_encoded_pdu_length(input_len, &message->pdu);
+}
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Encode an SNMPv1 response message in BER
  */
 static s8t encode_v1_response(const message_t* const message, u8t* output, u16t* output_len, const u8t* const input, u16t input_len, const u16t max_output_len)
 {
-    s16t pos = max_output_len;
-    ber_encode_pdu(output, &pos, input, input_len, &message->pdu, max_output_len);
+    u16t pos = 0;
 
-    /* community string */
-    TRY(ber_encode_fixed_string(output, &pos, (u8t*)COMMUNITY_STRING, strlen(COMMUNITY_STRING)));
+    /* sequence header*/
+    TRY(ber_encode_type_length(output, &pos, max_output_len, BER_TYPE_SEQUENCE, encoded_v1_response_length(message, input_len)));
     /* version */
-    TRY(ber_encode_integer(output, &pos, BER_TYPE_INTEGER, message->version));
+    TRY(ber_encode_integer(output, &pos, max_output_len, BER_TYPE_INTEGER, message->version));
+    /* community string */
+    TRY(ber_encode_fixed_string(output, &pos, max_output_len, (u8t*)COMMUNITY_STRING, strlen(COMMUNITY_STRING)));
 
-    /* sequence header*/
-    TRY(ber_encode_type_length(output, &pos, BER_TYPE_SEQUENCE, max_output_len - pos));
+    TRY(ber_encode_pdu(output, &pos, max_output_len, input, input_len, &message->pdu));
 
-    *output_len = max_output_len - pos;
-    if (pos > 0) {
-        memmove(output, output + pos, *output_len);
-    }
+    *output_len = pos;
     return 0;
 }
 
 s8t prepareResponseMessage_v1(message_t* message, u8t* output, u16t* output_len, const u8t* const input, u16t input_len, const u16t max_output_len) {
-    /* encode the response */
-    if (encode_v1_response(message, output, output_len, input, input_len, max_output_len) != ERR_NO_ERROR) {
+    if (ber_encoded_tlv_length(encoded_v1_response_length(message, input_len)) > max_output_len) {
         /* Too big message.
          * If the size of the GetResponse-PDU generated as described
          * below would exceed a local limitation, then the receiving
@@ -100,10 +107,11 @@ s8t prepareResponseMessage_v1(message_t* message, u8t* output, u16t* output_len,
          */
         message->pdu.error_status = ERROR_STATUS_TOO_BIG;
         message->pdu.error_index = 0;
-        if (encode_v1_response(message, output, output_len, input, input_len, max_output_len) == -1) {
-            incSilentDrops();
-            return FAILURE;
-        }
+    }
+    /* encode the response */
+    if (encode_v1_response(message, output, output_len, input, input_len, max_output_len) != ERR_NO_ERROR) {
+        incSilentDrops();
+        return FAILURE;
     }
     return 0;
 }
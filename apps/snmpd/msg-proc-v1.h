@@ -31,7 +31,7 @@
 
 #include "snmp.h"
 
-#if ENABLE_SNMPv1
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
 
 /**
  * Takes the input SNMPv1 message as an array of bytes and decodes it to the message_t structure.
@@ -28,6 +28,7 @@
 #include "logging.h"
 #include "usm.h"
 #include "snmpd.h"
+#include "dispatcher.h"
 
 #if ENABLE_SNMPv3
 
@@ -92,72 +93,143 @@ s8t prepareDataElements_v3(u8t* const input, const u16t input_len, u16t* pos, me
     /* contextName */
     TRY(ber_decode_string((u8t*)input, input_len, pos, &request->contextName.ptr, &request->contextName.len));
 
-    /* decode PDU */
-    ber_decode_pdu(input, input_len, pos, &request->pdu);
+    /* decode PDU, if we ran out of memory send a general error */
+    if (ber_decode_pdu(input, input_len, pos, &request->pdu) == ERR_MEMORY_ALLOCATION) {
+        request->pdu.error_status = ERROR_STATUS_GEN_ERR;
+    }
 
     return 0;
 }
 
-static s8t encode_v3_response(message_v3_t* message, u8t* output, u16t* output_len, const u8t* const input, u16t input_len, const u16t max_output_len)
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of a BER encoded ScopedPDU
+ */
+static u16t encoded_scoped_pdu_length(const message_v3_t* const message, u16t input_len)
+{
+    return ber_encoded_tlv_length(message->contextEngineID.len) +
+            ber_encoded_tlv_length(message->contextName.len) +
+            ber_encoded_pdu_length(input_len, &message->pdu);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of the BER encoded msgGlobalData
+ */
+static u16t encoded_global_data_length(const message_v3_t* const message)
 {
-    s16t pos = max_output_len;
-    ber_encode_pdu(output, &pos, input, input_len, &message->pdu, max_output_len);
+    return ber_encoded_integer_tlv_length(message->msgId) +
+            ber_encoded_integer_tlv_length(MAX_BUF_SIZE) +
+            ber_encoded_tlv_length(1) +
+            ber_encoded_integer_tlv_length(USM_SECURITY_MODEL);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the msgData, either a plaintext or an encrypted ScopedPDU
+ */
+static u16t encoded_data_length(const message_v3_t* const message, u16t input_len)
+{
+    u16t len = ber_encoded_tlv_length(encoded_scoped_pdu_length(message, input_len));
+    if (message->msgFlags & FLAG_PRIV) {
+        len = ber_encoded_tlv_length(len);
+    }
+    return len;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of a BER encoded SNMPv3 response message
+ */
+static u16t encoded_v3_response_length(const message_v3_t* const message, u16t input_len, u16t security_params_len)
+{
+    return ber_encoded_integer_tlv_length(message->version) +
+            ber_encoded_tlv_length(encoded_global_data_length(message)) +
+            security_params_len +
+            encoded_data_length(message, input_len);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Encode an SNMPv3 response message in BER
+ */
+static s8t encode_v3_response(message_v3_t* message, u8t* output, u16t* output_len, const u8t* const input, u16t input_len, const u16t max_output_len, u16t security_params_len)
+{
+    u16t pos = 0;
+    u16t scoped_pdu_pos;
+
+    /* sequence header*/
+    TRY(ber_encode_type_length(output, &pos, max_output_len, BER_TYPE_SEQUENCE, encoded_v3_response_length(message, input_len, security_params_len)));
 
-    TRY(ber_encode_fixed_string(output, &pos, message->contextName.ptr, message->contextName.len));
+    TRY(ber_encode_integer(output, &pos, max_output_len, BER_TYPE_INTEGER, message->version));
 
-    TRY(ber_encode_fixed_string(output, &pos, message->contextEngineID.ptr, message->contextEngineID.len));
+    /* msgGlobalData sequence */
+    TRY(ber_encode_type_length(output, &pos, max_output_len, BER_TYPE_SEQUENCE, encoded_global_data_length(message)));
+
+    TRY(ber_encode_integer(output, &pos, max_output_len, BER_TYPE_INTEGER, message->msgId));
+
+    TRY(ber_encode_integer(output, &pos, max_output_len, BER_TYPE_INTEGER, MAX_BUF_SIZE));
 
-    TRY(ber_encode_type_length(output, &pos, BER_TYPE_SEQUENCE, max_output_len - pos));
+    /* flags */
+    TRY(ber_encode_fixed_string(output, &pos, max_output_len, &message->msgFlags, 1));
+
+    TRY(ber_encode_integer(output, &pos, max_output_len, BER_TYPE_INTEGER, USM_SECURITY_MODEL));
 
     /* encode Security Model data */
     switch (USM_SECURITY_MODEL) {
         case USM_SECURITY_MODEL:
-            TRY(prepareOutgoingMsg_USM(message, output, max_output_len, &pos));
+            TRY(encodeSecurityParameters_USM(message, output, &pos, max_output_len));
             break;
     }
-    /* msgGlobalData sequence */
-    s16t tmpPos = pos;
-    TRY(ber_encode_integer(output, &pos, BER_TYPE_INTEGER, USM_SECURITY_MODEL));
 
-    /* flags */
-    DEC(&pos);
-    output[pos] = message->msgFlags;
-    TRY(ber_encode_type_length(output, &pos, BER_TYPE_OCTET_STRING, 1));
+    /* the encrypted ScopedPDU is wrapped into an octet string */
+    if (message->msgFlags & FLAG_PRIV) {
+        TRY(ber_encode_type_length(output, &pos, max_output_len, BER_TYPE_OCTET_STRING, ber_encoded_tlv_length(encoded_scoped_pdu_length(message, input_len))));
+    }
+    scoped_pdu_pos = pos;
 
-    TRY(ber_encode_integer(output, &pos, BER_TYPE_INTEGER, MAX_BUF_SIZE));
+    /* ScopedPDU sequence */
+    TRY(ber_encode_type_length(output, &pos, max_output_len, BER_TYPE_SEQUENCE, encoded_scoped_pdu_length(message, input_len)));
 
-    TRY(ber_encode_integer(output, &pos, BER_TYPE_INTEGER, message->msgId));
+    TRY(ber_encode_fixed_string(output, &pos, max_output_len, message->contextEngineID.ptr, message->contextEngineID.len));
 
-    TRY(ber_encode_type_length(output, &pos, BER_TYPE_SEQUENCE, tmpPos - pos));
+    TRY(ber_encode_fixed_string(output, &pos, max_output_len, message->contextName.ptr, message->contextName.len));
 
-    TRY(ber_encode_integer(output, &pos, BER_TYPE_INTEGER, message->version));
+    TRY(ber_encode_pdu(output, &pos, max_output_len, input, input_len, &message->pdu));
 
-    /* sequence header*/
-    TRY(ber_encode_type_length(output, &pos, BER_TYPE_SEQUENCE, max_output_len - pos));
-    *output_len = max_output_len - pos;
-    
-    if (message->msgFlags & FLAG_AUTH) {
-        authenticate(message, &output[pos], *output_len);
+    if (message->msgFlags & FLAG_PRIV) {
+        TRY(encryptScopedPdu_USM(message, &output[scoped_pdu_pos], pos - scoped_pdu_pos));
     }
-    if (pos > 0) {
-        memmove(output, output + pos, *output_len);
+    *output_len = pos;
+
+    if (message->msgFlags & FLAG_AUTH) {
+        authenticate(message, output, *output_len);
     }
     return 0;
 }
 
 s8t prepareResponseMessage_v3(message_v3_t* message, u8t* output, u16t* output_len, const u8t* const input, u16t input_len, const u16t max_output_len)
 {
+    u16t security_params_len = 0;
+
     message->msgFlags   &= (FLAG_AUTH | FLAG_PRIV);
     memcpy(&message->contextEngineID, getEngineID(), sizeof(ptr_t));
-    
-    if (encode_v3_response(message, output, output_len, input, input_len, max_output_len) != ERR_NO_ERROR) {
+
+    /* Security Model data */
+    switch (USM_SECURITY_MODEL) {
+        case USM_SECURITY_MODEL:
+            TRY(prepareOutgoingMsg_USM(message, &security_params_len));
+            break;
+    }
+
+    if (ber_encoded_tlv_length(encoded_v3_response_length(message, input_len, security_params_len)) > max_output_len) {
         // tooBig error
-        varbind_list_item_t*  varbind_first_ptr = message->pdu.varbind_first_ptr;
-        message->pdu.varbind_first_ptr = 0;
         message->pdu.error_status = ERROR_STATUS_TOO_BIG;
         message->pdu.error_index = 0;
-        encode_v3_response(message, output, output_len, input, input_len, max_output_len);
-        message->pdu.varbind_first_ptr = varbind_first_ptr;
+    }
+    if (encode_v3_response(message, output, output_len, input, input_len, max_output_len, security_params_len) != ERR_NO_ERROR) {
+        incSilentDrops();
+        return FAILURE;
     }
     return 0;
 }
@@ -0,0 +1,535 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#include "notification-originator.h"
+#include "ber.h"
+#include "utils.h"
+#include "logging.h"
+
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
+#include "msg-proc-v1.h"
+#endif
+
+#if ENABLE_SNMPv3
+#include "msg-proc-v3.h"
+#include "keytools.h"
+#endif
+
+#if ENABLE_NOTIFICATIONS
+
+#define UDP_IP_BUF   ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define MS_TO_TICKS(ms) ((clock_time_t)((u32t)(ms) * CLOCK_SECOND / 1000))
+
+/** \brief number of PDUs being coalesced or waiting to be sent. */
+#define NOTIFICATION_BATCHES    2
+
+#define BATCH_FREE      0
+#define BATCH_OPEN      1
+#define BATCH_CLOSED    2
+
+/** \brief A notification destination. */
+typedef struct {
+    uip_ipaddr_t addr;
+    u16t port;
+    u8t pdu_type;
+    u8t version;
+#if ENABLE_SNMPv3
+    usm_user_t* user;
+    u8t msg_flags;
+#endif
+    /* token bucket */
+    u8t tokens;
+    clock_time_t refill_time;
+} notification_target_t;
+
+/** \brief A variable binding of a pending PDU together with the storage of its oid and value. */
+typedef struct {
+    varbind_list_item_t item;
+    ptr_t oid;
+    u8t oid_buf[NOTIFICATION_OID_LENGTH];
+    u8t value_buf[NOTIFICATION_VALUE_LENGTH];
+} batch_varbind_t;
+
+/** \brief A PDU of coalesced notifications with the same snmpTrapOID. */
+typedef struct {
+    u8t state;
+    ptr_t trap_oid;
+    u8t trap_oid_buf[NOTIFICATION_OID_LENGTH];
+    batch_varbind_t varbinds[NOTIFICATION_BATCH_MAX];
+    u8t varbinds_num;
+    u16t len;
+    struct timer window;
+} batch_t;
+
+/** \brief An InformRequest awaiting its response. */
+typedef struct {
+    notification_target_t* target;
+    s32t request_id;
+    u8t retries;
+    clock_time_t timeout;
+    struct timer timer;
+    u16t len;
+    u8t data[MAX_BUF_SIZE];
+} inform_t;
+
+static notification_target_t targets[NOTIFICATION_TARGETS_MAX];
+static u8t targets_num = 0;
+static batch_t batches[NOTIFICATION_BATCHES];
+static inform_t informs[NOTIFICATION_INFORM_WINDOW];
+
+static struct uip_udp_conn* conn;
+static struct etimer timer;
+static s32t request_id = 0;
+static u8t buf[MAX_BUF_SIZE];
+
+static u32t notificationsSent = 0;
+static u32t notificationsDropped = 0;
+static u32t informsTimedOut = 0;
+
+/* the first two variable bindings of every notification */
+static u8t ber_oid_sys_up_time[]    = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00};
+static ptr_t oid_sys_up_time        = {ber_oid_sys_up_time, 8};
+static u8t ber_oid_snmp_trap_oid[]  = {0x2b, 0x06, 0x01, 0x06, 0x03, 0x01, 0x01, 0x04, 0x01, 0x00};
+static ptr_t oid_snmp_trap_oid      = {ber_oid_snmp_trap_oid, 10};
+static varbind_list_item_t header[2];
+
+PROCESS(notification_process, "SNMP notification originator");
+
+u32t getNotificationsSent()
+{
+    return notificationsSent;
+}
+
+u32t getNotificationsDropped()
+{
+    return notificationsDropped;
+}
+
+u32t getInformsTimedOut()
+{
+    return informsTimedOut;
+}
+
+s8t notification_target_add(uip_ipaddr_t* addr, const u16t port, const u8t pdu_type, const u8t version, const u8t* user_name, const u8t msg_flags)
+{
+    notification_target_t* target;
+    if (targets_num == NOTIFICATION_TARGETS_MAX ||
+            (pdu_type != BER_TYPE_SNMP_TRAP && pdu_type != BER_TYPE_SNMP_INFORM)) {
+        return FAILURE;
+    }
+    target = &targets[targets_num];
+    memset(target, 0, sizeof(notification_target_t));
+    switch (version) {
+#if ENABLE_SNMPv2c
+        case SNMP_VERSION_2C:
+            break;
+#endif
+#if ENABLE_SNMPv3
+        case SNMP_VERSION_3:
+            /* an InformRequest would need the snmpEngineID of the receiver to be discovered first */
+            if (pdu_type != BER_TYPE_SNMP_TRAP || !user_name) {
+                return FAILURE;
+            }
+            target->user = usm_user_find(user_name, strlen((char*)user_name));
+            if (!target->user || ((msg_flags & FLAG_PRIV) && !(msg_flags & FLAG_AUTH)) ||
+                    ((msg_flags & FLAG_AUTH) && target->user->auth_protocol == USM_AUTH_NONE) ||
+                    ((msg_flags & FLAG_PRIV) && target->user->priv_protocol == USM_PRIV_NONE)) {
+                return FAILURE;
+            }
+            target->msg_flags = msg_flags & (FLAG_AUTH | FLAG_PRIV);
+            break;
+#endif
+        default:
+            return FAILURE;
+    }
+    uip_ipaddr_copy(&target->addr, addr);
+    target->port = port;
+    target->pdu_type = pdu_type;
+    target->version = version;
+    target->tokens = NOTIFICATION_BURST;
+    target->refill_time = clock_time();
+    targets_num++;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Copy a variable binding into a pending PDU.
+ */
+static void batch_varbind_copy(batch_varbind_t* dest, const varbind_t* src)
+{
+    memcpy(dest->oid_buf, src->oid_ptr->ptr, src->oid_ptr->len);
+    dest->oid.ptr = dest->oid_buf;
+    dest->oid.len = src->oid_ptr->len;
+    dest->item.varbind.oid_ptr = &dest->oid;
+    dest->item.varbind.value_type = src->value_type;
+    dest->item.varbind.value = src->value;
+    switch (src->value_type) {
+        case BER_TYPE_OCTET_STRING:
+        case BER_TYPE_IPADDRESS:
+        case BER_TYPE_OPAQUE:
+        case BER_TYPE_OID:
+            memcpy(dest->value_buf, src->value.p_value.ptr, src->value.p_value.len);
+            dest->item.varbind.value.p_value.ptr = dest->value_buf;
+            break;
+        default:
+            break;
+    }
+}
+
+s8t snmp_notify(const ptr_t* trap_oid, const varbind_t* varbinds, const u8t varbinds_num)
+{
+    batch_t* batch = 0;
+    u16t len = 0;
+    u8t i;
+
+    if (trap_oid->len > NOTIFICATION_OID_LENGTH || varbinds_num > NOTIFICATION_BATCH_MAX) {
+        return FAILURE;
+    }
+    for (i = 0; i < varbinds_num; i++) {
+        if (varbinds[i].oid_ptr->len > NOTIFICATION_OID_LENGTH) {
+            return FAILURE;
+        }
+        switch (varbinds[i].value_type) {
+            case BER_TYPE_OCTET_STRING:
+            case BER_TYPE_IPADDRESS:
+            case BER_TYPE_OPAQUE:
+            case BER_TYPE_OID:
+                if (varbinds[i].value.p_value.len > NOTIFICATION_VALUE_LENGTH) {
+                    return FAILURE;
+                }
+                break;
+            default:
+                break;
+        }
+        len += ber_encoded_var_bind_length(&varbinds[i]);
+    }
+    if (len > NOTIFICATION_BATCH_LEN) {
+        return FAILURE;
+    }
+
+    /* append to the open PDU of the same notification if it has room, otherwise close it */
+    for (i = 0; i < NOTIFICATION_BATCHES; i++) {
+        if (batches[i].state == BATCH_OPEN) {
+            if (batches[i].trap_oid.len == trap_oid->len && !memcmp(batches[i].trap_oid.ptr, trap_oid->ptr, trap_oid->len) &&
+                    batches[i].varbinds_num + varbinds_num <= NOTIFICATION_BATCH_MAX &&
+                    batches[i].len + len <= NOTIFICATION_BATCH_LEN) {
+                batch = &batches[i];
+            } else {
+                batches[i].state = BATCH_CLOSED;
+            }
+        }
+    }
+    /* or open a new one */
+    for (i = 0; !batch && i < NOTIFICATION_BATCHES; i++) {
+        if (batches[i].state == BATCH_FREE) {
+            batch = &batches[i];
+            memcpy(batch->trap_oid_buf, trap_oid->ptr, trap_oid->len);
+            batch->trap_oid.ptr = batch->trap_oid_buf;
+            batch->trap_oid.len = trap_oid->len;
+            batch->varbinds_num = 0;
+            batch->len = 0;
+            timer_set(&batch->window, MS_TO_TICKS(NOTIFICATION_BATCH_WINDOW));
+            batch->state = BATCH_OPEN;
+        }
+    }
+    /* closed PDUs are sent by the notification process, it also rearms its timer */
+    process_poll(&notification_process);
+    if (!batch) {
+        snmp_log("no room for a notification\n");
+        notificationsDropped++;
+        return FAILURE;
+    }
+
+    for (i = 0; i < varbinds_num; i++) {
+        batch_varbind_copy(&batch->varbinds[batch->varbinds_num], &varbinds[i]);
+        if (batch->varbinds_num) {
+            batch->varbinds[batch->varbinds_num - 1].item.next_ptr = &batch->varbinds[batch->varbinds_num].item;
+        }
+        batch->varbinds[batch->varbinds_num].item.next_ptr = 0;
+        batch->varbinds_num++;
+    }
+    batch->len += len;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Refill the bucket of the destination, returns 0 if it is empty.
+ * The token is taken once the PDU has been encoded.
+ */
+static u8t has_token(notification_target_t* target)
+{
+    clock_time_t now = clock_time();
+    while (target->tokens < NOTIFICATION_BURST && now - target->refill_time >= MS_TO_TICKS(NOTIFICATION_TOKEN_INTERVAL)) {
+        target->tokens++;
+        target->refill_time += MS_TO_TICKS(NOTIFICATION_TOKEN_INTERVAL);
+    }
+    if (target->tokens == NOTIFICATION_BURST) {
+        target->refill_time = now;
+    }
+    return target->tokens != 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Encode a PDU for a destination.
+ */
+static s8t notification_encode(batch_t* batch, notification_target_t* target, const s32t id, u8t* output, u16t* output_len)
+{
+    pdu_t* pdu;
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
+    message_t message;
+#endif
+#if ENABLE_SNMPv3
+    message_v3_t message_v3;
+    u8t auth_params[12];
+    u8t priv_params[8];
+#endif
+
+    header[0].varbind.oid_ptr = &oid_sys_up_time;
+    header[0].varbind.value_type = BER_TYPE_TIME_TICKS;
+    header[0].varbind.value.u_value = clock_seconds() * 100;
+    header[0].next_ptr = &header[1];
+    header[1].varbind.oid_ptr = &oid_snmp_trap_oid;
+    header[1].varbind.value_type = BER_TYPE_OID;
+    header[1].varbind.value.p_value = batch->trap_oid;
+    header[1].next_ptr = batch->varbinds_num ? &batch->varbinds[0].item : 0;
+
+    switch (target->version) {
+#if ENABLE_SNMPv1 || ENABLE_SNMPv2c
+        case SNMP_VERSION_2C:
+            memset(&message, 0, sizeof(message_t));
+            message.version = SNMP_VERSION_2C;
+            pdu = &message.pdu;
+            pdu->response_type = target->pdu_type;
+            pdu->request_id = id;
+            pdu->varbind_first_ptr = &header[0];
+            TRY(prepareResponseMessage_v1(&message, output, output_len, 0, 0, MAX_BUF_SIZE));
+            break;
+#endif
+#if ENABLE_SNMPv3
+        case SNMP_VERSION_3:
+            memset(&message_v3, 0, sizeof(message_v3_t));
+            message_v3.version = SNMP_VERSION_3;
+            message_v3.msgId = id;
+            message_v3.msgFlags = target->msg_flags;
+            message_v3.user = target->user;
+            message_v3.msgUserName.ptr = target->user->name;
+            message_v3.msgUserName.len = target->user->name_len;
+            if (target->msg_flags & FLAG_AUTH) {
+                memset(auth_params, 0, sizeof(auth_params));
+                message_v3.msgAuthenticationParameters.ptr = auth_params;
+                message_v3.msgAuthenticationParameters.len = sizeof(auth_params);
+            }
+            if (target->msg_flags & FLAG_PRIV) {
+                message_v3.msgPrivacyParameters.ptr = priv_params;
+                message_v3.msgPrivacyParameters.len = sizeof(priv_params);
+            }
+            pdu = &message_v3.pdu;
+            pdu->response_type = target->pdu_type;
+            pdu->request_id = id;
+            pdu->varbind_first_ptr = &header[0];
+            TRY(prepareResponseMessage_v3(&message_v3, output, output_len, 0, 0, MAX_BUF_SIZE));
+            break;
+#endif
+        default:
+            return FAILURE;
+    }
+    /* the variable bindings have been replaced with tooBig */
+    if (pdu->error_status != ERROR_STATUS_NO_ERROR) {
+        return FAILURE;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Send a PDU to every destination.
+ */
+static void batch_send(batch_t* batch)
+{
+    notification_target_t* target;
+    inform_t* inform;
+    u16t len;
+    u8t i, j;
+
+    for (i = 0; i < targets_num; i++) {
+        target = &targets[i];
+        inform = 0;
+        if (target->pdu_type == BER_TYPE_SNMP_INFORM) {
+            for (j = 0; !inform && j < NOTIFICATION_INFORM_WINDOW; j++) {
+                if (!informs[j].target) {
+                    inform = &informs[j];
+                }
+            }
+            if (!inform) {
+                snmp_log("the inform window is full\n");
+                notificationsDropped++;
+                continue;
+            }
+        }
+        if (!has_token(target)) {
+            snmp_log("notification rate limit exceeded\n");
+            notificationsDropped++;
+            continue;
+        }
+        request_id++;
+        if (inform) {
+            if (notification_encode(batch, target, request_id, inform->data, &inform->len) != ERR_NO_ERROR) {
+                notificationsDropped++;
+                continue;
+            }
+            target->tokens--;
+            inform->target = target;
+            inform->request_id = request_id;
+            inform->retries = 0;
+            inform->timeout = MS_TO_TICKS(NOTIFICATION_INFORM_TIMEOUT);
+            timer_set(&inform->timer, inform->timeout);
+            uip_udp_packet_sendto(conn, inform->data, inform->len, &target->addr, UIP_HTONS(target->port));
+        } else {
+            if (notification_encode(batch, target, request_id, buf, &len) != ERR_NO_ERROR) {
+                notificationsDropped++;
+                continue;
+            }
+            target->tokens--;
+            uip_udp_packet_sendto(conn, buf, len, &target->addr, UIP_HTONS(target->port));
+        }
+        notificationsSent++;
+    }
+    batch->state = BATCH_FREE;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Release the InformRequest acknowledged by an incoming Response-PDU.
+ */
+static void response_handler()
+{
+    u8t* input = (u8t*)uip_appdata;
+    u16t len = uip_datalen(), pos = 0, length;
+    u8t type, i;
+    s32t version, id;
+    ptr_t community;
+
+    if (ber_decode_sequence(input, len, &pos) != ERR_NO_ERROR ||
+            ber_decode_integer(input, len, &pos, &version) != ERR_NO_ERROR || version != SNMP_VERSION_2C ||
+            ber_decode_string(input, len, &pos, &community.ptr, &community.len) != ERR_NO_ERROR ||
+            ber_decode_type_length(input, len, &pos, &type, &length) != ERR_NO_ERROR || type != BER_TYPE_SNMP_RESPONSE ||
+            ber_decode_integer(input, len, &pos, &id) != ERR_NO_ERROR) {
+        return;
+    }
+    for (i = 0; i < NOTIFICATION_INFORM_WINDOW; i++) {
+        if (informs[i].target && informs[i].request_id == id &&
+                uip_ipaddr_cmp(&informs[i].target->addr, &UDP_IP_BUF->srcipaddr)) {
+            informs[i].target = 0;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Send the PDUs whose window has expired, retransmit the InformRequests that timed out
+ * and rearm the timer for the next deadline.
+ */
+static void notification_run()
+{
+    clock_time_t next = 0, remaining;
+    u8t i, pending = 0;
+
+    for (i = 0; i < NOTIFICATION_BATCHES; i++) {
+        if (batches[i].state == BATCH_OPEN && timer_expired(&batches[i].window)) {
+            batches[i].state = BATCH_CLOSED;
+        }
+        if (batches[i].state == BATCH_CLOSED) {
+            batch_send(&batches[i]);
+        }
+    }
+
+    for (i = 0; i < NOTIFICATION_INFORM_WINDOW; i++) {
+        if (informs[i].target && timer_expired(&informs[i].timer)) {
+            if (informs[i].retries == NOTIFICATION_INFORM_RETRIES) {
+                snmp_log("inform %d timed out\n", informs[i].request_id);
+                informsTimedOut++;
+                informs[i].target = 0;
+            } else {
+                informs[i].retries++;
+                informs[i].timeout *= 2;
+                timer_set(&informs[i].timer, informs[i].timeout);
+                uip_udp_packet_sendto(conn, informs[i].data, informs[i].len, &informs[i].target->addr, UIP_HTONS(informs[i].target->port));
+            }
+        }
+    }
+
+    /* the earliest deadline */
+    for (i = 0; i < NOTIFICATION_BATCHES; i++) {
+        if (batches[i].state == BATCH_OPEN) {
+            remaining = timer_expired(&batches[i].window) ? 0 : timer_remaining(&batches[i].window);
+            if (!pending || remaining < next) {
+                next = remaining;
+            }
+            pending = 1;
+        }
+    }
+    for (i = 0; i < NOTIFICATION_INFORM_WINDOW; i++) {
+        if (informs[i].target) {
+            remaining = timer_expired(&informs[i].timer) ? 0 : timer_remaining(&informs[i].timer);
+            if (!pending || remaining < next) {
+                next = remaining;
+            }
+            pending = 1;
+        }
+    }
+    if (pending) {
+        etimer_set(&timer, next ? next : 1);
+    } else {
+        etimer_stop(&timer);
+    }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ *  Entry point of the notification originator.
+ */
+PROCESS_THREAD(notification_process, ev, data)
+{
+    PROCESS_BEGIN();
+
+    conn = udp_new(NULL, UIP_HTONS(0), NULL);
+
+    while (1) {
+        PROCESS_WAIT_EVENT();
+        if (ev == tcpip_event && uip_newdata()) {
+            response_handler();
+        } else if (ev == PROCESS_EVENT_POLL || (ev == PROCESS_EVENT_TIMER && data == &timer)) {
+            notification_run();
+        }
+    }
+    PROCESS_END();
+}
+
+#endif /* ENABLE_NOTIFICATIONS */
@@ -0,0 +1,82 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         Notification Originator application, sends SNMPv2-Trap and InformRequest PDUs.
+ *         Notifications raised within NOTIFICATION_BATCH_WINDOW are coalesced into one PDU,
+ *         every destination is rate limited by a token bucket and unacknowledged
+ *         InformRequests are retransmitted from a bounded window.
+ */
+
+#ifndef __NOTIFICATION_ORIGINATOR_H__
+#define __NOTIFICATION_ORIGINATOR_H__
+
+#include "contiki-net.h"
+
+#include "snmp.h"
+
+#if ENABLE_NOTIFICATIONS
+
+/** \brief Notification originator process. */
+PROCESS_NAME(notification_process);
+
+/**
+ * \brief Adds a notification destination.
+ * \param addr          address of the notification receiver.
+ * \param port          UDP port of the notification receiver, in host byte order.
+ * \param pdu_type      BER_TYPE_SNMP_TRAP or BER_TYPE_SNMP_INFORM.
+ * \param version       SNMP_VERSION_2C, or SNMP_VERSION_3 for traps.
+ * \param user_name     USM user of an SNMPv3 destination, 0 for SNMPv2c.
+ * \param msg_flags     FLAG_AUTH and FLAG_PRIV of an SNMPv3 destination.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t notification_target_add(uip_ipaddr_t* addr, const u16t port, const u8t pdu_type, const u8t version, const u8t* user_name, const u8t msg_flags);
+
+/**
+ * \brief Raises a notification. The variable bindings are appended to the pending PDU
+ *        of the same snmpTrapOID, which is sent NOTIFICATION_BATCH_WINDOW milliseconds
+ *        after its first notification or as soon as it is full.
+ * \param trap_oid      BER encoded snmpTrapOID of the notification.
+ * \param varbinds      variable bindings of the notification, they are copied.
+ * \param varbinds_num  number of variable bindings.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t snmp_notify(const ptr_t* trap_oid, const varbind_t* varbinds, const u8t varbinds_num);
+
+/**
+ * \brief The number of notification PDUs sent, retransmissions excluded.
+ */
+u32t getNotificationsSent();
+
+/**
+ * \brief The number of notification PDUs dropped by the rate limiter or because the inform window was full.
+ */
+u32t getNotificationsDropped();
+
+/**
+ * \brief The number of InformRequests that were not acknowledged after all retransmissions.
+ */
+u32t getInformsTimedOut();
+
+#endif /* ENABLE_NOTIFICATIONS */
+
+#endif /* __NOTIFICATION_ORIGINATOR_H__ */
@@ -0,0 +1,152 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+#include "sha1.h"
+
+/**
+ *  SHA-1 implementation following FIPS 180-2.
+ */
+
+#if ENABLE_SNMPv3 && ENABLE_AUTH && ENABLE_AUTH_SHA
+
+/* the u32t type may be wider than 32 bits on some platforms, so sums are truncated explicitly */
+#define TRUNC32(x) ((x) & 0xFFFFFFFF)
+
+/* ROTATE_LEFT rotates x left n bits */
+#define ROTATE_LEFT(x, n) TRUNC32(((x) << (n)) | (TRUNC32(x) >> (32 - (n))))
+
+/* Basic SHA-1 step. Transform state based on one 64-byte block.
+ */
+static void Transform (u32t *state, const u8t *block)
+{
+  u32t w[16];
+  u32t a, b, c, d, e, f, k, tmp;
+  u8t i;
+
+  for (i = 0; i < 16; i++) {
+    w[i] = (((u32t)block[4 * i]) << 24) |
+           (((u32t)block[4 * i + 1]) << 16) |
+           (((u32t)block[4 * i + 2]) << 8) |
+           ((u32t)block[4 * i + 3]);
+  }
+
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+
+  for (i = 0; i < 80; i++) {
+    /* the message schedule is kept in a circular buffer of 16 words */
+    if (i >= 16) {
+      w[i & 0x0F] = ROTATE_LEFT(w[(i + 13) & 0x0F] ^ w[(i + 8) & 0x0F] ^ w[(i + 2) & 0x0F] ^ w[i & 0x0F], 1);
+    }
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    tmp = TRUNC32(ROTATE_LEFT(a, 5) + f + e + k + w[i & 0x0F]);
+    e = d;
+    d = c;
+    c = ROTATE_LEFT(b, 30);
+    b = a;
+    a = tmp;
+  }
+
+  state[0] = TRUNC32(state[0] + a);
+  state[1] = TRUNC32(state[1] + b);
+  state[2] = TRUNC32(state[2] + c);
+  state[3] = TRUNC32(state[3] + d);
+  state[4] = TRUNC32(state[4] + e);
+}
+
+void SHA1Init (SHA1_CTX *context)
+{
+  context->count = 0;
+
+  /* Load magic initialization constants.
+   */
+  context->state[0] = 0x67452301;
+  context->state[1] = 0xEFCDAB89;
+  context->state[2] = 0x98BADCFE;
+  context->state[3] = 0x10325476;
+  context->state[4] = 0xC3D2E1F0;
+}
+
+void SHA1Update (SHA1_CTX *context, u8t *inBuf, u16t inLen)
+{
+  /* compute number of bytes mod 64 */
+  u8t idx = (u8t)(context->count & 0x3F);
+
+  context->count += inLen;
+
+  while (inLen--) {
+    /* add new character to buffer */
+    context->in[idx++] = *inBuf++;
+
+    /* transform if necessary */
+    if (idx == 0x40) {
+      Transform (context->state, context->in);
+      idx = 0;
+    }
+  }
+}
+
+void SHA1Final (SHA1_CTX *context, u8t* digest)
+{
+  u8t length[8];
+  u8t i;
+  u32t count = context->count;
+
+  /* save number of bits, most significant byte first */
+  length[0] = length[1] = length[2] = 0;
+  length[3] = (u8t)((count >> 29) & 0x07);
+  length[4] = (u8t)((count >> 21) & 0xFF);
+  length[5] = (u8t)((count >> 13) & 0xFF);
+  length[6] = (u8t)((count >> 5) & 0xFF);
+  length[7] = (u8t)((count << 3) & 0xFF);
+
+  /* pad out to 56 mod 64 */
+  u8t padChar = 0x80;
+  SHA1Update (context, &padChar, 1);
+  padChar = 0x00;
+  while ((context->count & 0x3F) != 56) {
+    SHA1Update (context, &padChar, 1);
+  }
+
+  /* append length in bits and transform */
+  SHA1Update (context, length, 8);
+
+  /* store state in digest */
+  for (i = 0; i < 20; i++) {
+    digest[i] = (u8t)((context->state[i >> 2] >> (8 * (3 - (i & 0x03)))) & 0xFF);
+  }
+}
+
+#endif
@@ -0,0 +1,50 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * Copyright (C) 2010 Siarhei Kuryla
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         SHA-1 hash function.
+ */
+
+#ifndef __SHA1_H__
+#define	__SHA1_H__
+
+#include "snmpd-types.h"
+#include "snmpd-conf.h"
+
+#if ENABLE_SNMPv3 && ENABLE_AUTH && ENABLE_AUTH_SHA
+
+/** \brief length of a SHA-1 digest in bytes. */
+#define SHA1_DIGEST_LENGTH 20
+
+typedef struct {
+  u32t state[5];                /* intermediate hash value */
+  u32t count;                   /* number of _bytes_ handled */
+  u8t in[64];                   /* input buffer */
+} SHA1_CTX;
+
+void SHA1Init (SHA1_CTX *context);
+void SHA1Update (SHA1_CTX *context, u8t *inBuf, u16t inLen);
+void SHA1Final (SHA1_CTX *context, u8t* digest);
+
+#endif
+
+#endif	/* __SHA1_H__ */
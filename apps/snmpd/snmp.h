@@ -79,6 +79,10 @@ typedef struct {
     u8t         error_status;
     /** \brief error index. */
     u8t         error_index;
+    /** \brief non-repeaters field of a GetBulkRequest. */
+    u8t         non_repeaters;
+    /** \brief max-repetitions field of a GetBulkRequest. */
+    u8t         max_repetitions;
     /** \brief a list of variable bindings in the SNMP request. */
     varbind_list_item_t*  varbind_first_ptr;
     /** \brief the index of the first varbind byte in the input SNMP message. 
@@ -128,6 +132,8 @@ typedef struct {
     ptr_t    msgUserName;
     ptr_t    msgAuthenticationParameters;
     ptr_t    msgPrivacyParameters;
+    /** \brief the usmUserTable entry of msgUserName, set once the user is known. */
+    struct usm_user_t* user;
 } message_v3_t;
 
 /** \brief reportableFlag bit in the msgFlags SNMPv3 message */
@@ -33,12 +33,56 @@
 
 #define ENABLE_SNMPv1   1
 
+/** \brief Enables the community-based SNMPv2c, it shares the message processing model with SNMPv1. */
+#define ENABLE_SNMPv2c  1
+
 #define ENABLE_SNMPv3   1
 
 #define ENABLE_PRIVACY  1
 
 #define ENABLE_AUTH     1
 
+/** \brief Selects the T-table AES implementation, otherwise a compact byte-oriented
+ *         AES is used that needs the 256-byte S-box only instead of 4 KB of tables. */
+#define ENABLE_AES_TABLES   1
+
+/** \brief usmNoAuthProtocol, the user does not authenticate. */
+#define USM_AUTH_NONE       0
+
+/** \brief usmHMACMD5AuthProtocol, HMAC-MD5-96 with a 16-byte localized key. */
+#define USM_AUTH_HMAC_MD5   1
+
+/** \brief usmHMACSHAAuthProtocol, HMAC-SHA-96 with a 20-byte localized key. */
+#define USM_AUTH_HMAC_SHA   2
+
+/** \brief Enables the HMAC-SHA-96 authentication protocol in addition to HMAC-MD5-96. */
+#define ENABLE_AUTH_SHA     1
+
+/** \brief authentication protocol of the default user. */
+#define USM_AUTH_PROTOCOL   USM_AUTH_HMAC_MD5
+
+/** \brief usmNoPrivProtocol, the user does not encrypt. */
+#define USM_PRIV_NONE       0
+
+/** \brief usmAesCfb128Protocol, CFB128-AES-128 with a 16-byte localized key. */
+#define USM_PRIV_AES        1
+
+/** \brief maximum number of users in the usmUserTable, including the default user. */
+#define USM_USERS_MAX           4
+
+/** \brief maximum length of a user name. */
+#define USM_USER_NAME_LENGTH    32
+
+/** \brief Loads additional users from a CFS file when the agent starts. */
+#define ENABLE_USM_USERS_FILE   1
+
+/** \brief CFS file with one user per line: <name> <md5|sha|none> [auth key] [<aes|none> [priv key]],
+ *         the keys are the localized keys in hex. */
+#define USM_USERS_FILE          "usm-users"
+
+/** \brief maximum length of a line in USM_USERS_FILE. */
+#define USM_USER_LINE_LENGTH    128
+
 /** \brief maximum length of an SNMP message. */
 #define MAX_BUF_SIZE    484
 
@@ -46,9 +90,59 @@
 
 #define CHECK_STACK_SIZE 0
 
+/** \brief Runs the known-answer tests of the AES implementation when the agent starts. */
+#define CHECK_CRYPTO 0
+
+/** \brief Processes requests in place in the uIP packet buffer and encodes the response into uip_appdata.
+ *         Messages and variable bindings are taken from fixed memb pools instead of the heap. */
+#define ENABLE_ZERO_COPY 1
+
+/** \brief number of variable bindings in the pool, it bounds the number of variable bindings in a message. */
+#define VARBIND_POOL_SIZE 16
+
+/** \brief bytes for the oids copied into a response, further oids are allocated from the heap. */
+#define OID_DATA_SIZE (VARBIND_POOL_SIZE * 16)
+
 /** \brief community string. */
 #define COMMUNITY_STRING        "public"
 
+/** \brief Enables the notification originator sending SNMPv2-Trap and InformRequest PDUs.
+ *         It takes about 2 KB of RAM and a process, so it is off unless destinations are configured. */
+#define ENABLE_NOTIFICATIONS    0
+
+/** \brief destination port of notifications. */
+#define NOTIFICATION_PORT       162
+
+/** \brief maximum number of notification destinations. */
+#define NOTIFICATION_TARGETS_MAX    2
+
+/** \brief notifications with the same snmpTrapOID raised within this many milliseconds are sent in one PDU. */
+#define NOTIFICATION_BATCH_WINDOW   500
+
+/** \brief maximum number of variable bindings of the notifications coalesced into one PDU. */
+#define NOTIFICATION_BATCH_MAX      8
+
+/** \brief maximum length of the encoded variable bindings coalesced into one PDU. */
+#define NOTIFICATION_BATCH_LEN      (MAX_BUF_SIZE - 160)
+
+/** \brief maximum length of the oid and of a string value of a notification variable binding. */
+#define NOTIFICATION_OID_LENGTH     24
+#define NOTIFICATION_VALUE_LENGTH   32
+
+/** \brief token bucket of every destination: at most NOTIFICATION_BURST PDUs at once,
+ *         then one PDU every NOTIFICATION_TOKEN_INTERVAL milliseconds. */
+#define NOTIFICATION_BURST          4
+#define NOTIFICATION_TOKEN_INTERVAL 2000
+
+/** \brief number of InformRequests awaiting a response, further informs are dropped. */
+#define NOTIFICATION_INFORM_WINDOW  2
+
+/** \brief milliseconds before an InformRequest is retransmitted, doubled on every retry. */
+#define NOTIFICATION_INFORM_TIMEOUT 1500
+
+/** \brief number of retransmissions of an InformRequest. */
+#define NOTIFICATION_INFORM_RETRIES 3
+
 #if ENABLE_SNMPv3
     u32t getMsgAuthoritativeEngineBoots();
 
@@ -32,6 +32,12 @@
 #include "mib-init.h"
 #include "logging.h"
 #include "keytools.h"
+#if ENABLE_NOTIFICATIONS
+#include "notification-originator.h"
+#endif
+#if CHECK_CRYPTO
+#include "aes.h"
+#endif
 
 #define UDP_IP_BUF   ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
@@ -69,16 +75,21 @@ u32t* marker;
 static void udp_handler(process_event_t ev, process_data_t data)
 {   
     snmp_packets++;
-    u8t response[MAX_BUF_SIZE];
     u16t resp_len;
+    #if ENABLE_ZERO_COPY
+    u16t req_len, max_len;
+    u8t* request;
+    #else
+    u8t response[MAX_BUF_SIZE];
     #if CHECK_STACK_SIZE
     memset(response, 0, sizeof(response));
     #endif
+    #endif /* ENABLE_ZERO_COPY */
 
-    #if DEBUG && CONTIKI_TARGET_AVR_RAVEN
+    #if DEBUG && CONTIKI_TARGET_AVR_RAVEN && !ENABLE_ZERO_COPY
     u8t request[MAX_BUF_SIZE];
     u16t req_len;
-    #endif /* DEBUG && CONTIKI_TARGET_AVR_RAVEN */
+    #endif /* DEBUG && CONTIKI_TARGET_AVR_RAVEN && !ENABLE_ZERO_COPY */
     if (ev == tcpip_event && uip_newdata()) {
         #if INFO
             uip_ipaddr_t ripaddr;
@@ -90,7 +101,22 @@ static void udp_handler(process_event_t ev, process_data_t data)
             udpconn->rport = UDP_IP_BUF->srcport;
         #endif
 
-        #if DEBUG && CONTIKI_TARGET_AVR_RAVEN
+        #if ENABLE_ZERO_COPY
+        /* move the request to the end of the packet buffer, the response is then
+           encoded in front of it into uip_appdata without overwriting the request */
+        req_len = uip_datalen();
+        max_len = UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPUDPH_LEN - req_len;
+        request = (u8t*)uip_appdata + max_len;
+        memmove(request, uip_appdata, req_len);
+        if (max_len > MAX_BUF_SIZE) {
+            max_len = MAX_BUF_SIZE;
+        }
+        if (dispatch(request, req_len, (u8t*)uip_appdata, &resp_len, max_len) != ERR_NO_ERROR) {
+            udpconn->rport = 0;
+            memset(&udpconn->ripaddr, 0, sizeof(udpconn->ripaddr));
+            return;
+        }
+        #elif DEBUG && CONTIKI_TARGET_AVR_RAVEN
         req_len = uip_datalen();
         memcpy(request, uip_appdata, req_len);
         if (dispatch(request, &req_len, response, resp_len, MAX_BUF_SIZE) != ERR_NO_ERROR) {
@@ -106,7 +132,7 @@ static void udp_handler(process_event_t ev, process_data_t data)
             return;
         }
 
-        #endif /* DEBUG && CONTIKI_TARGET_AVR_RAVEN */
+        #endif /* ENABLE_ZERO_COPY */
 
         #if CHECK_STACK_SIZE
         u32t *p = marker - 1;
@@ -127,7 +153,11 @@ static void udp_handler(process_event_t ev, process_data_t data)
             udpconn->rport = rport;
         #endif
 
+        #if ENABLE_ZERO_COPY
+        uip_udp_packet_send(udpconn, uip_appdata, resp_len);
+        #else
         uip_udp_packet_send(udpconn, response, resp_len);
+        #endif
         
         memset(&udpconn->ripaddr, 0, sizeof(udpconn->ripaddr));
         udpconn->rport = 0;
@@ -164,6 +194,23 @@ PROCESS_THREAD(snmpd_process, ev, data) {
 	udpconn = udp_new(NULL, UIP_HTONS(0), NULL);
 	udp_bind(udpconn, UIP_HTONS(LISTEN_PORT));
 
+        #if CHECK_CRYPTO && ENABLE_SNMPv3 && ENABLE_PRIVACY
+        if (AES_known_answer_test() != 0) {
+            snmp_log("AES known-answer test failed\n");
+        }
+        #endif
+
+        #if ENABLE_SNMPv3
+        /* init the usmUserTable */
+        if (usm_users_init() != ERR_NO_ERROR) {
+            snmp_log("error occurs while initializing the usmUserTable\n");
+        }
+        #endif
+
+        #if ENABLE_NOTIFICATIONS
+        process_start(&notification_process, NULL);
+        #endif
+
         /* init MIB */
         if (mib_init() != -1) {
             
@@ -28,7 +28,7 @@
 #include "keytools.h"
 #include "snmpd.h"
 #include "snmpd-conf.h"
-#include "md5.h"
+#include "hmac.h"
 #include "aes.h"
 #if CONTIKI_TARGET_AVR_RAVEN 
 #include "sysman.h"
@@ -44,6 +44,15 @@ int getSysUpTime() {
 
 #if ENABLE_SNMPv3
 
+/** \brief The total number of packets received by the SNMP
+ *         engine which were dropped because they requested a
+ *         securityLevel that was unknown to the SNMP engine or
+ *         otherwise unavailable.
+ */
+u8t usmStatsUnsupportedSecLevels_array[] = {0x2b, 0x06, 0x01, 0x06, 0x03, 0x0f, 0x01, 0x01, 0x01, 0x00};
+ptr_t usmStatsUnsupportedSecLevels = {usmStatsUnsupportedSecLevels_array, 10};
+u32t usmStatsUnsupportedSecLevelsCounter;
+
 /** \brief The total number of packets received by the SNMP engine
  *         which were dropped because they appeared outside of
  *         the authoritative SNMP engine's window.
@@ -147,49 +156,20 @@ static s8t report(message_v3_t* request, ptr_t* oid, u32t* counter) {
 }
 
 #if ENABLE_AUTH
-static void hmac_md5_96(u8t* input, u16t input_len, u8t* hmac)
-{
-    u8t i;
-    /* get ipad */
-    u8t pad[64];
-    memset(pad, 0, 64);
-    memcpy(pad, getAuthKul(), 16);
-    for (i = 0; i < 64; i++) {
-        pad[i] ^= 0x36;
-    }
-
-    MD5_CTX MD;
-    MD5Init (&MD);
-    MD5Update (&MD, pad, 64);
-    MD5Update (&MD, input, input_len);
-    MD5Final (&MD, hmac);
-
-    /* get opad */
-    memset(pad, 0, 64);
-    memcpy(pad, getAuthKul(), 16);
-    for (i = 0; i < 64; i++) {
-        pad[i] ^= 0x5C;
-    }
-
-    MD5Init (&MD);
-    MD5Update (&MD, pad, 64);
-    MD5Update (&MD, hmac, 16);
-    MD5Final (&MD, hmac);
-}
-
 /*
- *  Checks HMAC-MD5-96.
+ *  Checks HMAC-MD5-96 or HMAC-SHA-96.
  */
 static s8t isBadHMAC(u8t* input, u16t input_len, message_v3_t* request)
 {
-    u8t authParam[12];
-    memcpy(authParam, request->msgAuthenticationParameters.ptr, 12);
-    memset(request->msgAuthenticationParameters.ptr, 0, 12);
+    u8t authParam[HMAC_96_LENGTH];
+    u8t hmac[HMAC_96_LENGTH];
 
-    u8t hmac[16];
-    hmac_md5_96(input, input_len, hmac); 
+    memcpy(authParam, request->msgAuthenticationParameters.ptr, HMAC_96_LENGTH);
+    memset(request->msgAuthenticationParameters.ptr, 0, HMAC_96_LENGTH);
 
-    if (memcmp(authParam, hmac, 12)) {
+    hmac_96(&request->user->auth_key, input, input_len, hmac);
+
+    if (memcmp(authParam, hmac, HMAC_96_LENGTH)) {
         snmp_log("authentication failed\n");
         return ERR_USM;
     }
@@ -199,13 +179,11 @@ static s8t isBadHMAC(u8t* input, u16t input_len, message_v3_t* request)
 
 #if ENABLE_PRIVACY
 /*-----------------------------------------------------------------------------------*/
-static s8t aes_process(u8t* key, u8t* iv, u8t* input, u8t* output, u16t len, u8t mode)
+static s8t aes_process(const AES_KEY* key, u8t* iv, u8t* input, u8t* output, u16t len, u8t mode)
 {
-    AES_KEY aes_key;
     s32t new_ivlen = 0;
 
-    AES_set_encrypt_key(key, &aes_key);
-    AES_cfb128_encrypt(input, output, len, &aes_key, iv, &new_ivlen, mode);
+    AES_cfb128_encrypt(input, output, len, key, iv, &new_ivlen, mode);
     return 0;
 }
 #endif
@@ -222,11 +200,18 @@ s8t processIncomingMsg_USM(u8t* const input, const u16t input_len, u16t* pos, me
     }
 
     /* check user name */
-    if (request->msgUserName.len != strlen((char*)getUserName()) || memcmp(request->msgUserName.ptr, getUserName(), request->msgUserName.len) != 0) {
+    if (!(request->user = usm_user_find(request->msgUserName.ptr, request->msgUserName.len))) {
         TRY(report(request, &usmStatsUnknownUserNames, &usmStatsUnknownUserNamesCounter));
         return ERR_USM;
     }
 
+    /* the requested security level has to be supported by the user */
+    if (((request->msgFlags & FLAG_AUTH) && request->user->auth_protocol == USM_AUTH_NONE) ||
+            ((request->msgFlags & FLAG_PRIV) && request->user->priv_protocol == USM_PRIV_NONE)) {
+        TRY(report(request, &usmStatsUnsupportedSecLevels, &usmStatsUnsupportedSecLevelsCounter));
+        return ERR_USM;
+    }
+
     if (request->msgFlags & FLAG_AUTH) {
 #if ENABLE_AUTH
         /* The timeliness check is only performed if authentication is applied to the message */
@@ -257,7 +242,7 @@ s8t processIncomingMsg_USM(u8t* const input, const u16t input_len, u16t* pos, me
         convert_2_octets(iv + 4, request->msgAuthoritativeEngineTime);
         memcpy(iv + 8, request->msgPrivacyParameters.ptr, 8);
         /* decode the Scoped PDU */
-        aes_process(getPrivKul(), iv, input + *pos, input + *pos, input_len - *pos, AES_DECRYPT);
+        aes_process(&request->user->priv_key, iv, input + *pos, input + *pos, input_len - *pos, AES_DECRYPT);
 #else
         return FAILURE;
 #endif
@@ -265,61 +250,84 @@ s8t processIncomingMsg_USM(u8t* const input, const u16t input_len, u16t* pos, me
     return 0;
 }
 
-static s8t encode_USM_parameters(message_v3_t* message, u8t* output, u16t buf_len, s16t* pos) {
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Get the length of the content of the BER encoded UsmSecurityParameters sequence
+ */
+static u16t encoded_USM_parameters_length(const message_v3_t* const message)
+{
+    return ber_encoded_tlv_length(message->msgAuthoritativeEngineID.len) +
+            ber_encoded_integer_tlv_length(message->msgAuthoritativeEngineBoots) +
+            ber_encoded_integer_tlv_length(message->msgAuthoritativeEngineTime) +
+            ber_encoded_tlv_length(message->msgUserName.len) +
+            ber_encoded_tlv_length(message->msgAuthenticationParameters.len) +
+            ber_encoded_tlv_length(message->msgPrivacyParameters.len);
+}
+
+s8t prepareOutgoingMsg_USM(message_v3_t* message, u16t* params_len)
+{
+    memcpy(&message->msgAuthoritativeEngineID, getEngineID(), sizeof(ptr_t));
+    message->msgAuthoritativeEngineBoots    = getMsgAuthoritativeEngineBoots();
+    message->msgAuthoritativeEngineTime     = getSysUpTime()/100;
+
     if (message->msgFlags & FLAG_PRIV) {
 #if ENABLE_PRIVACY
-        u8t iv[16];
-        /* IV */
-        convert_2_octets(iv, message->msgAuthoritativeEngineBoots);
-        convert_2_octets(iv + 4, message->msgAuthoritativeEngineTime);
         /* privace parameters */
         convert_2_octets(message->msgPrivacyParameters.ptr, getLPrivacyParameters());
-        convert_2_octets(message->msgPrivacyParameters.ptr, getHPrivacyParameters());
-        memcpy(iv + 8, message->msgPrivacyParameters.ptr, 8);
-        aes_process(getPrivKul(), iv, output + *pos, output + *pos, buf_len - *pos, AES_ENCRYPT);
-        TRY(ber_encode_type_length(output, pos, BER_TYPE_OCTET_STRING, buf_len - *pos));
+        convert_2_octets(message->msgPrivacyParameters.ptr + 4, getHPrivacyParameters());
 #else
         return FAILURE;
 #endif
     }
 
-    s16t tmpPos = *pos;
-    TRY(ber_encode_fixed_string(output, pos, message->msgPrivacyParameters.ptr, message->msgPrivacyParameters.len));
+    /* the sequence is wrapped into an octet string */
+    *params_len = ber_encoded_tlv_length(ber_encoded_tlv_length(encoded_USM_parameters_length(message)));
+    return 0;
+}
 
-    TRY(ber_encode_fixed_string(output, pos, message->msgAuthenticationParameters.ptr, message->msgAuthenticationParameters.len));
-    message->msgAuthenticationParameters.ptr = &output[*pos + 2];
+s8t encodeSecurityParameters_USM(message_v3_t* message, u8t* output, u16t* pos, const u16t max_output_len)
+{
+    u16t len = encoded_USM_parameters_length(message);
 
-    TRY(ber_encode_fixed_string(output, pos, message->msgUserName.ptr, message->msgUserName.len));
+    TRY(ber_encode_type_length(output, pos, max_output_len, BER_TYPE_OCTET_STRING, ber_encoded_tlv_length(len)));
 
-    TRY(ber_encode_integer(output, pos, BER_TYPE_INTEGER, message->msgAuthoritativeEngineTime));
+    TRY(ber_encode_type_length(output, pos, max_output_len, BER_TYPE_SEQUENCE, len));
 
-    TRY(ber_encode_integer(output, pos, BER_TYPE_INTEGER, message->msgAuthoritativeEngineBoots));
+    TRY(ber_encode_fixed_string(output, pos, max_output_len, message->msgAuthoritativeEngineID.ptr, message->msgAuthoritativeEngineID.len));
 
-    TRY(ber_encode_fixed_string(output, pos, message->msgAuthoritativeEngineID.ptr, message->msgAuthoritativeEngineID.len));
+    TRY(ber_encode_integer(output, pos, max_output_len, BER_TYPE_INTEGER, message->msgAuthoritativeEngineBoots));
 
-    TRY(ber_encode_type_length(output, pos, BER_TYPE_SEQUENCE, tmpPos - *pos));
+    TRY(ber_encode_integer(output, pos, max_output_len, BER_TYPE_INTEGER, message->msgAuthoritativeEngineTime));
 
-    TRY(ber_encode_type_length(output, pos, BER_TYPE_OCTET_STRING, tmpPos - *pos));
+    TRY(ber_encode_fixed_string(output, pos, max_output_len, message->msgUserName.ptr, message->msgUserName.len));
+
+    TRY(ber_encode_fixed_string(output, pos, max_output_len, message->msgAuthenticationParameters.ptr, message->msgAuthenticationParameters.len));
+    message->msgAuthenticationParameters.ptr = &output[*pos - message->msgAuthenticationParameters.len];
+
+    TRY(ber_encode_fixed_string(output, pos, max_output_len, message->msgPrivacyParameters.ptr, message->msgPrivacyParameters.len));
 
     return 0;
 }
 
-s8t prepareOutgoingMsg_USM(message_v3_t* message, u8t* output, u16t output_len, s16t* pos)
+s8t encryptScopedPdu_USM(message_v3_t* message, u8t* scoped_pdu, u16t len)
 {
-    memcpy(&message->msgAuthoritativeEngineID, getEngineID(), sizeof(ptr_t));
-    message->msgAuthoritativeEngineBoots    = getMsgAuthoritativeEngineBoots();
-    message->msgAuthoritativeEngineTime     = getSysUpTime()/100;
-
-    encode_USM_parameters(message, output, output_len, pos);
+#if ENABLE_PRIVACY
+    u8t iv[16];
+    /* IV */
+    convert_2_octets(iv, message->msgAuthoritativeEngineBoots);
+    convert_2_octets(iv + 4, message->msgAuthoritativeEngineTime);
+    memcpy(iv + 8, message->msgPrivacyParameters.ptr, 8);
+    aes_process(&message->user->priv_key, iv, scoped_pdu, scoped_pdu, len, AES_ENCRYPT);
     return 0;
+#else
+    return FAILURE;
+#endif
 }
 
 s8t authenticate(message_v3_t* message, u8t* output, u16t output_len)
 {
 #if ENABLE_AUTH
-    u8t hmac[16];
-    hmac_md5_96(output, output_len, hmac);
-    memcpy(message->msgAuthenticationParameters.ptr, hmac, 12);
+    hmac_96(&message->user->auth_key, output, output_len, message->msgAuthenticationParameters.ptr);
 #endif
     return 0;
 }
@@ -35,7 +35,25 @@
 
 s8t processIncomingMsg_USM(u8t* const input, const u16t input_len, u16t* pos, message_v3_t* request);
 
-s8t prepareOutgoingMsg_USM(message_v3_t* message, u8t* output, u16t output_len, s16t* pos);
+/**
+ * \brief Fills in the USM fields of a response and determines the length of its msgSecurityParameters.
+ * \param message     A pointer to the response message.
+ * \param params_len  Length in bytes of the BER encoded msgSecurityParameters.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t prepareOutgoingMsg_USM(message_v3_t* message, u16t* params_len);
+
+/**
+ * \brief Writes the BER encoded msgSecurityParameters of a response.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t encodeSecurityParameters_USM(message_v3_t* message, u8t* output, u16t* pos, const u16t max_output_len);
+
+/**
+ * \brief Encrypts the BER encoded ScopedPDU of a response in place.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t encryptScopedPdu_USM(message_v3_t* message, u8t* scoped_pdu, u16t len);
 
 s8t authenticate(message_v3_t* message, u8t* output, u16t output_len);
 
@@ -25,6 +25,36 @@
 #include "utils.h"
 #include "logging.h"
 #include "ber.h"
+#include "snmpd-conf.h"
+
+#if ENABLE_ZERO_COPY
+#include "lib/memb.h"
+
+/** \brief Storage for a message of any supported version, only one request is processed at a time. */
+typedef union {
+    message_t       v1;
+#if ENABLE_SNMPv3
+    message_v3_t    v3;
+#endif
+} message_storage_t;
+
+MEMB(message_memb, message_storage_t, 1);
+
+MEMB(varbind_memb, varbind_list_item_t, VARBIND_POOL_SIZE);
+
+/* every variable binding has its oid, one more is used by the table handlers */
+MEMB(oid_memb, ptr_t, VARBIND_POOL_SIZE + 1);
+
+#define pool_alloc(memb, size)  memb_alloc(memb)
+#define pool_free(memb, ptr)    memb_free(memb, ptr)
+
+/* the oids copied into the response, released all at once when the next message is created */
+static u8t oid_data[OID_DATA_SIZE];
+static u16t oid_data_used;
+#else
+#define pool_alloc(memb, size)  malloc(size)
+#define pool_free(memb, ptr)    free(ptr)
+#endif /* ENABLE_ZERO_COPY */
 
 #if CONTIKI_TARGET_AVR_RAVEN && ENABLE_PROGMEM
 #include <avr/pgmspace.h>
@@ -34,9 +64,32 @@
 /*
  *  OID functions.
  */
+u8t* oid_data_alloc(u16t len)
+{
+    #if ENABLE_ZERO_COPY
+    u8t* ptr;
+    if (len <= OID_DATA_SIZE - oid_data_used) {
+        ptr = &oid_data[oid_data_used];
+        oid_data_used += len;
+        return ptr;
+    }
+    #endif
+    return malloc(len);
+}
+
+void oid_data_free(u8t* ptr)
+{
+    #if ENABLE_ZERO_COPY
+    if (ptr >= oid_data && ptr < oid_data + OID_DATA_SIZE) {
+        return;
+    }
+    #endif
+    free(ptr);
+}
+
 ptr_t* oid_create()
 {
-    ptr_t* new_el_ptr = malloc(sizeof(ptr_t));
+    ptr_t* new_el_ptr = pool_alloc(&oid_memb, sizeof(ptr_t));
     if (!new_el_ptr) return 0;
     new_el_ptr->len = 0;
     return new_el_ptr;
@@ -45,7 +98,7 @@ ptr_t* oid_create()
 void oid_free(ptr_t* ptr)
 {
     if (ptr) {
-        free(ptr);
+        pool_free(&oid_memb, ptr);
     }
 }
 
@@ -77,6 +130,15 @@ int oid_cmpn(ptr_t* req_oid, ptr_t*  progmem_oid, u8t len)
     #endif
 }
 
+int oid_cmp_lex(ptr_t* req_oid, ptr_t*  progmem_oid)
+{
+    u16t len = oid_length(progmem_oid);
+    int cmp = oid_cmp(req_oid, progmem_oid);
+    if (cmp) {
+        return cmp;
+    }
+    return (int)req_oid->len - (int)len;
+}
 
 s8t oid_copy(ptr_t* dest, ptr_t* src, u8t malloc_len)
 {
@@ -87,9 +149,9 @@ s8t oid_copy(ptr_t* dest, ptr_t* src, u8t malloc_len)
     #endif
 
     if (!malloc_len) {
-        dest->ptr = malloc(dest->len);
+        dest->ptr = oid_data_alloc(dest->len);
     } else {
-        dest->ptr = malloc(malloc_len);
+        dest->ptr = oid_data_alloc(malloc_len);
     }
     CHECK_PTR(dest->ptr);
     
@@ -132,7 +194,7 @@ void mib_object_list_free(mib_object_list_t* ptr)
  */
 varbind_list_item_t* varbind_list_append(varbind_list_item_t* ptr)
 {
-    varbind_list_item_t* new_el_ptr = malloc(sizeof(varbind_list_item_t));
+    varbind_list_item_t* new_el_ptr = pool_alloc(&varbind_memb, sizeof(varbind_list_item_t));
     if (!new_el_ptr) return 0;
     new_el_ptr->next_ptr = 0;
     if (ptr) {
@@ -141,6 +203,11 @@ varbind_list_item_t* varbind_list_append(varbind_list_item_t* ptr)
     return new_el_ptr;
 }
 
+void varbind_list_item_free(varbind_list_item_t* ptr)
+{
+    pool_free(&varbind_memb, ptr);
+}
+
 /*---------------------------------------------------------*/
 /*
  *  Variable binding
@@ -160,7 +227,9 @@ mib_object_t* mib_object_create()
 {
     mib_object_t* new_el_ptr = malloc(sizeof(mib_object_t));
     if (!new_el_ptr) return 0;
+    #if !MIB_SIZE
     new_el_ptr->next_ptr = 0;
+    #endif
     return new_el_ptr;
 }
 
@@ -174,20 +243,37 @@ void free_varbinds(pdu_t* pdu)
         if (pdu->response_type != BER_TYPE_SNMP_REPORT) {
             #if ENABLE_MIB_TABLE || ENABLE_PROGMEM
             /* release memory allocated while processing the request */
-            if (pdu->request_type == BER_TYPE_SNMP_GETNEXT && pdu->response_type == BER_TYPE_SNMP_RESPONSE) {
-                if ((!pdu->error_status || (pdu->error_status && i < pdu->error_index)) &&
+            if ((pdu->request_type == BER_TYPE_SNMP_GETNEXT || pdu->request_type == BER_TYPE_SNMP_GETBULK) &&
+                    pdu->response_type == BER_TYPE_SNMP_RESPONSE) {
+                if ((!pdu->error_status || pdu->error_status == ERROR_STATUS_TOO_BIG || i < pdu->error_index) &&
                         ptr->varbind.value_type != BER_TYPE_END_OF_MIB) {
-                    free(ptr->varbind.oid_ptr->ptr);
+                    oid_data_free(ptr->varbind.oid_ptr->ptr);
                 }
             }
             #endif
             oid_free(ptr->varbind.oid_ptr);
         }
         varbind_list_item_t* next_ptr = ptr->next_ptr;
-        free(ptr);
+        varbind_list_item_free(ptr);
         ptr = next_ptr;
     }
 }
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Allocate a zeroed message of the given size.
+ */
+message_t* message_create(const u16t size)
+{
+    message_t* message = pool_alloc(&message_memb, size);
+    if (!message) return 0;
+    #if ENABLE_ZERO_COPY
+    /* the oids of the previous response are no longer used */
+    oid_data_used = 0;
+    #endif
+    memset(message, 0, size);
+    return message;
+}
+
 /*-----------------------------------------------------------------------------------*/
 /*
  * Free the memory from the heap used for storing the message content.
@@ -196,7 +282,7 @@ void free_message(message_t* message)
 {
     free_varbinds(&message->pdu);
     /* free memory for string values */
-    free(message);
+    pool_free(&message_memb, message);
 }
 
 void print_array_as_hex (const u8t *digest, u8t len)
@@ -45,9 +45,8 @@
 /** \brief */
 #define TRY(c) if (c < 0) { snmp_log("exception line: %d\n", __LINE__); return FAILURE; }
 
-#define DECN(pos, value) (*pos) -= value; if (*pos < 0) { snmp_log("too big message: %d\n", __LINE__); return -1;}
-
-#define DEC(pos) DECN(pos, 1)
+/** \brief checks whether value more bytes fit into the output buffer, if not leaves the function. */
+#define CHECK_SPACE(pos, value, max_len) if ((u32t)(*pos) + (value) > (max_len)) { snmp_log("too big message: %d\n", __LINE__); return -1;}
 
 /** \brief Compares two given oids.
  *  \param progmem_oid  a pointer to the oid_t structure.
@@ -58,13 +57,34 @@ int oid_cmp(ptr_t* req_oid, ptr_t*  progmem_oid);
 
 int oid_cmpn(ptr_t* req_oid, ptr_t*  progmem_oid, u8t len);
 
+/** \brief Compares two given oids in the lexicographical order of the MIB.
+ *         An oid is less than every other oid it is a prefix of.
+ *  \param req_oid      a pointer to the oid_t structure.
+ *  \param progmem_oid  a pointer to the oid_t structure.
+  * \return 0 if two oids are equal, a negative value if the first one is less, a positive value otherwise.
+ */
+int oid_cmp_lex(ptr_t* req_oid, ptr_t*  progmem_oid);
+
 /** \brief Returns the length of the given oid. If the oid is stored in ROM, reads it from the ROM.
  *  \param oid      a pointer to the oid_t structure.
   * \return the length of the given oid.
  */
 u16t oid_length(ptr_t* oid);
 
-/** \brief Copies a given oid.
+/** \brief Allocates a buffer for the data of an oid copied into the response.
+ *         With ENABLE_ZERO_COPY it is taken from a buffer which is released when the next message is created,
+ *         the heap is used only when the buffer is full.
+ *  \param len      the length of the buffer.
+ *  \return a pointer to the buffer, or 0 if there is no memory.
+ */
+u8t* oid_data_alloc(u16t len);
+
+/** \brief Frees a buffer allocated by oid_data_alloc().
+ *  \param ptr      a pointer to the buffer.
+ */
+void oid_data_free(u8t* ptr);
+
+/** \brief Copies a given oid, the data is allocated by oid_data_alloc().
  *  \param dest         destination oid.
  *  \param src          source oid.
  *  \param malloc_len   the length of the buffer to allocate for the destination.
@@ -100,6 +120,9 @@ void mib_object_list_free(mib_object_list_t* ptr);
 /** \brief Adds an object to the variable binding list. */
 varbind_list_item_t* varbind_list_append(varbind_list_item_t* ptr);
 
+/** \brief Frees an element of the variable binding list. */
+void varbind_list_item_free(varbind_list_item_t* ptr);
+
 /** \brief creates a new variable binding */
 varbind_t* varbind_create();
 
@@ -109,6 +132,12 @@ mib_object_t* mib_object_create();
 /** \brief Releases memory from the variable bindings in a PDU. */
 void free_varbinds(pdu_t* pdu);
 
+/** \brief Creates a zeroed message.
+ *  \param size   size of the message structure of the SNMP version.
+ *  \return a pointer to the message or 0 if no memory is left.
+ */
+message_t* message_create(const u16t size);
+
 /** \brief Releases memory from the message content. */
 void free_message(message_t* message);
 
@@ -33,3 +33,10 @@ extern const char http_gif[5];
 extern const char http_jpg[5];
 extern const char http_text[6];
 extern const char http_txt[5];
+extern const char http_accept_encoding[17];
+extern const char http_gzip[5];
+extern const char http_header_200_keepalive[91];
+extern const char http_header_404_keepalive[98];
+extern const char http_connection[12];
+extern const char http_close[6];
+extern const char http_keep_alive[11];
@@ -33,6 +33,8 @@
  * $Id: httpd-fs.c,v 1.5 2008/10/14 11:07:57 adamdunkels Exp $
  */
 
+#include <string.h>
+
 #include "contiki-net.h"
 #include "httpd.h"
 #include "httpd-fs.h"
@@ -45,6 +47,7 @@ static u16_t count[HTTPD_FS_NUMFILES];
 #endif /* HTTPD_FS_STATISTICS */
 
 /*-----------------------------------------------------------------------------------*/
+#ifndef HTTPD_FS_INDEX
 static u8_t
 httpd_fs_strcmp(const char *str1, const char *str2)
 {
@@ -65,10 +68,85 @@ loop:
   ++i;
   goto loop;
 }
+#endif /* HTTPD_FS_INDEX */
+/*-----------------------------------------------------------------------------------*/
+#ifdef HTTPD_FS_INDEX
+/* The file name in a request or script ends at a NUL, CR, LF or at
+   the query string. */
+static u8_t
+httpd_fs_namelen(const char *name)
+{
+  u8_t len;
+
+  for(len = 0;
+      name[len] != 0 && name[len] != '\r' &&
+      name[len] != '\n' && name[len] != '?';
+      ++len);
+  return len;
+}
+/*-----------------------------------------------------------------------------------*/
+static int
+httpd_fs_lookup(const char *name)
+{
+  int low, high, mid, cmp;
+  u8_t len, flen;
+
+  len = httpd_fs_namelen(name);
+  low = 0;
+  high = HTTPD_FS_NUMFILES - 1;
+  while(low <= high) {
+    mid = (low + high) / 2;
+    flen = HTTPD_FS_INDEX[mid].name_len;
+    cmp = memcmp(name, HTTPD_FS_INDEX[mid].file->name, len < flen ? len : flen);
+    if(cmp == 0) {
+      cmp = (int)len - (int)flen;
+    }
+    if(cmp == 0) {
+      return mid;
+    } else if(cmp < 0) {
+      high = mid - 1;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return -1;
+}
+/*-----------------------------------------------------------------------------------*/
+static int
+httpd_fs_open_index(const char *name, struct httpd_fs_file *file, int gzip)
+{
+  const struct httpd_fsdata_index *e;
+  int i;
+
+  i = httpd_fs_lookup(name);
+  if(i < 0) {
+    return 0;
+  }
+  e = &HTTPD_FS_INDEX[i];
+  if(gzip && e->gzip != NULL) {
+    file->data = (char *)e->gzip;
+    file->len = e->gzip_len;
+    file->header = (char *)e->gzip_header;
+    file->header_len = e->gzip_header_len;
+  } else {
+    file->data = (char *)e->file->data;
+    file->len = e->len;
+    file->header = (char *)e->header;
+    file->header_len = e->header_len;
+  }
+#if HTTPD_FS_STATISTICS
+  ++count[i];
+#endif /* HTTPD_FS_STATISTICS */
+  return 1;
+}
+#endif /* HTTPD_FS_INDEX */
 /*-----------------------------------------------------------------------------------*/
 int
 httpd_fs_open(const char *name, struct httpd_fs_file *file)
 {
+#ifdef HTTPD_FS_INDEX
+  return httpd_fs_open_index(name, file, 0);
+#else /* HTTPD_FS_INDEX */
 #if HTTPD_FS_STATISTICS
   u16_t i = 0;
 #endif /* HTTPD_FS_STATISTICS */
@@ -81,6 +159,8 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
     if(httpd_fs_strcmp(name, f->name) == 0) {
       file->data = f->data;
       file->len = f->len;
+      file->header = NULL;
+      file->header_len = 0;
 #if HTTPD_FS_STATISTICS
       ++count[i];
 #endif /* HTTPD_FS_STATISTICS */
@@ -92,6 +172,17 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
 
   }
   return 0;
+#endif /* HTTPD_FS_INDEX */
+}
+/*-----------------------------------------------------------------------------------*/
+int
+httpd_fs_open_gzip(const char *name, struct httpd_fs_file *file)
+{
+#ifdef HTTPD_FS_INDEX
+  return httpd_fs_open_index(name, file, 1);
+#else /* HTTPD_FS_INDEX */
+  return httpd_fs_open(name, file);
+#endif /* HTTPD_FS_INDEX */
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -109,6 +200,12 @@ httpd_fs_init(void)
 u16_t
 httpd_fs_count(char *name)
 {
+#ifdef HTTPD_FS_INDEX
+  int i;
+
+  i = httpd_fs_lookup(name);
+  return i < 0 ? 0 : count[i];
+#else /* HTTPD_FS_INDEX */
   struct httpd_fsdata_file_noconst *f;
   u16_t i;
 
@@ -123,6 +220,7 @@ httpd_fs_count(char *name)
     ++i;
   }
   return 0;
+#endif /* HTTPD_FS_INDEX */
 }
 #endif /* HTTPD_FS_STATISTICS */
 /*-----------------------------------------------------------------------------------*/
@@ -42,12 +42,20 @@
 struct httpd_fs_file {
   char *data;
   int len;
+  /* Precomputed header block that follows the status line, or NULL
+     if the file system has no index. */
+  char *header;
+  int header_len;
 };
 
 /* file must be allocated by caller and will be filled in
    by the function. */
 int httpd_fs_open(const char *name, struct httpd_fs_file *file);
 
+/* As httpd_fs_open(), but opens the gzip variant of the file if
+   there is one. The header block then carries the encoding. */
+int httpd_fs_open_gzip(const char *name, struct httpd_fs_file *file);
+
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1  
 u16_t httpd_fs_count(char *name);
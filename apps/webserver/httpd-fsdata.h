@@ -61,4 +61,17 @@ struct httpd_fsdata_file_noconst {
 #endif /* HTTPD_FS_STATISTICS */
 };
 
+/* Entry of the index that makefsdata -x appends, sorted by name. */
+struct httpd_fsdata_index {
+  const struct httpd_fsdata_file *file;
+  const unsigned char name_len;
+  const int len;
+  const char *header;
+  const unsigned short header_len;
+  const char *gzip;
+  const int gzip_len;
+  const char *gzip_header;
+  const unsigned short gzip_header_len;
+};
+
 #endif /* __HTTPD_FSDATA_H__ */
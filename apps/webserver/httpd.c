@@ -37,6 +37,7 @@
 #include <string.h>
 
 #include "contiki-net.h"
+#include "lib/list.h"
 
 #include "webserver.h"
 #include "httpd-fs.h"
@@ -55,10 +56,17 @@
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+/* The request being read, behind those that wait for their response.
+   Locals do not keep their value across a blocking protothread call,
+   but head + pending stays the same while responses go out. */
+#define NEXT_REQUEST(s) (&(s)->requests[((s)->head + (s)->pending) % HTTPD_PIPELINE])
+
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
+LIST(states);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
 #define ISO_percent 0x25
@@ -182,6 +190,19 @@ PT_THREAD(handle_script(struct httpd_state *s))
   PT_END(&s->scriptpt);
 }
 /*---------------------------------------------------------------------------*/
+static unsigned short
+generate_headers(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  unsigned short len;
+
+  len = (unsigned short)strlen(s->statushdr);
+  memcpy(uip_appdata, s->statushdr, len);
+  memcpy((char *)uip_appdata + len, s->file.header, s->file.header_len);
+
+  return len + s->file.header_len;
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 {
@@ -192,6 +213,19 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 
   PSOCK_BEGIN(&s->sout);
 
+  /* The index of the file system has the header block of the file
+     ready, so the whole header goes out in one segment. */
+  if(s->file.header != NULL) {
+    s->statushdr = statushdr;
+    if(strlen(statushdr) + s->file.header_len <= uip_mss()) {
+      PSOCK_GENERATOR_SEND(&s->sout, generate_headers, s);
+    } else {
+      SEND_STRING(&s->sout, statushdr);
+      PSOCK_SEND(&s->sout, (uint8_t *)s->file.header, s->file.header_len);
+    }
+    PSOCK_EXIT(&s->sout);
+  }
+
   SEND_STRING(&s->sout, statushdr);
 
   ptr = strrchr(s->filename, ISO_period);
@@ -215,74 +249,234 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+static int
+open_file(struct httpd_state *s)
+{
+  if(s->gzip) {
+    return httpd_fs_open_gzip(s->filename, &s->file);
+  }
+  return httpd_fs_open(s->filename, &s->file);
+}
+/*---------------------------------------------------------------------------*/
+static const char *
+status_header(struct httpd_state *s, int found)
+{
+  char *ptr;
+
+  /* Another response can only follow on the connection if the client
+     can tell where this one ends, which the Content-Length of the
+     precomputed header block does. Script output has no length. */
+  ptr = strrchr(s->filename, ISO_period);
+  if(s->file.header == NULL || s->closing ||
+     (ptr != NULL && strncmp(ptr, http_shtml, 6) == 0)) {
+    s->keepalive = 0;
+  }
+  if(s->keepalive) {
+    return found ? http_header_200_keepalive : http_header_404_keepalive;
+  }
+  return found ? http_header_200 : http_header_404;
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
   char *ptr;
   
   PT_BEGIN(&s->outputpt);
- 
-  if(!httpd_fs_open(s->filename, &s->file)) {
-    strcpy(s->filename, http_404_html);
-    httpd_fs_open(s->filename, &s->file);
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_404));
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_file(s));
-  } else {
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_200));
-    ptr = strrchr(s->filename, ISO_period);
-    if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
-      PT_INIT(&s->scriptpt);
-      PT_WAIT_THREAD(&s->outputpt, handle_script(s));
-    } else {
+
+  while(1) {
+    PT_WAIT_UNTIL(&s->outputpt, s->pending > 0);
+
+    memcpy(s->filename, s->requests[s->head].filename, sizeof(s->filename));
+    s->gzip = s->requests[s->head].gzip;
+    s->keepalive = s->requests[s->head].keepalive;
+
+    if(!open_file(s)) {
+      strcpy(s->filename, http_404_html);
+      open_file(s);
+      s->statushdr = status_header(s, 0);
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s,
+		     s->statushdr));
       PT_WAIT_THREAD(&s->outputpt,
 		     send_file(s));
+    } else {
+      s->statushdr = status_header(s, 1);
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s,
+		     s->statushdr));
+      ptr = strrchr(s->filename, ISO_period);
+      if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
+	PT_INIT(&s->scriptpt);
+	PT_WAIT_THREAD(&s->outputpt, handle_script(s));
+      } else {
+	PT_WAIT_THREAD(&s->outputpt,
+		       send_file(s));
+      }
+    }
+
+    if(!s->keepalive || (s->closing && s->pending == 1)) {
+      s->closing = 1;
+      s->state = STATE_WAITING;
+      PSOCK_CLOSE(&s->sout);
+      PT_EXIT(&s->outputpt);
+    }
+
+    s->head = (s->head + 1) % HTTPD_PIPELINE;
+    if(--s->pending == 0) {
+      s->state = STATE_WAITING;
+      s->idle = 1;
+      s->idle_since = clock_time();
     }
   }
-  PSOCK_CLOSE(&s->sout);
+
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
+static void
+lowercase(char *str)
+{
+  for(; *str != 0; ++str) {
+    if(*str >= 'A' && *str <= 'Z') {
+      *str += 'a' - 'A';
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Tells whether a lowercased Accept-Encoding value takes gzip: gzip
+   is listed, or "*" is and gzip is not, with a q-value other than 0. */
+static int
+accepts_gzip(const char *str)
+{
+  int gzip = -1, any = -1, zero;
+  const char *coding;
+  size_t len;
+
+  while(*str != 0) {
+    while(*str == ' ' || *str == '\t' || *str == ',') {
+      ++str;
+    }
+    coding = str;
+    while(*str != 0 && *str != ',' && *str != ';' &&
+          *str != ' ' && *str != '\t' && *str != ISO_cr && *str != ISO_nl) {
+      ++str;
+    }
+    len = str - coding;
+
+    /* the q-value is 0 when it is "0" followed by zeros alone */
+    zero = 0;
+    while(*str != 0 && *str != ',') {
+      if(*str == 'q' && str[1] == '=') {
+        str += 2;
+        zero = *str == '0';
+        if(zero) {
+          for(++str; *str == '.' || *str == '0'; ++str);
+          zero = !(*str >= '1' && *str <= '9');
+        }
+      } else {
+        ++str;
+      }
+    }
+
+    if(len == 4 && strncmp(coding, http_gzip, 4) == 0) {
+      gzip = !zero;
+    } else if(len == 1 && *coding == '*') {
+      any = !zero;
+    }
+  }
+
+  return gzip >= 0 ? gzip : any > 0;
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
+  struct httpd_request *r;
+  unsigned short len;
+
   PSOCK_BEGIN(&s->sin);
 
-  PSOCK_READTO(&s->sin, ISO_space);
-  
-  if(strncmp(s->inputbuf, http_get, 4) != 0) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
-  PSOCK_READTO(&s->sin, ISO_space);
+  while(1) {
+    PSOCK_READTO(&s->sin, ISO_space);
 
-  if(s->inputbuf[0] != ISO_slash) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
+    if(strncmp(s->inputbuf, http_get, 4) != 0 ||
+       s->pending == HTTPD_PIPELINE) {
+      /* Answer what is queued and then close. */
+      if(s->pending == 0) {
+	PSOCK_CLOSE_EXIT(&s->sin);
+      }
+      s->closing = 1;
+      PSOCK_EXIT(&s->sin);
+    }
+    PSOCK_READTO(&s->sin, ISO_space);
 
-  if(s->inputbuf[1] == ISO_space) {
-    strncpy(s->filename, http_index_html, sizeof(s->filename));
-  } else {
-    s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-    strncpy(s->filename, s->inputbuf, sizeof(s->filename));
-  }
+    if(s->inputbuf[0] != ISO_slash) {
+      if(s->pending == 0) {
+	PSOCK_CLOSE_EXIT(&s->sin);
+      }
+      s->closing = 1;
+      PSOCK_EXIT(&s->sin);
+    }
 
-  petsciiconv_topetscii(s->filename, sizeof(s->filename));
-  webserver_log_file(&uip_conn->ripaddr, s->filename);
-  petsciiconv_toascii(s->filename, sizeof(s->filename));
-  s->state = STATE_OUTPUT;
+    r = NEXT_REQUEST(s);
+    if(s->inputbuf[1] == ISO_space) {
+      strncpy(r->filename, http_index_html, sizeof(r->filename) - 1);
+      r->filename[sizeof(r->filename) - 1] = 0;
+    } else {
+      /* The name ends at the space the read stopped at. */
+      len = PSOCK_DATALEN(&s->sin) - 1;
+      if(len > sizeof(r->filename) - 1) {
+	len = sizeof(r->filename) - 1;
+      }
+      memcpy(r->filename, s->inputbuf, len);
+      r->filename[len] = 0;
+    }
 
-  while(1) {
+    petsciiconv_topetscii(r->filename, sizeof(r->filename));
+    webserver_log_file(&uip_conn->ripaddr, r->filename);
+    petsciiconv_toascii(r->filename, sizeof(r->filename));
+
+    /* HTTP/1.1 keeps the connection unless the client says otherwise,
+       HTTP/1.0 only when the client asks for it. */
     PSOCK_READTO(&s->sin, ISO_nl);
+    r = NEXT_REQUEST(s);
+    r->gzip = 0;
+    r->keepalive = HTTPD_KEEPALIVE && strncmp(s->inputbuf, http_11, 8) == 0;
+
+    /* The response starts at the empty line that ends the request
+       headers, once it is known whether the client takes gzip. Of a
+       line longer than the input buffer only the start is kept, the
+       rest up to its end is dropped by the read, so a line that
+       consists of CR LF alone is the empty line. */
+    while(1) {
+      PSOCK_READTO(&s->sin, ISO_nl);
+      r = NEXT_REQUEST(s);
 
-    if(strncmp(s->inputbuf, http_referer, 8) == 0) {
-      s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
-      petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
-      webserver_log(s->inputbuf);
+      if((PSOCK_DATALEN(&s->sin) == 1 && s->inputbuf[0] == ISO_nl) ||
+	 (PSOCK_DATALEN(&s->sin) == 2 && s->inputbuf[0] == ISO_cr &&
+	  s->inputbuf[1] == ISO_nl)) {
+	break;
+      } else if(strncmp(s->inputbuf, http_referer, 8) == 0) {
+	s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
+	petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
+	webserver_log(s->inputbuf);
+      } else if(strncmp(s->inputbuf, http_accept_encoding, 16) == 0) {
+	s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
+	lowercase(s->inputbuf + 16);
+	r->gzip = accepts_gzip(s->inputbuf + 16);
+      } else if(strncmp(s->inputbuf, http_connection, 11) == 0) {
+	s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
+	lowercase(s->inputbuf + 11);
+	if(strstr(s->inputbuf + 11, http_close) != NULL) {
+	  r->keepalive = 0;
+	} else if(strstr(s->inputbuf + 11, http_keep_alive) != NULL) {
+	  r->keepalive = HTTPD_KEEPALIVE;
+	}
+      }
     }
+
+    ++s->pending;
+    s->state = STATE_OUTPUT;
   }
   
   PSOCK_END(&s->sin);
@@ -291,12 +485,45 @@ PT_THREAD(handle_input(struct httpd_state *s))
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
+  if(!s->closing) {
+    handle_input(s);
+  }
   if(s->state == STATE_OUTPUT) {
     handle_output(s);
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+free_state(struct httpd_state *s)
+{
+  list_remove(states, s);
+  memb_free(&conns, s);
+}
+/*---------------------------------------------------------------------------*/
+static struct httpd_state *
+evict_idle(void)
+{
+  struct httpd_state *s, *oldest;
+
+  /* Take the state of the connection that has waited the longest for
+     its next request. That connection is polled right away and then
+     closed, since it no longer has a state. */
+  oldest = NULL;
+  for(s = list_head(states); s != NULL; s = list_item_next(s)) {
+    if(s->idle &&
+       (oldest == NULL ||
+	(clock_time_t)(clock_time() - s->idle_since) >
+	(clock_time_t)(clock_time() - oldest->idle_since))) {
+      oldest = s;
+    }
+  }
+  if(oldest != NULL) {
+    tcp_markconn(oldest->conn, NULL);
+    tcpip_poll_tcp(oldest->conn);
+  }
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
 void
 httpd_appcall(void *state)
 {
@@ -304,19 +531,28 @@ httpd_appcall(void *state)
 
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
-      memb_free(&conns, s);
+      free_state(s);
     }
   } else if(uip_connected()) {
     s = (struct httpd_state *)memb_alloc(&conns);
-    if(s == NULL) {
-      uip_abort();
-      return;
+    if(s != NULL) {
+      list_add(states, s);
+    } else {
+      s = evict_idle();
+      if(s == NULL) {
+	uip_abort();
+	return;
+      }
     }
     tcp_markconn(uip_conn, s);
+    s->conn = uip_conn;
     PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
+    s->head = s->pending = 0;
+    s->closing = 0;
+    s->idle = 0;
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
     handle_connection(s);
@@ -325,14 +561,25 @@ httpd_appcall(void *state)
       ++s->timer;
       if(s->timer >= 20) {
 	uip_abort();
-	memb_free(&conns, s);
+	free_state(s);
+	return;
+      }
+      if(s->idle && clock_time() - s->idle_since >= HTTPD_IDLE_TIMEOUT) {
+	s->idle = 0;
+	s->closing = 1;
+	uip_close();
+	return;
       }
     } else {
       s->timer = 0;
+      if(uip_newdata()) {
+	s->idle = 0;
+      }
     }
     handle_connection(s);
   } else {
-    uip_abort();
+    /* The state was given to another connection. */
+    uip_close();
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -341,6 +588,7 @@ httpd_init(void)
 {
   tcp_listen(UIP_HTONS(80));
   memb_init(&conns);
+  list_init(states);
   httpd_cgi_init();
 }
 #if UIP_CONF_IPV6
@@ -39,13 +39,47 @@
 #include "contiki-net.h"
 #include "httpd-fs.h"
 
+#ifndef WEBSERVER_CONF_KEEPALIVE
+#define HTTPD_KEEPALIVE 1
+#else /* WEBSERVER_CONF_KEEPALIVE */
+#define HTTPD_KEEPALIVE WEBSERVER_CONF_KEEPALIVE
+#endif /* WEBSERVER_CONF_KEEPALIVE */
+
+/* Number of requests a connection can have outstanding. Pipelined
+   requests beyond these are not answered and the connection is
+   closed after the responses to the queued ones. */
+#ifndef WEBSERVER_CONF_PIPELINE
+#define HTTPD_PIPELINE (HTTPD_KEEPALIVE ? 2 : 1)
+#else /* WEBSERVER_CONF_PIPELINE */
+#define HTTPD_PIPELINE WEBSERVER_CONF_PIPELINE
+#endif /* WEBSERVER_CONF_PIPELINE */
+
+/* A connection kept alive is closed when it has had no request for
+   this long, and it may be reused for a new connection before that
+   when all connection states are taken. */
+#ifndef WEBSERVER_CONF_IDLE_TIMEOUT
+#define HTTPD_IDLE_TIMEOUT (CLOCK_SECOND * 5)
+#else /* WEBSERVER_CONF_IDLE_TIMEOUT */
+#define HTTPD_IDLE_TIMEOUT WEBSERVER_CONF_IDLE_TIMEOUT
+#endif /* WEBSERVER_CONF_IDLE_TIMEOUT */
+
+struct httpd_request {
+  char filename[20];
+  char gzip;
+  char keepalive;
+};
+
 struct httpd_state {
+  struct httpd_state *next;
   unsigned char timer;
   struct psock sin, sout;
   struct pt outputpt, scriptpt;
   char inputbuf[50];
   char filename[20];
   char state;
+  char gzip;
+  char keepalive;
+  const char *statushdr;
   struct httpd_fs_file file;  
   int len;
   char *scriptptr;
@@ -54,6 +88,12 @@ struct httpd_state {
     unsigned short count;
     void *ptr;
   } u;
+  struct uip_conn *conn;
+  struct httpd_request requests[HTTPD_PIPELINE];
+  unsigned char head, pending;
+  char closing;
+  char idle;
+  clock_time_t idle_since;
 };
 
 
@@ -48,6 +48,95 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_FREE_LIST
+/* The free list is kept in the reference count bytes, so that a
+   released block is not written to until it is allocated again. The
+   count of an allocated block is 1, the count of a free block is 0
+   at the end of the list and 2 + n when block n follows it. Pools of
+   more than 254 blocks have two count bytes per block (see
+   MEMB_COUNT_SIZE()), stored low byte first. */
+#define WIDE(m)         ((m)->num > 254)
+#define ALLOCATED       1
+/*---------------------------------------------------------------------------*/
+static unsigned short
+get_count(struct memb *m, int i)
+{
+  unsigned char *c = (unsigned char *)m->count;
+
+  if(WIDE(m)) {
+    return c[2 * i] | (c[2 * i + 1] << 8);
+  }
+  return c[i];
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_count(struct memb *m, int i, unsigned short count)
+{
+  unsigned char *c = (unsigned char *)m->count;
+
+  if(WIDE(m)) {
+    c[2 * i] = count & 0xff;
+    c[2 * i + 1] = count >> 8;
+  } else {
+    c[i] = count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_init(struct memb *m)
+{
+  memset(m->count, 0, WIDE(m) ? 2 * m->num : m->num);
+  memset(m->mem, 0, m->size * m->num);
+  m->free_list = 0;
+  m->fresh = 0;
+}
+/*---------------------------------------------------------------------------*/
+void *
+memb_alloc(struct memb *m)
+{
+  int i;
+  unsigned short next;
+
+  if(m->free_list != 0) {
+    /* Reuse the most recently released block. */
+    i = m->free_list - 1;
+    next = get_count(m, i);
+    m->free_list = next == 0 ? 0 : next - 1;
+  } else if(m->fresh < m->num) {
+    /* Hand out a block that has never been used. */
+    i = m->fresh++;
+  } else {
+    return NULL;
+  }
+
+  set_count(m, i, ALLOCATED);
+  return (void *)((char *)m->mem + (i * m->size));
+}
+/*---------------------------------------------------------------------------*/
+char
+memb_free(struct memb *m, void *ptr)
+{
+  int i;
+  unsigned int offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* Make sure that we don't deallocate free memory. */
+  if(get_count(m, i) == ALLOCATED) {
+    set_count(m, i, m->free_list == 0 ? 0 : m->free_list + 1);
+    m->free_list = i + 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#else /* MEMB_FREE_LIST */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
@@ -100,6 +189,7 @@ memb_free(struct memb *m, void *ptr)
   }
   return -1;
 }
+#endif /* MEMB_FREE_LIST */
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
@@ -49,6 +49,13 @@
  * memory by the memb_alloc() function, and are deallocated with the
  * memb_free() function.
  *
+ * Unless MEMB_CONF_FREE_LIST is set to 0, unused blocks are linked
+ * into a free list through their reference count bytes, so that both
+ * memb_alloc() and memb_free() take constant time. As before, a
+ * released block is not written to before it is allocated again.
+ * Pools of more than 254 blocks take two reference count bytes per
+ * block for the list.
+ *
  * @{
  */
 
@@ -66,6 +73,20 @@
 
 #include "sys/cc.h"
 
+#ifdef MEMB_CONF_FREE_LIST
+#define MEMB_FREE_LIST MEMB_CONF_FREE_LIST
+#else
+#define MEMB_FREE_LIST 1
+#endif /* MEMB_CONF_FREE_LIST */
+
+#if MEMB_FREE_LIST
+/* Number of reference count bytes of a pool, wide enough to link
+   every block into the free list. */
+#define MEMB_COUNT_SIZE(num) ((num) > 254 ? 2 * (num) : (num))
+#else /* MEMB_FREE_LIST */
+#define MEMB_COUNT_SIZE(num) (num)
+#endif /* MEMB_FREE_LIST */
+
 /**
  * Declare a memory block.
  *
@@ -88,7 +109,7 @@ MEMB(connections, struct connection, 16);
  *
  */
 #define MEMB(name, structure, num) \
-        static char CC_CONCAT(name,_memb_count)[num]; \
+        static char CC_CONCAT(name,_memb_count)[MEMB_COUNT_SIZE(num)]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
@@ -99,6 +120,15 @@ struct memb {
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREE_LIST
+  /* Head of the list of released blocks, the block index plus one or
+     0 if the list is empty. */
+  unsigned short free_list;
+  /* Number of blocks that have been handed out at least once since
+     memb_init(). Blocks above it are free but not in the list, which
+     keeps the MEMB() initializer and static zeroing sufficient. */
+  unsigned short fresh;
+#endif /* MEMB_FREE_LIST */
 };
 
 /**
@@ -41,11 +41,13 @@
  */
 
 #include "net/netstack.h"
+#include "net/pkttrace.h"
 #include "dev/leds.h"
 #include "dev/radio.h"
 #include "dev/watchdog.h"
 #include "lib/random.h"
 #include "net/mac/contikimac.h"
+#include "net/mac/rdc-hold.h"
 #include "net/rime.h"
 #include "sys/compower.h"
 #include "sys/pt.h"
@@ -602,6 +604,8 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   struct hdr *chdr;
 #endif /* WITH_CONTIKIMAC_HEADER */
 
+  PKTTRACE_STAGE(PKTTRACE_OUT_RDC);
+
   if(packetbuf_totlen() == 0) {
     PRINTF("contikimac: send_packet data len 0\n");
     return MAC_TX_ERR_FATAL;
@@ -839,13 +843,33 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
                            NETSTACK_RADIO.pending_packet() ||
                            NETSTACK_RADIO.channel_clear() == 0)) {
         uint8_t ackbuf[ACK_LEN];
+#if RDC_HOLD_NB > 0
+        struct rdc_hold_frame *f;
+#endif /* RDC_HOLD_NB > 0 */
         wt = RTIMER_NOW();
 #if NURTIMER
         while(RTIMER_CLOCK_LT(wt, RTIMER_NOW(), wt + AFTER_ACK_DETECTECT_WAIT_TIME));
 #else
         while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + AFTER_ACK_DETECTECT_WAIT_TIME)) { }
 #endif
-        len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+#if RDC_HOLD_NB > 0
+        /* Read the frame into a held frame, so that a data frame that
+           arrived instead of the ack is not lost */
+        f = rdc_hold_alloc();
+        if(f != NULL) {
+          len = NETSTACK_RADIO.read(f->data, sizeof(f->data));
+          if(len > ACK_LEN) {
+            /* Input the frame after this send */
+            f->len = len;
+            rdc_hold_input(f);
+          } else {
+            rdc_hold_free(f);
+          }
+        } else
+#endif /* RDC_HOLD_NB > 0 */
+        {
+          len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+        }
         if(len == ACK_LEN) {
           got_strobe_ack = 1;
           encounter_time = previous_txtime;
@@ -939,6 +963,7 @@ input_packet(void)
 
   /*  printf("cycle_start 0x%02x 0x%02x\n", cycle_start, cycle_start % CYCLE_TIME);*/
   
+  PKTTRACE_STAGE(PKTTRACE_IN_RDC);
   
   if(packetbuf_totlen() > 0 && NETSTACK_FRAMER.parse()) {
 
@@ -947,6 +972,7 @@ input_packet(void)
     chdr = packetbuf_dataptr();
     if(chdr->id != CONTIKIMAC_ID) {
       PRINTF("contikimac: failed to parse hdr (%u)\n", packetbuf_totlen());
+      PKTTRACE_DROP(PKTTRACE_IN_RDC, PKTTRACE_DROP_BAD_FRAME);
       return;
     }
     packetbuf_hdrreduce(sizeof(struct hdr));
@@ -993,6 +1019,7 @@ input_packet(void)
                           &received_seqnos[i].sender)) {
             /* Drop the packet. */
             /*        printf("Drop duplicate ContikiMAC layer packet\n");*/
+            PKTTRACE_DROP(PKTTRACE_IN_RDC, PKTTRACE_DROP_DUPLICATE);
             return;
           }
         }
@@ -1027,6 +1054,7 @@ input_packet(void)
     }
   } else {
     PRINTF("contikimac: failed to parse (%u)\n", packetbuf_totlen());
+    PKTTRACE_DROP(PKTTRACE_IN_RDC, PKTTRACE_DROP_BAD_FRAME);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -47,6 +47,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/pkttrace.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -76,19 +77,74 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+#ifdef CSMA_CONF_MAX_QUEUED_PACKETS
+#define MAX_QUEUED_PACKETS CSMA_CONF_MAX_QUEUED_PACKETS
+#else
+#define MAX_QUEUED_PACKETS 6
+#endif /* CSMA_CONF_MAX_QUEUED_PACKETS */
+
+/* The number of neighbors with a queue of their own. Unicast packets
+   to further neighbors are sent without retransmissions. */
+#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#else
+#define CSMA_MAX_NEIGHBOR_QUEUES 4
+#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
+
+/* The number of packets one neighbor may hold, so that a neighbor
+   that has gone away cannot take all of the packet buffers. */
+#ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
+#define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
+#else
+#define CSMA_MAX_PACKET_PER_NEIGHBOR 4
+#endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
+
+/* Clamp for the linear backoff, in multiples of the RDC channel check
+   interval. */
+#define CSMA_MAX_BACKOFF 3
+
+/* The backoff of a neighbor doubles with every packet it has dropped
+   in a row, up to 2^CSMA_MAX_FAILURE_BACKOFF times. */
+#ifdef CSMA_CONF_MAX_FAILURE_BACKOFF
+#define CSMA_MAX_FAILURE_BACKOFF CSMA_CONF_MAX_FAILURE_BACKOFF
+#else
+#define CSMA_MAX_FAILURE_BACKOFF 3
+#endif /* CSMA_CONF_MAX_FAILURE_BACKOFF */
+
+struct neighbor_queue;
+
 struct queued_packet {
   struct queued_packet *next;
+  struct neighbor_queue *n;
   struct queuebuf *buf;
-  /*  struct ctimer retransmit_timer;*/
   mac_callback_t sent;
   void *cptr;
   uint8_t transmissions, max_transmissions;
   uint8_t collisions, deferrals;
 };
 
-#define MAX_QUEUED_PACKETS 6
+/* The packets queued for one neighbor. Every neighbor backs off on
+   its own timer, so a neighbor that does not acknowledge only delays
+   the packets sent to it. */
+struct neighbor_queue {
+  struct neighbor_queue *next;
+  rimeaddr_t addr;
+  struct ctimer transmit_timer;
+  LIST_STRUCT(queued_packet_list);
+  uint8_t queued;
+  /* Packets dropped in a row; lengthens the backoff of a neighbor
+     that keeps failing. */
+  uint8_t failures;
+  uint16_t sent, dropped;
+};
+
 MEMB(packet_memb, struct queued_packet, MAX_QUEUED_PACKETS);
-LIST(queued_packet_list);
+MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+LIST(neighbor_list);
+
+/* The neighbor that was served last. The next transmission goes to
+   the first neighbor after it that has a packet ready. */
+static struct neighbor_queue *last_served;
 
 static struct ctimer transmit_timer;
 
@@ -114,10 +170,84 @@ default_timebase(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_from_addr(const rimeaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(rimeaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_new(const rimeaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  n = memb_alloc(&neighbor_memb);
+  if(n == NULL) {
+    /* Take over a neighbor that has nothing queued. Its counters
+       start over. */
+    for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+      if(n->queued == 0) {
+        break;
+      }
+    }
+    if(n == NULL) {
+      return NULL;
+    }
+    ctimer_stop(&n->transmit_timer);
+    list_remove(neighbor_list, n);
+    if(last_served == n) {
+      last_served = NULL;
+    }
+  }
+  memset(n, 0, sizeof(struct neighbor_queue));
+  rimeaddr_copy(&n->addr, addr);
+  LIST_STRUCT_INIT(n, queued_packet_list);
+  list_add(neighbor_list, n);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+next_neighbor(void)
+{
+  struct neighbor_queue *n, *start;
+
+  start = NULL;
+  if(last_served != NULL) {
+    start = list_item_next(last_served);
+  }
+  if(start == NULL) {
+    start = list_head(neighbor_list);
+  }
+
+  /* Round-robin over the neighbors that have a packet and are not
+     backing off. */
+  n = start;
+  while(n != NULL) {
+    if(n->queued > 0 && ctimer_expired(&n->transmit_timer)) {
+      return n;
+    }
+    n = list_item_next(n);
+    if(n == NULL) {
+      n = list_head(neighbor_list);
+    }
+    if(n == start) {
+      break;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 static void
 transmit_queued_packet(void *ptr)
 {
-  /*  struct queued_packet *q = ptr;*/
+  struct neighbor_queue *n;
   struct queued_packet *q;
 
   /* Don't transmit a packet if the RDC is still transmitting the
@@ -125,16 +255,14 @@ transmit_queued_packet(void *ptr)
   if(rdc_is_transmitting) {
     return;
   }
-  
-  //  printf("q %d\n", list_length(queued_packet_list));
-
-  q = list_head(queued_packet_list);
 
-  if(q != NULL) {
+  n = next_neighbor();
+  if(n != NULL) {
+    q = list_head(n->queued_packet_list);
+    last_served = n;
     queuebuf_to_packetbuf(q->buf);
-    PRINTF("csma: sending number %d %p, queue len %d\n", q->transmissions, q,
-           list_length(queued_packet_list));
-    //    printf("s %d\n", packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
+    PRINTF("csma: sending number %d %p, neighbor queue len %d\n",
+           q->transmissions, q, n->queued);
     rdc_is_transmitting = 1;
     NETSTACK_RDC.send(packet_sent, q);
   }
@@ -143,41 +271,37 @@ transmit_queued_packet(void *ptr)
 static void
 start_transmission_timer(void)
 {
-  PRINTF("csma: start_transmission_timer, queue len %d\n",
-         list_length(queued_packet_list));
-  if(list_length(queued_packet_list) > 0) {
-    if(ctimer_expired(&transmit_timer)) {
-      ctimer_set(&transmit_timer, 0,
-                 transmit_queued_packet, NULL);
-    }
+  /* The transmission is started from a timer, since the RDC may call
+     packet_sent() before its send function returns. */
+  if(ctimer_expired(&transmit_timer)) {
+    ctimer_set(&transmit_timer, 0,
+               transmit_queued_packet, NULL);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
-free_queued_packet(void)
+free_queued_packet(struct queued_packet *q, clock_time_t time)
 {
-  struct queued_packet *q;
-
-  //  printf("q %d\n", list_length(queued_packet_list));
-
-  q = list_head(queued_packet_list);
-
-  if(q != NULL) {
-    queuebuf_free(q->buf);
-    list_remove(queued_packet_list, q);
-    memb_free(&packet_memb, q);
-    PRINTF("csma: free_queued_packet, queue length %d\n",
-           list_length(queued_packet_list));
-    if(list_length(queued_packet_list) > 0) {
-      ctimer_set(&transmit_timer, default_timebase(), transmit_queued_packet, NULL);
-    }
+  struct neighbor_queue *n = q->n;
+
+  queuebuf_free(q->buf);
+  list_remove(n->queued_packet_list, q);
+  memb_free(&packet_memb, q);
+  n->queued--;
+  PRINTF("csma: free_queued_packet, neighbor queue length %d\n", n->queued);
+  if(n->queued > 0) {
+    /* The next packet to this neighbor waits, the others may go
+       right away. */
+    ctimer_set(&n->transmit_timer, time, transmit_queued_packet, NULL);
   }
+  start_transmission_timer();
 }
 /*---------------------------------------------------------------------------*/
 static void
 packet_sent(void *ptr, int status, int num_transmissions)
 {
   struct queued_packet *q = ptr;
+  struct neighbor_queue *n = q->n;
   clock_time_t time = 0;
   mac_callback_t sent;
   void *cptr;
@@ -230,32 +354,49 @@ packet_sent(void *ptr, int status, int num_transmissions)
     backoff_transmissions = q->transmissions + 1;
 
     /* Clamp the number of backoffs so that we don't get a too long
-       timeout here, since that will delay all packets in the
-       queue. */
-    if(backoff_transmissions > 3) {
-      backoff_transmissions = 3;
+       timeout here, since that will delay all packets to the
+       neighbor. */
+    if(backoff_transmissions > CSMA_MAX_BACKOFF) {
+      backoff_transmissions = CSMA_MAX_BACKOFF;
     }
     time = time + (random_rand() % (backoff_transmissions * time));
 
+    /* A neighbor that keeps dropping packets has probably gone away,
+       so it is tried less often. */
+    if(n->failures > CSMA_MAX_FAILURE_BACKOFF) {
+      time <<= CSMA_MAX_FAILURE_BACKOFF;
+    } else {
+      time <<= n->failures;
+    }
+
     if(q->transmissions < q->max_transmissions) {
       PRINTF("csma: retransmitting with time %lu %p\n", time, q);
-      ctimer_set(&transmit_timer, time,
+      ctimer_set(&n->transmit_timer, time,
                  transmit_queued_packet, NULL);
+      /* Other neighbors are served while this one backs off. */
+      start_transmission_timer();
     } else {
       PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
              status, q->transmissions, q->collisions);
-      /*      queuebuf_to_packetbuf(q->buf);*/
-      free_queued_packet();
+      n->dropped++;
+      if(n->failures < 0xff) {
+        n->failures++;
+      }
+      free_queued_packet(q, time);
       mac_call_sent_callback(sent, cptr, status, num_tx);
     }
   } else {
     if(status == MAC_TX_OK) {
       PRINTF("csma: rexmit ok %d\n", q->transmissions);
+      n->sent++;
+      n->failures = 0;
     } else {
       PRINTF("csma: rexmit failed %d: %d\n", q->transmissions, status);
+      if(status != MAC_TX_DEFERRED) {
+        n->dropped++;
+      }
     }
-    /*    queuebuf_to_packetbuf(q->buf);*/
-    free_queued_packet();
+    free_queued_packet(q, default_timebase());
     mac_call_sent_callback(sent, cptr, status, num_tx);
   }
 }
@@ -264,7 +405,10 @@ static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   struct queued_packet *q;
+  struct neighbor_queue *n;
   static uint16_t seqno;
+
+  PKTTRACE_STAGE(PKTTRACE_OUT_MAC);
   
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno++);
   
@@ -273,36 +417,61 @@ send_packet(mac_callback_t sent, void *ptr)
   if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                    &rimeaddr_null)) {
 
-    /* Remember packet for later. */
-    q = memb_alloc(&packet_memb);
-    if(q != NULL) {
-      q->buf = queuebuf_new_from_packetbuf();
-      if(q->buf != NULL) {
-        if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
-          /* Use default configuration for max transmissions */
-          q->max_transmissions = CSMA_MAX_MAC_TRANSMISSIONS;
-        } else {
-          q->max_transmissions =
-            packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
-        }
-        q->transmissions = 0;
-        q->collisions = 0;
-        q->deferrals = 0;
-        q->sent = sent;
-        q->cptr = ptr;
-        if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
-           PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-          list_push(queued_packet_list, q);
-        } else {
-          list_add(queued_packet_list, q);
-        }
-        start_transmission_timer();
+    n = neighbor_queue_from_addr(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(n == NULL) {
+      n = neighbor_queue_new(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    }
+    if(n != NULL) {
+      if(n->queued >= CSMA_MAX_PACKET_PER_NEIGHBOR) {
+        PRINTF("csma: neighbor queue full, drop\n");
+        n->dropped++;
+        PKTTRACE_DROP(PKTTRACE_OUT_MAC, PKTTRACE_DROP_QUEUE_FULL);
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
         return;
       }
-      memb_free(&packet_memb, q);
-      PRINTF("csma: could not allocate queuebuf, will drop if collision or noack\n");
+
+      /* Remember packet for later. */
+      q = memb_alloc(&packet_memb);
+      if(q != NULL) {
+        q->buf = queuebuf_new_from_packetbuf();
+        if(q->buf != NULL) {
+          if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
+            /* Use default configuration for max transmissions */
+            q->max_transmissions = CSMA_MAX_MAC_TRANSMISSIONS;
+          } else {
+            q->max_transmissions =
+              packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
+          }
+          q->n = n;
+          q->transmissions = 0;
+          q->collisions = 0;
+          q->deferrals = 0;
+          q->sent = sent;
+          q->cptr = ptr;
+          if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
+             PACKETBUF_ATTR_PACKET_TYPE_ACK) {
+            list_push(n->queued_packet_list, q);
+          } else {
+            list_add(n->queued_packet_list, q);
+          }
+          n->queued++;
+          start_transmission_timer();
+          return;
+        }
+        memb_free(&packet_memb, q);
+        PRINTF("csma: could not allocate queuebuf, drop\n");
+      } else {
+        PRINTF("csma: could not allocate memb, drop\n");
+      }
+      /* Sending it right away would pass the packet being sent by the
+         RDC, so the packet is dropped like for a full neighbor queue. */
+      n->dropped++;
+      PKTTRACE_DROP(PKTTRACE_OUT_MAC, PKTTRACE_DROP_QUEUE_FULL);
+      mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+      return;
+    } else {
+      PRINTF("csma: no neighbor queue, will drop if collision or noack\n");
     }
-    PRINTF("csma: could not allocate memb, will drop if collision or noack\n");
   } else {
     PRINTF("csma: send broadcast (%d) or without retransmissions (%d)\n",
            !rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
@@ -312,9 +481,28 @@ send_packet(mac_callback_t sent, void *ptr)
   NETSTACK_RDC.send(sent, ptr);
 }
 /*---------------------------------------------------------------------------*/
+int
+csma_neighbor_stats(struct csma_neighbor_stats *stats, int max)
+{
+  struct neighbor_queue *n;
+  int i;
+
+  i = 0;
+  for(n = list_head(neighbor_list); n != NULL && i < max;
+      n = list_item_next(n)) {
+    rimeaddr_copy(&stats[i].addr, &n->addr);
+    stats[i].queued = n->queued;
+    stats[i].sent = n->sent;
+    stats[i].dropped = n->dropped;
+    i++;
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
 static void
 input_packet(void)
 {
+  PKTTRACE_STAGE(PKTTRACE_IN_MAC);
   NETSTACK_NETWORK.input();
 }
 /*---------------------------------------------------------------------------*/
@@ -343,6 +531,9 @@ static void
 init(void)
 {
   memb_init(&packet_memb);
+  memb_init(&neighbor_memb);
+  list_init(neighbor_list);
+  last_served = NULL;
   rdc_is_transmitting = 0;
 }
 /*---------------------------------------------------------------------------*/
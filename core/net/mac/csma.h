@@ -44,9 +44,22 @@
 
 #include "net/mac/mac.h"
 #include "dev/radio.h"
+#include "net/rime/rimeaddr.h"
+
+/* The counters of a neighbor that has a transmit queue. */
+struct csma_neighbor_stats {
+  rimeaddr_t addr;
+  uint8_t queued;
+  uint16_t sent;
+  uint16_t dropped;
+};
 
 extern const struct mac_driver csma_driver;
 
+/* Copies the counters of at most max neighbors into stats and returns
+   the number of neighbors copied. */
+int csma_neighbor_stats(struct csma_neighbor_stats *stats, int max);
+
 const struct mac_driver *csma_init(const struct mac_driver *r);
 
 #endif /* __CSMA_H__ */
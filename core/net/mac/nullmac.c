@@ -41,17 +41,20 @@
 #include "net/mac/nullmac.h"
 #include "net/packetbuf.h"
 #include "net/netstack.h"
+#include "net/pkttrace.h"
 
 /*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
+  PKTTRACE_STAGE(PKTTRACE_OUT_MAC);
   NETSTACK_RDC.send(sent, ptr);
 }
 /*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
+  PKTTRACE_STAGE(PKTTRACE_IN_MAC);
   NETSTACK_NETWORK.input();
 }
 /*---------------------------------------------------------------------------*/
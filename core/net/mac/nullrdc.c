@@ -42,6 +42,8 @@
 #include "net/mac/nullrdc.h"
 #include "net/packetbuf.h"
 #include "net/netstack.h"
+#include "net/pkttrace.h"
+#include "net/mac/rdc-hold.h"
 #include <string.h>
 
 #define DEBUG 0
@@ -97,6 +99,7 @@ static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   int ret;
+  PKTTRACE_STAGE(PKTTRACE_OUT_RDC);
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
@@ -152,13 +155,36 @@ send_packet(mac_callback_t sent, void *ptr)
                                   wt + AFTER_ACK_DETECTED_WAIT_TIME));
 
             if(NETSTACK_RADIO.pending_packet()) {
-              len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
-              if(len == ACK_LEN && ackbuf[2] == dsn) {
-                /* Ack received */
-                ret = MAC_TX_OK;
-              } else {
-                /* Not an ack or ack not for us: collision */
-                ret = MAC_TX_COLLISION;
+#if RDC_HOLD_NB > 0
+              /* Read the frame into a held frame, so that a data
+                 frame that arrived instead of the ack is not lost */
+              struct rdc_hold_frame *f = rdc_hold_alloc();
+              if(f != NULL) {
+                len = NETSTACK_RADIO.read(f->data, sizeof(f->data));
+                if(len == ACK_LEN && f->data[2] == dsn) {
+                  /* Ack received */
+                  ret = MAC_TX_OK;
+                } else {
+                  ret = MAC_TX_COLLISION;
+                }
+                if(len > ACK_LEN) {
+                  /* Input the frame after this send */
+                  f->len = len;
+                  rdc_hold_input(f);
+                } else {
+                  rdc_hold_free(f);
+                }
+              } else
+#endif /* RDC_HOLD_NB > 0 */
+              {
+                len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+                if(len == ACK_LEN && ackbuf[2] == dsn) {
+                  /* Ack received */
+                  ret = MAC_TX_OK;
+                } else {
+                  /* Not an ack or ack not for us: collision */
+                  ret = MAC_TX_COLLISION;
+                }
               }
             }
           }
@@ -198,6 +224,7 @@ send_packet(mac_callback_t sent, void *ptr)
 static void
 packet_input(void)
 {
+  PKTTRACE_STAGE(PKTTRACE_IN_RDC);
 #if NULLRDC_802154_AUTOACK
   if(packetbuf_datalen() == ACK_LEN) {
     /* Ignore ack packets */
@@ -206,6 +233,7 @@ packet_input(void)
 #endif /* NULLRDC_802154_AUTOACK */
   if(NETSTACK_FRAMER.parse() == 0) {
     PRINTF("nullrdc: failed to parse %u\n", packetbuf_datalen());
+    PKTTRACE_DROP(PKTTRACE_IN_RDC, PKTTRACE_DROP_BAD_FRAME);
   } else {
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
     /* Check for duplicate packet by comparing the sequence number
@@ -218,6 +246,7 @@ packet_input(void)
         /* Drop the packet. */
         PRINTF("nullrdc: drop duplicate link layer packet %u\n",
                packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+        PKTTRACE_DROP(PKTTRACE_IN_RDC, PKTTRACE_DROP_DUPLICATE);
         return;
       }
     }
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Frames held by a radio duty cycling layer for later input.
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/mac/rdc-hold.h"
+
+#if RDC_HOLD_NB > 0
+
+static uint8_t used;
+
+MEMB(hold_memb, struct rdc_hold_frame, RDC_HOLD_NB);
+LIST(hold_list);
+
+PROCESS(rdc_hold_process, "RDC held frames");
+
+/*---------------------------------------------------------------------------*/
+struct rdc_hold_frame *
+rdc_hold_alloc(void)
+{
+  struct rdc_hold_frame *f;
+
+  f = memb_alloc(&hold_memb);
+  if(f != NULL) {
+    used++;
+    f->next = NULL;
+    f->len = 0;
+  }
+  return f;
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_hold_free(struct rdc_hold_frame *f)
+{
+  memb_free(&hold_memb, f);
+  used--;
+}
+/*---------------------------------------------------------------------------*/
+int
+rdc_hold_used(void)
+{
+  return used;
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_hold_input(struct rdc_hold_frame *f)
+{
+  if(!process_is_running(&rdc_hold_process)) {
+    process_start(&rdc_hold_process, NULL);
+  }
+  list_add(hold_list, f);
+  process_poll(&rdc_hold_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rdc_hold_process, ev, data)
+{
+  static struct rdc_hold_frame *f;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    /* Hand the frames to the RDC the way a radio driver does */
+    while((f = list_pop(hold_list)) != NULL) {
+      if(f->len > PACKETBUF_SIZE) {
+        rdc_hold_free(f);
+        continue;
+      }
+      packetbuf_clear();
+      memcpy(packetbuf_dataptr(), f->data, f->len);
+      packetbuf_set_datalen(f->len);
+      rdc_hold_free(f);
+      NETSTACK_RDC.input();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+
+#endif /* RDC_HOLD_NB > 0 */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Frames held by a radio duty cycling layer for later input.
+ *
+ *         While nullrdc or contikimac wait for the ack of a send, the
+ *         radio may receive a data frame instead. With RDC_CONF_HOLD_NB
+ *         greater than 0, the RDC reads such a frame into one of
+ *         RDC_CONF_HOLD_NB held frames and hands it to its own input
+ *         from a process once the send has completed, instead of
+ *         dropping it. A held frame is sized for one radio frame.
+ */
+
+#ifndef __RDC_HOLD_H__
+#define __RDC_HOLD_H__
+
+#include "contiki-conf.h"
+
+#ifdef RDC_CONF_HOLD_NB
+#define RDC_HOLD_NB RDC_CONF_HOLD_NB
+#else /* RDC_CONF_HOLD_NB */
+#define RDC_HOLD_NB 0
+#endif /* RDC_CONF_HOLD_NB */
+
+#ifdef RDC_CONF_HOLD_FRAME_SIZE
+#define RDC_HOLD_FRAME_SIZE RDC_CONF_HOLD_FRAME_SIZE
+#else /* RDC_CONF_HOLD_FRAME_SIZE */
+#define RDC_HOLD_FRAME_SIZE 127
+#endif /* RDC_CONF_HOLD_FRAME_SIZE */
+
+struct rdc_hold_frame {
+  struct rdc_hold_frame *next;
+  uint8_t len;
+  uint8_t data[RDC_HOLD_FRAME_SIZE];
+};
+
+#if RDC_HOLD_NB > 0
+
+/**
+ * \brief      Allocate a frame to read the radio into
+ * \return     The frame, or NULL if all are held
+ */
+struct rdc_hold_frame *rdc_hold_alloc(void);
+
+/**
+ * \brief      Return a frame that is not held for input
+ */
+void rdc_hold_free(struct rdc_hold_frame *f);
+
+/**
+ * \brief      Hold a received frame for input
+ * \param f    A frame from rdc_hold_alloc() with its length set
+ *
+ *             The frame is copied to packetbuf and given to the radio
+ *             duty cycling layer from a process, the way a radio
+ *             driver does, after the send that was in progress on its
+ *             arrival has completed. The frame is freed afterwards.
+ */
+void rdc_hold_input(struct rdc_hold_frame *f);
+
+/**
+ * \brief      The number of frames allocated or held
+ */
+int rdc_hold_used(void);
+
+#endif /* RDC_HOLD_NB > 0 */
+
+#endif /* __RDC_HOLD_H__ */
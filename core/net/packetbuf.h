@@ -348,6 +348,9 @@ enum {
   PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
+#if PKTTRACE_CONF_ENABLED
+  PACKETBUF_ATTR_PKTTRACE,
+#endif /* PKTTRACE_CONF_ENABLED */
 
   /* Scope 1 attributes: used between two neighbors only. */
   PACKETBUF_ATTR_RELIABLE,
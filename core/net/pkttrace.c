@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-packet latency and drop tracing of the uIP/6lowpan/MAC
+ *         pipeline.
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/pkttrace.h"
+
+#if PKTTRACE_ENABLED
+
+struct pkttrace pkttrace;
+
+/* The received packet, and the sent packet before the MAC layer */
+static struct pkttrace_record current[2];
+
+/* The frames in the MAC and RDC layers. The PACKETBUF_ATTR_PKTTRACE
+   attribute of a frame holds the index of its record in the low bits
+   and a sequence number above them, so that a queued frame whose
+   record was taken over is not traced into the new one. */
+static struct pkttrace_record frames[PKTTRACE_FRAMES];
+static packetbuf_attr_t frame_ids[PKTTRACE_FRAMES];
+static uint8_t next_frame;
+static packetbuf_attr_t frame_seqno;
+
+#define FRAME_INDEX_BITS 4
+#if PKTTRACE_FRAMES > (1 << FRAME_INDEX_BITS)
+#error PKTTRACE_CONF_FRAMES must not be larger than 16
+#endif
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+bucket(rtimer_clock_t ticks)
+{
+  uint8_t b = 0;
+
+  while(ticks != 0 && b < PKTTRACE_BUCKETS - 1) {
+    ticks >>= 1;
+    b++;
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+static void
+complete(struct pkttrace_record *r, uint8_t reason)
+{
+  uint8_t i, prev = PKTTRACE_DIR_STAGES;
+  uint16_t *h;
+
+  for(i = 0; i < PKTTRACE_DIR_STAGES; i++) {
+    if(r->seen & (1 << i)) {
+      if(prev < PKTTRACE_DIR_STAGES) {
+        h = &pkttrace.hist[r->first + i]
+          [bucket((rtimer_clock_t)(r->time[i] - r->time[prev]))];
+        if(*h < 0xffff) {
+          (*h)++;
+        }
+      }
+      prev = i;
+    }
+  }
+  r->drop = reason;
+  if(reason != PKTTRACE_DROP_NONE) {
+    pkttrace_lost(reason);
+  }
+  memcpy(&pkttrace.ring[pkttrace.head], r, sizeof(*r));
+  pkttrace.head = (pkttrace.head + 1) % PKTTRACE_RECORDS;
+  pkttrace.packets++;
+  r->seen = 0;
+  if(r >= frames && r < frames + PKTTRACE_FRAMES) {
+    /* the frame is done, later marks of it are ignored */
+    if(packetbuf_attr(PACKETBUF_ATTR_PKTTRACE) == frame_ids[r - frames]) {
+      packetbuf_set_attr(PACKETBUF_ATTR_PKTTRACE, 0);
+    }
+    frame_ids[r - frames] = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Gives the frame in the packetbuf a record with the stages its packet
+   passed above the MAC layer. */
+static struct pkttrace_record *
+new_frame(void)
+{
+  struct pkttrace_record *r = &frames[next_frame];
+
+  if(r->seen != 0) {
+    /* the oldest frame is still queued, or it left without a report */
+    complete(r, PKTTRACE_DROP_NONE);
+  }
+  memcpy(r, &current[1], sizeof(*r));
+  r->first = PKTTRACE_OUT_TCPIP;
+  r->seen &= (1 << (PKTTRACE_OUT_MAC - PKTTRACE_OUT_TCPIP)) - 1;
+  frame_seqno++;
+  frame_ids[next_frame] = (frame_seqno << FRAME_INDEX_BITS) | next_frame;
+  if(frame_ids[next_frame] == 0) {
+    frame_ids[next_frame] = (++frame_seqno << FRAME_INDEX_BITS) | next_frame;
+  }
+  packetbuf_set_attr(PACKETBUF_ATTR_PKTTRACE, frame_ids[next_frame]);
+  next_frame = (next_frame + 1) % PKTTRACE_FRAMES;
+
+  /* the packet has reached the MAC layer, its fragments go on as frames */
+  current[1].seen |= 1 << (PKTTRACE_OUT_MAC - PKTTRACE_OUT_TCPIP);
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+/* The record of the frame in the packetbuf, if it is traced */
+static struct pkttrace_record *
+find_frame(void)
+{
+  packetbuf_attr_t id = packetbuf_attr(PACKETBUF_ATTR_PKTTRACE);
+  uint8_t i = id & ((1 << FRAME_INDEX_BITS) - 1);
+
+  if(id == 0 || i >= PKTTRACE_FRAMES || frame_ids[i] != id) {
+    return NULL;
+  }
+  return &frames[i];
+}
+/*---------------------------------------------------------------------------*/
+static struct pkttrace_record *
+mark(uint8_t stage, uint8_t drop)
+{
+  struct pkttrace_record *r;
+  uint8_t i;
+
+  if(stage >= PKTTRACE_STAGES) {
+    return NULL;
+  }
+  i = stage % PKTTRACE_DIR_STAGES;
+  if(stage >= PKTTRACE_OUT_MAC) {
+    r = stage == PKTTRACE_OUT_MAC && !drop ? new_frame() : find_frame();
+    if(r == NULL) {
+      return NULL;
+    }
+    /* a retransmission keeps the time of the first attempt */
+    if(!(r->seen & (1 << i))) {
+      r->seen |= 1 << i;
+      r->time[i] = RTIMER_NOW();
+    }
+    return r;
+  }
+  r = &current[stage >= PKTTRACE_DIR_STAGES];
+  if(r->seen >= (1 << i) && !(drop && r->seen < (2 << i))) {
+    /* the stage was passed already, so this is a new packet */
+    if(r == &current[1] && (r->seen & (1 << (PKTTRACE_OUT_MAC - PKTTRACE_OUT_TCPIP)))) {
+      /* the last one was traced through its frames */
+      r->seen = 0;
+    } else {
+      /* the last one was consumed on the way (fragments, forwarding,
+         queued for neighbor discovery) */
+      complete(r, PKTTRACE_DROP_NONE);
+    }
+  }
+  r->first = stage - i;
+  r->seen |= 1 << i;
+  r->time[i] = RTIMER_NOW();
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_stage(uint8_t stage)
+{
+  struct pkttrace_record *r = mark(stage, 0);
+
+  if(r != NULL && stage % PKTTRACE_DIR_STAGES == PKTTRACE_DIR_STAGES - 1) {
+    complete(r, PKTTRACE_DROP_NONE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_drop(uint8_t stage, uint8_t reason)
+{
+  struct pkttrace_record *r = mark(stage, 1);
+
+  if(r != NULL && reason < PKTTRACE_DROP_REASONS) {
+    complete(r, reason);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_lost(uint8_t reason)
+{
+  if(reason < PKTTRACE_DROP_REASONS && pkttrace.drops[reason] < 0xffff) {
+    pkttrace.drops[reason]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_reset(void)
+{
+  memset(&pkttrace, 0, sizeof(pkttrace));
+  memset(current, 0, sizeof(current));
+  memset(frames, 0, sizeof(frames));
+  memset(frame_ids, 0, sizeof(frame_ids));
+}
+/*---------------------------------------------------------------------------*/
+
+#endif /* PKTTRACE_ENABLED */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-packet latency and drop tracing of the uIP/6lowpan/MAC
+ *         pipeline.
+ *
+ *         Each layer marks the packet with PKTTRACE_STAGE() when it
+ *         takes it over, and with PKTTRACE_DROP() when it discards
+ *         it. The time between two stages is counted in a histogram
+ *         of the later stage, with buckets that double in width (in
+ *         rtimer ticks), and the last PKTTRACE_RECORDS packets are
+ *         kept in a ring. Without PKTTRACE_CONF_ENABLED the macros
+ *         compile to nothing.
+ *
+ *         A received packet and a sent packet above the MAC layer are
+ *         handled one at a time in uip_buf. Below that, every frame
+ *         gets a record of its own when it enters the MAC layer, and
+ *         the PACKETBUF_ATTR_PKTTRACE attribute carries it through the
+ *         MAC queues, so that queued frames and the fragments of a
+ *         packet are timed separately.
+ */
+
+#ifndef __PKTTRACE_H__
+#define __PKTTRACE_H__
+
+#include "contiki-conf.h"
+#include "sys/rtimer.h"
+
+#ifdef PKTTRACE_CONF_ENABLED
+#define PKTTRACE_ENABLED PKTTRACE_CONF_ENABLED
+#else /* PKTTRACE_CONF_ENABLED */
+#define PKTTRACE_ENABLED 0
+#endif /* PKTTRACE_CONF_ENABLED */
+
+/* The number of packets kept in the ring */
+#ifdef PKTTRACE_CONF_RECORDS
+#define PKTTRACE_RECORDS PKTTRACE_CONF_RECORDS
+#else /* PKTTRACE_CONF_RECORDS */
+#define PKTTRACE_RECORDS 16
+#endif /* PKTTRACE_CONF_RECORDS */
+
+/* The number of frames traced at once in the MAC and RDC layers. When
+   more are queued, the oldest one is completed as if it was consumed. */
+#ifdef PKTTRACE_CONF_FRAMES
+#define PKTTRACE_FRAMES PKTTRACE_CONF_FRAMES
+#else /* PKTTRACE_CONF_FRAMES */
+#define PKTTRACE_FRAMES 8
+#endif /* PKTTRACE_CONF_FRAMES */
+
+/* Bucket 0 counts latencies of 0 ticks, bucket i those of 2^(i-1) to
+   2^i - 1 ticks and the last bucket everything above */
+#define PKTTRACE_BUCKETS 16
+
+/* Stages of received packets, in the order they pass them */
+#define PKTTRACE_IN_RDC          0 /* radio duty cycling input */
+#define PKTTRACE_IN_MAC          1 /* MAC input */
+#define PKTTRACE_IN_SICSLOWPAN   2 /* 6lowpan input */
+#define PKTTRACE_IN_TCPIP        3 /* tcpip_input() */
+#define PKTTRACE_IN_DONE         4 /* uip_process() and the application done */
+/* Stages of sent packets */
+#define PKTTRACE_OUT_TCPIP       5 /* tcpip_ipv6_output() */
+#define PKTTRACE_OUT_SICSLOWPAN  6 /* 6lowpan output */
+#define PKTTRACE_OUT_MAC         7 /* MAC send */
+#define PKTTRACE_OUT_RDC         8 /* radio duty cycling send */
+#define PKTTRACE_OUT_DONE        9 /* MAC reported the transmission */
+#define PKTTRACE_STAGES         10
+
+#define PKTTRACE_DIR_STAGES      5
+
+/* Reasons for dropping packets */
+#define PKTTRACE_DROP_NONE           0 /* not dropped */
+#define PKTTRACE_DROP_BAD_FRAME      1 /* frame or header could not be parsed */
+#define PKTTRACE_DROP_DUPLICATE      2 /* duplicate frame or fragment */
+#define PKTTRACE_DROP_REASS_TIMEOUT  3 /* fragment reassembly timed out */
+#define PKTTRACE_DROP_REASS_EVICTED  4 /* reassembly dropped for a new packet */
+#define PKTTRACE_DROP_TOO_LARGE      5 /* packet does not fit the buffers */
+#define PKTTRACE_DROP_QUEUE_FULL     6 /* no queue buffer or MAC queue entry was free */
+#define PKTTRACE_DROP_NO_ROUTE       7 /* no route or neighbor entry */
+#define PKTTRACE_DROP_MAC_COLLISION  8 /* MAC gave up after collisions */
+#define PKTTRACE_DROP_MAC_NOACK      9 /* MAC gave up without an ack */
+#define PKTTRACE_DROP_MAC_ERR       10 /* MAC or radio error */
+#define PKTTRACE_DROP_REASONS       11
+
+/* The trace of one packet: the time it entered each stage of its
+   direction, for the stages that are set in the seen mask */
+struct pkttrace_record {
+  rtimer_clock_t time[PKTTRACE_DIR_STAGES];
+  uint8_t first;
+  uint8_t seen;
+  uint8_t drop;
+};
+
+/* The binary dump is written field by field, little-endian, so that it
+   does not depend on the padding of the structures or on the size of
+   rtimer_clock_t:
+
+     uint8_t  version, stages, buckets, reasons, records, dir_stages
+     uint32_t rtimer_second, packets
+     uint16_t hist[stages][buckets], drops[reasons], head
+     then records times, in ring order:
+       uint32_t time[dir_stages]
+       uint8_t  first, seen, drop
+*/
+#define PKTTRACE_VERSION 2
+
+struct pkttrace {
+  uint32_t packets;
+  uint16_t hist[PKTTRACE_STAGES][PKTTRACE_BUCKETS];
+  uint16_t drops[PKTTRACE_DROP_REASONS];
+  uint16_t head;
+  struct pkttrace_record ring[PKTTRACE_RECORDS];
+};
+
+#if PKTTRACE_ENABLED
+
+extern struct pkttrace pkttrace;
+
+/**
+ * Mark the current packet of the direction of the stage as having
+ * entered the stage. The first stage of a direction starts a new
+ * packet, the last one completes it.
+ */
+void pkttrace_stage(uint8_t stage);
+
+/**
+ * Mark the current packet of the direction of the stage as dropped in
+ * the stage.
+ */
+void pkttrace_drop(uint8_t stage, uint8_t reason);
+
+/**
+ * Count the drop of a packet that already left the pipeline, such as
+ * a datagram whose reassembly timed out.
+ */
+void pkttrace_lost(uint8_t reason);
+
+/**
+ * Clear the histograms, drop counters and the ring.
+ */
+void pkttrace_reset(void);
+
+#define PKTTRACE_STAGE(stage)        pkttrace_stage(stage)
+#define PKTTRACE_DROP(stage, reason) pkttrace_drop(stage, reason)
+#define PKTTRACE_LOST(reason)        pkttrace_lost(reason)
+
+#else /* PKTTRACE_ENABLED */
+
+#define PKTTRACE_STAGE(stage)
+#define PKTTRACE_DROP(stage, reason)
+#define PKTTRACE_LOST(reason)
+
+#endif /* PKTTRACE_ENABLED */
+
+#endif /* __PKTTRACE_H__ */
@@ -68,6 +68,7 @@
 #include "net/sicslowpan.h"
 #include "net/neighbor-info.h"
 #include "net/netstack.h"
+#include "net/pkttrace.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -212,18 +213,47 @@ static u8_t uncomp_hdr_len;
 
 static uint16_t sicslowpan_len;
 
+/** Size of the bitmap of received 8-byte units of a reassembled packet. */
+#define REASS_BITMAP_SIZE (((UIP_BUFSIZE + 7) / 8 + 7) / 8)
+
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * A datagram being reassembled from fragments, identified by the
+ * sender, tag and size of its fragments.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+struct sicslowpan_reass {
+  /**
+   * The IPv6 packet (no MAC header, 6lowpan, etc). It has a fix size
+   * as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+  /** The source address of the fragments being merged. */
+  rimeaddr_t sender;
+  /** The tag in the fragments being merged. */
+  uint16_t tag;
+  /** The total length of the IPv6 packet, 0 if the context is free. */
+  uint16_t size;
+  /**
+   * length of the ip packet already received.
+   * It includes IP and transport headers.
+   */
+  uint16_t received;
+  /** Reassembly %process %timer, its start orders the contexts by age. */
+  struct timer timer;
+  /** The 8-byte units of the packet that have been received. */
+  uint8_t bitmap[REASS_BITMAP_SIZE];
+};
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+static struct sicslowpan_reass reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
 /**
- * length of the ip packet already sent / received.
+ * The buffer the packet being received is uncompressed into: the
+ * buffer of its reassembly context, or uip_buf if it is not
+ * fragmented.
+ */
+static uint8_t *sicslowpan_buf;
+
+/**
+ * length of the ip packet already sent.
  * It includes IP and transport headers.
  */
 static uint16_t processed_ip_len;
@@ -231,15 +261,6 @@ static uint16_t processed_ip_len;
 /** Datagram tag to be put in the fragments I send. */
 static uint16_t my_tag;
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
-
-/** When reassembling, the source address of the fragments being merged */
-rimeaddr_t frag_sender;
-
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
-
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
 /** The buffer used for the 6lowpan processing is uip_buf.
@@ -1243,6 +1264,24 @@ packet_sent(void *ptr, int status, int transmissions)
 #if SICSLOWPAN_CONF_NEIGHBOR_INFO
   neighbor_info_packet_sent(status, transmissions);
 #endif /* SICSLOWPAN_CONF_NEIGHBOR_INFO */
+#if PKTTRACE_ENABLED
+  switch(status) {
+  case MAC_TX_OK:
+    PKTTRACE_STAGE(PKTTRACE_OUT_DONE);
+    break;
+  case MAC_TX_COLLISION:
+    PKTTRACE_DROP(PKTTRACE_OUT_DONE, PKTTRACE_DROP_MAC_COLLISION);
+    break;
+  case MAC_TX_NOACK:
+    PKTTRACE_DROP(PKTTRACE_OUT_DONE, PKTTRACE_DROP_MAC_NOACK);
+    break;
+  case MAC_TX_DEFERRED:
+    break;
+  default:
+    PKTTRACE_DROP(PKTTRACE_OUT_DONE, PKTTRACE_DROP_MAC_ERR);
+    break;
+  }
+#endif /* PKTTRACE_ENABLED */
 }
 /*--------------------------------------------------------------------*/
 /**
@@ -1298,6 +1337,8 @@ output(uip_lladdr_t *localdest)
   packetbuf_clear();
   rime_ptr = packetbuf_dataptr();
 
+  PKTTRACE_STAGE(PKTTRACE_OUT_SICSLOWPAN);
+
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
 
@@ -1382,6 +1423,7 @@ output(uip_lladdr_t *localdest)
     q = queuebuf_new_from_packetbuf();
     if(q == NULL) {
       PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
+      PKTTRACE_DROP(PKTTRACE_OUT_SICSLOWPAN, PKTTRACE_DROP_QUEUE_FULL);
       return 0;
     }
     send_packet(&dest);
@@ -1420,6 +1462,7 @@ output(uip_lladdr_t *localdest)
       q = queuebuf_new_from_packetbuf();
       if(q == NULL) {
         PRINTFO("could not allocate queuebuf, dropping fragment\n");
+        PKTTRACE_DROP(PKTTRACE_OUT_SICSLOWPAN, PKTTRACE_DROP_QUEUE_FULL);
         return 0;
       }
       send_packet(&dest);
@@ -1434,6 +1477,7 @@ output(uip_lladdr_t *localdest)
     processed_ip_len = 0;
 #else /* SICSLOWPAN_CONF_FRAG */
     PRINTFO("sicslowpan output: Packet too large to be sent without fragmentation support; dropping packet\n");
+    PKTTRACE_DROP(PKTTRACE_OUT_SICSLOWPAN, PKTTRACE_DROP_TOO_LARGE);
     return 0;
 #endif /* SICSLOWPAN_CONF_FRAG */
   } else {
@@ -1449,6 +1493,54 @@ output(uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the reassembly context of a fragment, start one if there
+ * is none
+ * \param size The size of the IP packet
+ * \param tag The tag of the fragment
+ * \return The context, the oldest one is dropped if all are in use
+ */
+static struct sicslowpan_reass *
+reass_context(uint16_t size, uint16_t tag)
+{
+  struct sicslowpan_reass *r, *oldest = NULL;
+  rimeaddr_t *sender = (rimeaddr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER);
+
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+    if(r->size != 0 && timer_expired(&r->timer)) {
+      /* reassembly timed out, cancel it */
+      PRINTFI("sicslowpan input: reassembly (tag %d) timed out\n", r->tag);
+      PKTTRACE_LOST(PKTTRACE_DROP_REASS_TIMEOUT);
+      r->size = 0;
+    }
+    if(r->size == size && r->tag == tag && rimeaddr_cmp(&r->sender, sender)) {
+      return r;
+    }
+    if(oldest == NULL || (oldest->size != 0 &&
+       (r->size == 0 || timer_remaining(&r->timer) < timer_remaining(&oldest->timer)))) {
+      oldest = r;
+    }
+  }
+
+  if(oldest->size != 0) {
+    PRINTFI("sicslowpan input: dropping reassembly (tag %d) for a new packet\n",
+            oldest->tag);
+    PKTTRACE_LOST(PKTTRACE_DROP_REASS_EVICTED);
+  }
+  oldest->size = size;
+  oldest->tag = tag;
+  oldest->received = 0;
+  rimeaddr_copy(&oldest->sender, sender);
+  memset(oldest->bitmap, 0, sizeof(oldest->bitmap));
+  timer_set(&oldest->timer, SICSLOWPAN_REASS_MAXAGE*CLOCK_SECOND);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  return oldest;
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1459,6 +1551,11 @@ output(uip_lladdr_t *localdest)
  *  copied in siclowpan_buf. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
+ *  Fragments are reassembled in one of SICSLOWPAN_REASS_CONTEXTS
+ *  contexts, so that datagrams from several senders can be merged at
+ *  the same time. A bitmap of the received 8-byte units drops
+ *  duplicate fragments.
+ *
  * \note We do not check for overlapping sicslowpan fragments
  * (it is a SHALL in the RFC 4944 and should never happen)
  */
@@ -1473,6 +1570,9 @@ input(void)
   /* tag of the fragment */
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0;
+  /* reassembly context of the fragment */
+  struct sicslowpan_reass *reass = NULL;
+  uint16_t len, unit;
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1482,12 +1582,9 @@ input(void)
   /* The MAC puts the 15.4 payload inside the RIME data buffer */
   rime_ptr = packetbuf_dataptr();
 
+  PKTTRACE_STAGE(PKTTRACE_IN_SICSLOWPAN);
+
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_len = 0;
-  }
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1523,34 +1620,17 @@ input(void)
       break;
   }
 
-  if(processed_ip_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+  if(frag_size > 0) {
+    if(frag_size > UIP_BUFSIZE - UIP_LLH_LEN) {
+      PRINTFI("sicslowpan input: Dropping fragment of a packet larger than uip_buf\n");
+      PKTTRACE_DROP(PKTTRACE_IN_SICSLOWPAN, PKTTRACE_DROP_TOO_LARGE);
       return;
     }
+    reass = reass_context(frag_size, frag_tag);
+    sicslowpan_buf = reass->buf.u8;
   } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if(frag_size > 0) {
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE*CLOCK_SECOND);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      rimeaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    }
+    /* the packet is not fragmented, uncompress it in place */
+    sicslowpan_buf = uip_buf;
   }
 
   if(rime_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1588,6 +1668,7 @@ input(void)
       /* unknown header */
       PRINTFI("sicslowpan input: unknown dispatch: %u\n",
              RIME_HC1_PTR[RIME_HC1_DISPATCH]);
+      PKTTRACE_DROP(PKTTRACE_IN_SICSLOWPAN, PKTTRACE_DROP_BAD_FRAME);
       return;
   }
    
@@ -1604,20 +1685,48 @@ input(void)
    */
   if(packetbuf_datalen() < rime_hdr_len) {
     PRINTF("SICSLOWPAN: packet dropped due to header > total packet\n");
+    PKTTRACE_DROP(PKTTRACE_IN_SICSLOWPAN, PKTTRACE_DROP_BAD_FRAME);
     return;
   }
   rime_payload_len = packetbuf_datalen() - rime_hdr_len;
+
+#if SICSLOWPAN_CONF_FRAG
+  if(frag_size > 0) {
+    len = uncomp_hdr_len + rime_payload_len;
+    if((uint16_t)(frag_offset << 3) + len > frag_size) {
+      PRINTFI("sicslowpan input: Dropping fragment beyond the packet size\n");
+      PKTTRACE_DROP(PKTTRACE_IN_SICSLOWPAN, PKTTRACE_DROP_BAD_FRAME);
+      return;
+    }
+    /* Skip fragments that have been received already. */
+    if(reass->bitmap[frag_offset >> 3] & (1 << (frag_offset & 7))) {
+      PRINTFI("sicslowpan input: Dropping duplicate fragment (offset %d)\n",
+              frag_offset);
+      PKTTRACE_DROP(PKTTRACE_IN_SICSLOWPAN, PKTTRACE_DROP_DUPLICATE);
+      return;
+    }
+    for(unit = frag_offset; (unit - frag_offset) << 3 < len; unit++) {
+      reass->bitmap[unit >> 3] |= 1 << (unit & 7);
+    }
+  }
+#endif /* SICSLOWPAN_CONF_FRAG */
+
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), rime_ptr + rime_hdr_len, rime_payload_len);
   
-  /* update processed_ip_len if fragment, sicslowpan_len otherwise */
+  /* update the received length if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
   if(frag_size > 0) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      processed_ip_len += uncomp_hdr_len;
+      reass->received += uncomp_hdr_len;
     }
-    processed_ip_len += rime_payload_len;
+    reass->received += rime_payload_len;
+    if(reass->received < reass->size) {
+      return;
+    }
+    sicslowpan_len = reass->size;
+    reass->size = 0;
   } else {
 #endif /* SICSLOWPAN_CONF_FRAG */
     sicslowpan_len = rime_payload_len + uncomp_hdr_len;
@@ -1625,38 +1734,35 @@ input(void)
   }
 
   /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
+   * We have a full IP packet in sicslowpan_buf, deliver it to the IP
+   * stack
    */
-  if(processed_ip_len == 0 || (processed_ip_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
+  PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
+          sicslowpan_len);
+  if(sicslowpan_buf != uip_buf) {
     memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_len = 0;
+  }
+  uip_len = sicslowpan_len;
+  sicslowpan_len = 0;
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
-    {
-      uint8_t tmp;
-      PRINTF("after decompression: ");
-      for (tmp = 0; tmp < SICSLOWPAN_IP_BUF->len[1] + 40; tmp++) {
-	uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[tmp];
-	PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint8_t tmp;
+    PRINTF("after decompression: ");
+    for (tmp = 0; tmp < SICSLOWPAN_IP_BUF->len[1] + 40; tmp++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[tmp];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
 #if SICSLOWPAN_CONF_NEIGHBOR_INFO
-    neighbor_info_packet_received();
+  neighbor_info_packet_received();
 #endif /* SICSLOWPAN_CONF_NEIGHBOR_INFO */
 
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
-  }
-#endif /* SICSLOWPAN_CONF_FRAG */
+  tcpip_input();
 }
 /** @} */
 
@@ -45,6 +45,8 @@
 
 #include "net/uip-packetqueue.h"
 
+#include "net/pkttrace.h"
+
 #include <string.h>
 
 #if UIP_CONF_IPV6
@@ -539,7 +541,9 @@ eventhandler(process_event_t ev, process_data_t data)
 void
 tcpip_input(void)
 {
+  PKTTRACE_STAGE(PKTTRACE_IN_TCPIP);
   process_post_synch(&tcpip_process, PACKET_INPUT, NULL);
+  PKTTRACE_STAGE(PKTTRACE_IN_DONE);
   uip_len = 0;
 #if UIP_CONF_IPV6
   uip_ext_len = 0;
@@ -556,9 +560,12 @@ tcpip_ipv6_output(void)
   if(uip_len == 0) {
     return;
   }
+
+  PKTTRACE_STAGE(PKTTRACE_OUT_TCPIP);
   
   if(uip_len > UIP_LINK_MTU) {
     UIP_LOG("tcpip_ipv6_output: Packet to big");
+    PKTTRACE_DROP(PKTTRACE_OUT_TCPIP, PKTTRACE_DROP_TOO_LARGE);
     uip_len = 0;
     return;
   }
@@ -581,6 +588,7 @@ tcpip_ipv6_output(void)
 	  UIP_FALLBACK_INTERFACE.output();
 #else
           PRINTF("tcpip_ipv6_output: Destination off-link but no route\n");
+          PKTTRACE_DROP(PKTTRACE_OUT_TCPIP, PKTTRACE_DROP_NO_ROUTE);
 #endif
           uip_len = 0;
           return;
@@ -594,6 +602,7 @@ tcpip_ipv6_output(void)
       //      printf("add1 %d\n", nexthop->u8[15]);
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE)) == NULL) {
         //        printf("add n\n");
+        PKTTRACE_DROP(PKTTRACE_OUT_TCPIP, PKTTRACE_DROP_NO_ROUTE);
         uip_len = 0;
         return;
       } else {
@@ -689,7 +698,7 @@ tcpip_ipv6_output(void)
 void
 tcpip_poll_udp(struct uip_udp_conn *conn)
 {
-  process_post(&tcpip_process, UDP_POLL, conn);
+  process_post_prio(&tcpip_process, UDP_POLL, conn, PROCESS_PRIO_HIGH);
 }
 #endif /* UIP_UDP */
 /*---------------------------------------------------------------------------*/
@@ -697,7 +706,7 @@ tcpip_poll_udp(struct uip_udp_conn *conn)
 void
 tcpip_poll_tcp(struct uip_conn *conn)
 {
-  process_post(&tcpip_process, TCP_POLL, conn);
+  process_post_prio(&tcpip_process, TCP_POLL, conn, PROCESS_PRIO_HIGH);
 }
 #endif /* UIP_TCP */
 /*---------------------------------------------------------------------------*/
@@ -80,6 +80,67 @@ uip_ds6_route_t uip_ds6_routing_table[UIP_DS6_ROUTE_NB];          /** \brief Rou
 
 /** @} */
 
+#if UIP_DS6_NBR_HASH || UIP_DS6_ROUTE_HASH
+/*
+ * A hash index over one of the arrays. The buckets and the chains hold
+ * the position in the array plus one, 0 ends a chain. Lookups check
+ * that an entry is used and matches, so entries released by clearing
+ * isused are just skipped until their slot is reused.
+ */
+#define INDEX_END 0
+
+static uint16_t
+hash_addr(uip_ipaddr_t *ipaddr, uint8_t bytes)
+{
+  uint16_t h = bytes;
+  uint8_t i;
+
+  for(i = 0; i < bytes; i++) {
+    h = (h << 5) + h + ipaddr->u8[i];
+  }
+  return h ^ (h >> 7);
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_link(uint16_t *bucket, uint16_t *next, uint16_t slot)
+{
+  next[slot] = *bucket;
+  *bucket = slot + 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+index_unlink(uint16_t *bucket, uint16_t *next, uint16_t slot)
+{
+  uint16_t *p;
+
+  for(p = bucket; *p != INDEX_END; p = &next[*p - 1]) {
+    if(*p == slot + 1) {
+      *p = next[slot];
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* UIP_DS6_NBR_HASH || UIP_DS6_ROUTE_HASH */
+
+#if UIP_DS6_NBR_HASH
+static uint16_t nbr_buckets[UIP_DS6_NBR_HASH_SIZE];
+static uint16_t nbr_next[UIP_DS6_NBR_NB];
+#define NBR_BUCKET(ipaddr) \
+  (&nbr_buckets[hash_addr(ipaddr, 16) & (UIP_DS6_NBR_HASH_SIZE - 1)])
+#endif /* UIP_DS6_NBR_HASH */
+
+#if UIP_DS6_ROUTE_HASH
+/* Routes are hashed on the bytes of the prefix that
+   uip_ipaddr_prefixcmp() compares, i.e. on length / 8 bytes. */
+static uint16_t route_buckets[UIP_DS6_ROUTE_HASH_SIZE];
+static uint16_t route_next[UIP_DS6_ROUTE_NB];
+/* number of routes per prefix length in bytes */
+static uint16_t route_bytes[17];
+#define ROUTE_BUCKET(ipaddr, bytes) \
+  (&route_buckets[hash_addr(ipaddr, bytes) & (UIP_DS6_ROUTE_HASH_SIZE - 1)])
+#endif /* UIP_DS6_ROUTE_HASH */
+
 /* "full" (as opposed to pointer) ip address used in this file,  */
 static uip_ipaddr_t loc_fipaddr;
 
@@ -106,6 +167,13 @@ uip_ds6_init(void)
   memset(uip_ds6_prefix_list, 0, sizeof(uip_ds6_prefix_list));
   memset(&uip_ds6_if, 0, sizeof(uip_ds6_if));
   memset(uip_ds6_routing_table, 0, sizeof(uip_ds6_routing_table));
+#if UIP_DS6_NBR_HASH
+  memset(nbr_buckets, 0, sizeof(nbr_buckets));
+#endif /* UIP_DS6_NBR_HASH */
+#if UIP_DS6_ROUTE_HASH
+  memset(route_buckets, 0, sizeof(route_buckets));
+  memset(route_bytes, 0, sizeof(route_bytes));
+#endif /* UIP_DS6_ROUTE_HASH */
 
   /* Set interface parameters */
   uip_ds6_if.link_mtu = UIP_LINK_MTU;
@@ -280,12 +348,33 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t * lladdr,
 {
   int r;
 
+#if UIP_DS6_NBR_HASH
+  if(uip_ds6_nbr_lookup(ipaddr) != NULL) {
+    r = FOUND;
+  } else {
+    r = NOSPACE;
+    for(locnbr = uip_ds6_nbr_cache;
+        locnbr < &uip_ds6_nbr_cache[UIP_DS6_NBR_NB]; locnbr++) {
+      if(!locnbr->isused) {
+        r = FREESPACE;
+        break;
+      }
+    }
+  }
+#else /* UIP_DS6_NBR_HASH */
   r = uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_nbr_cache, UIP_DS6_NBR_NB,
       sizeof(uip_ds6_nbr_t), ipaddr, 128,
       (uip_ds6_element_t **)&locnbr);
+#endif /* UIP_DS6_NBR_HASH */
 
   if(r == FREESPACE) {
+#if UIP_DS6_NBR_HASH
+    /* the slot may still be indexed under a released address */
+    index_unlink(NBR_BUCKET(&locnbr->ipaddr), nbr_next,
+                 locnbr - uip_ds6_nbr_cache);
+    index_link(NBR_BUCKET(ipaddr), nbr_next, locnbr - uip_ds6_nbr_cache);
+#endif /* UIP_DS6_NBR_HASH */
     locnbr->isused = 1;
     uip_ipaddr_copy(&locnbr->ipaddr, ipaddr);
     if(lladdr != NULL) {
@@ -344,6 +433,9 @@ void
 uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 {
   if(nbr != NULL) {
+#if UIP_DS6_NBR_HASH
+    index_unlink(NBR_BUCKET(&nbr->ipaddr), nbr_next, nbr - uip_ds6_nbr_cache);
+#endif /* UIP_DS6_NBR_HASH */
     nbr->isused = 0;
 #if UIP_CONF_IPV6_QUEUE_PKT
     uip_packetqueue_free(&nbr->packethandle);
@@ -357,6 +449,17 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 uip_ds6_nbr_t *
 uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr)
 {
+#if UIP_DS6_NBR_HASH
+  uint16_t i;
+
+  for(i = *NBR_BUCKET(ipaddr); i != INDEX_END; i = nbr_next[i - 1]) {
+    locnbr = &uip_ds6_nbr_cache[i - 1];
+    if(locnbr->isused && uip_ipaddr_cmp(&locnbr->ipaddr, ipaddr)) {
+      return locnbr;
+    }
+  }
+  return NULL;
+#else /* UIP_DS6_NBR_HASH */
   if(uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_nbr_cache, UIP_DS6_NBR_NB,
       sizeof(uip_ds6_nbr_t), ipaddr, 128,
@@ -364,6 +467,7 @@ uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr)
     return locnbr;
   }
   return NULL;
+#endif /* UIP_DS6_NBR_HASH */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -709,17 +813,73 @@ uip_ds6_aaddr_lookup(uip_ipaddr_t *ipaddr)
   return NULL;
 }
 
+/*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+/*---------------------------------------------------------------------------*/
+static void
+route_link(uip_ds6_route_t *route)
+{
+  index_link(ROUTE_BUCKET(&route->ipaddr, route->length >> 3), route_next,
+             route - uip_ds6_routing_table);
+  route_bytes[route->length >> 3]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_unlink(uip_ds6_route_t *route)
+{
+  if(index_unlink(ROUTE_BUCKET(&route->ipaddr, route->length >> 3),
+                  route_next, route - uip_ds6_routing_table)) {
+    route_bytes[route->length >> 3]--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the route of the given prefix, or with match set the longest
+   prefix route that contains the address. */
+static uip_ds6_route_t *
+route_find(uip_ipaddr_t *ipaddr, uint8_t length, uint8_t match)
+{
+  uip_ds6_route_t *route, *found = NULL;
+  uint16_t i;
+  int8_t bytes, lowest;
+
+  lowest = match ? 0 : length >> 3;
+  for(bytes = match ? 16 : lowest; bytes >= lowest; bytes--) {
+    if(route_bytes[bytes] == 0) {
+      continue;
+    }
+    for(i = *ROUTE_BUCKET(ipaddr, bytes); i != INDEX_END; i = route_next[i - 1]) {
+      route = &uip_ds6_routing_table[i - 1];
+      if(route->isused && (route->length >> 3) == bytes &&
+         uip_ipaddr_prefixcmp(ipaddr, &route->ipaddr, route->length) &&
+         (match ? found == NULL || route->length > found->length :
+          route->length == length)) {
+        found = route;
+      }
+    }
+    if(found != NULL) {
+      break;
+    }
+  }
+  return found;
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *destipaddr)
 {
   uip_ds6_route_t *locrt = NULL;
+#if !UIP_DS6_ROUTE_HASH
   uint8_t longestmatch = 0;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("DS6: Looking up route for ");
   PRINT6ADDR(destipaddr);
   PRINTF("\n");
 
+#if UIP_DS6_ROUTE_HASH
+  locrt = route_find(destipaddr, 128, 1);
+#else /* UIP_DS6_ROUTE_HASH */
   for(locroute = uip_ds6_routing_table;
       locroute < uip_ds6_routing_table + UIP_DS6_ROUTE_NB; locroute++) {
     if((locroute->isused) && (locroute->length >= longestmatch)
@@ -730,6 +890,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *destipaddr)
       locrt = locroute;
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(locrt != NULL) {
     PRINTF("DS6: Found route:");
@@ -749,15 +910,52 @@ uip_ds6_route_t *
 uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length, uip_ipaddr_t *nexthop,
                   uint8_t metric)
 {
-  if(uip_ds6_list_loop
-     ((uip_ds6_element_t *)uip_ds6_routing_table, UIP_DS6_ROUTE_NB,
-      sizeof(uip_ds6_route_t), ipaddr, length,
-      (uip_ds6_element_t **)&locroute) == FREESPACE) {
+  uint8_t r;
+
+  /* A route is the same as another one if both prefix and length
+     match, a longer or shorter prefix is a route of its own. */
+#if UIP_DS6_ROUTE_HASH
+  locroute = route_find(ipaddr, length, 0);
+#else /* UIP_DS6_ROUTE_HASH */
+  for(locroute = uip_ds6_routing_table;
+      locroute < uip_ds6_routing_table + UIP_DS6_ROUTE_NB; locroute++) {
+    if(locroute->isused && locroute->length == length &&
+       uip_ipaddr_prefixcmp(&locroute->ipaddr, ipaddr, length)) {
+      break;
+    }
+  }
+  if(locroute == uip_ds6_routing_table + UIP_DS6_ROUTE_NB) {
+    locroute = NULL;
+  }
+#endif /* UIP_DS6_ROUTE_HASH */
+  if(locroute != NULL) {
+    r = FOUND;
+  } else {
+    r = NOSPACE;
+    for(locroute = uip_ds6_routing_table;
+        locroute < uip_ds6_routing_table + UIP_DS6_ROUTE_NB; locroute++) {
+      if(!locroute->isused) {
+        r = FREESPACE;
+        break;
+      }
+    }
+    if(r == NOSPACE) {
+      locroute = NULL;
+    }
+  }
+  if(r == FREESPACE) {
+#if UIP_DS6_ROUTE_HASH
+    /* the slot may still be indexed under a released route */
+    route_unlink(locroute);
+#endif /* UIP_DS6_ROUTE_HASH */
     locroute->isused = 1;
     uip_ipaddr_copy(&(locroute->ipaddr), ipaddr);
     locroute->length = length;
     uip_ipaddr_copy(&(locroute->nexthop), nexthop);
     locroute->metric = metric;
+#if UIP_DS6_ROUTE_HASH
+    route_link(locroute);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     PRINTF("DS6: adding route: ");
     PRINT6ADDR(ipaddr);
@@ -774,6 +972,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length, uip_ipaddr_t *nexthop,
 void
 uip_ds6_route_rm(uip_ds6_route_t *route)
 {
+#if UIP_DS6_ROUTE_HASH
+  route_unlink(route);
+#endif /* UIP_DS6_ROUTE_HASH */
   route->isused = 0;
 #if (DEBUG & DEBUG_ANNOTATE) == DEBUG_ANNOTATE
   /* we need to check if this was the last route towards "nexthop" */
@@ -797,6 +998,9 @@ uip_ds6_route_rm_by_nexthop(uip_ipaddr_t *nexthop)
       locroute < uip_ds6_routing_table + UIP_DS6_ROUTE_NB;
       locroute++) {
     if(locroute->isused && uip_ipaddr_cmp(&locroute->nexthop, nexthop)) {
+#if UIP_DS6_ROUTE_HASH
+      route_unlink(locroute);
+#endif /* UIP_DS6_ROUTE_HASH */
       locroute->isused = 0;
     }
   }
@@ -89,6 +89,48 @@
 #endif
 #define UIP_DS6_ROUTE_NB UIP_DS6_ROUTE_NBS + UIP_DS6_ROUTE_NBU
 
+/*
+ * Indexes of the neighbor cache and of the routing table. With
+ * UIP_CONF_DS6_NBR_HASH the neighbor cache is indexed by a hash of the
+ * address, with UIP_CONF_DS6_ROUTE_HASH the routes are indexed by a
+ * hash of their prefix per prefix length, so that lookups do not scan
+ * the arrays. The number of buckets (a power of two) can be set with
+ * UIP_CONF_DS6_NBR_HASH_SIZE and UIP_CONF_DS6_ROUTE_HASH_SIZE.
+ */
+#ifndef UIP_CONF_DS6_NBR_HASH
+#define UIP_DS6_NBR_HASH 0
+#else
+#define UIP_DS6_NBR_HASH UIP_CONF_DS6_NBR_HASH
+#endif
+#ifndef UIP_CONF_DS6_NBR_HASH_SIZE
+#if UIP_DS6_NBR_NB <= 16
+#define UIP_DS6_NBR_HASH_SIZE 16
+#elif UIP_DS6_NBR_NB <= 128
+#define UIP_DS6_NBR_HASH_SIZE 128
+#else
+#define UIP_DS6_NBR_HASH_SIZE 1024
+#endif
+#else
+#define UIP_DS6_NBR_HASH_SIZE UIP_CONF_DS6_NBR_HASH_SIZE
+#endif
+
+#ifndef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_DS6_ROUTE_HASH 0
+#else
+#define UIP_DS6_ROUTE_HASH UIP_CONF_DS6_ROUTE_HASH
+#endif
+#ifndef UIP_CONF_DS6_ROUTE_HASH_SIZE
+#if UIP_DS6_ROUTE_NB <= 16
+#define UIP_DS6_ROUTE_HASH_SIZE 16
+#elif UIP_DS6_ROUTE_NB <= 128
+#define UIP_DS6_ROUTE_HASH_SIZE 128
+#else
+#define UIP_DS6_ROUTE_HASH_SIZE 1024
+#endif
+#else
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_CONF_DS6_ROUTE_HASH_SIZE
+#endif
+
 /* Unicast address list*/
 #define UIP_DS6_ADDR_NBS 1
 #ifndef UIP_CONF_DS6_ADDR_NBU
@@ -474,6 +474,17 @@
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * How many datagrams are reassembled from fragments at the same time,
+ * each one needs a buffer of UIP_BUFSIZE bytes. When all of them are
+ * in use, the oldest reassembly is dropped for a new datagram.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -54,6 +54,228 @@ static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
+#if ETIMER_CONF_HEAP
+/*
+ * The pending timers form a pairing heap rooted at timerlist. The
+ * children of a timer are linked through next, and prev points to
+ * the previous sibling or, for the first child, to the parent.
+ */
+
+#define EXPIRATION(t) ((t)->timer.start + (t)->timer.interval)
+
+/* Wrap-safe comparison of two points in time less than half the clock
+   range apart. */
+#define BEFORE(a, b) ((clock_time_t)((a) - (b)) > ((clock_time_t)~0 >> 1))
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  next_expiration = timerlist == NULL ? 0 : EXPIRATION(timerlist);
+}
+/*---------------------------------------------------------------------------*/
+/* A timer is in the heap when its tag points to itself. The tag is set
+   on insertion and cleared on removal, so a timer that was never set,
+   such as one in a struct from memb_alloc(), is not taken for a
+   pending one and its garbage link fields are never followed. */
+static int
+on_heap(struct etimer *t)
+{
+  return t->tag == t;
+}
+/*---------------------------------------------------------------------------*/
+/* Links two heaps, the roots must not have siblings. */
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if(BEFORE(EXPIRATION(b), EXPIRATION(a))) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/* Melds a list of siblings into one heap in two passes. */
+static struct etimer *
+meld_siblings(struct etimer *first)
+{
+  struct etimer *a, *b, *pairs, *heap;
+
+  /* Meld the siblings in pairs from left to right and stack up the
+     results through next. */
+  pairs = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    first = b == NULL ? NULL : b->next;
+    a->next = a->prev = NULL;
+    if(b != NULL) {
+      b->next = b->prev = NULL;
+      a = meld(a, b);
+    }
+    a->next = pairs;
+    pairs = a;
+  }
+
+  /* Meld the pairs from right to left. */
+  heap = NULL;
+  while(pairs != NULL) {
+    a = pairs;
+    pairs = a->next;
+    a->next = NULL;
+    heap = meld(heap, a);
+  }
+  return heap;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *t)
+{
+  struct etimer *children;
+
+  if(t == timerlist) {
+    timerlist = meld_siblings(t->child);
+  } else {
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    children = meld_siblings(t->child);
+    timerlist = meld(timerlist, children);
+  }
+  t->next = t->prev = t->child = t->tag = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *t)
+{
+  t->next = t->prev = t->child = NULL;
+  t->tag = t;
+  timerlist = meld(timerlist, t);
+}
+/*---------------------------------------------------------------------------*/
+/* Removes the timers of an exited process by rebuilding the heap. */
+static void
+remove_process(struct process *p)
+{
+  struct etimer *t, *list, *last;
+
+  list = timerlist;
+  timerlist = NULL;
+  while(list != NULL) {
+    t = list;
+    list = t->next;
+    if(t->child != NULL) {
+      /* Queue the children of the timer. */
+      for(last = t->child; last->next != NULL; last = last->next);
+      last->next = list;
+      list = t->child;
+    }
+    if(t->p == p) {
+      t->next = t->prev = t->child = t->tag = NULL;
+    } else {
+      insert_timer(t);
+    }
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t;
+
+  PROCESS_BEGIN();
+
+  timerlist = NULL;
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      remove_process(data);
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+	etimer_request_poll();
+	break;
+      }
+      /* Reset the process ID of the event timer, to signal that the
+	 etimer has expired. This is later checked in the
+	 etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      remove_timer(t);
+    }
+    update_time();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  if(on_heap(timer)) {
+    /* The expiration time changed, move the timer in the heap but
+       keep its process like the list does. */
+    remove_timer(timer);
+  } else {
+    timer->p = PROCESS_CURRENT();
+  }
+  insert_timer(timer);
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_adjust(struct etimer *et, int timediff)
+{
+  if(on_heap(et)) {
+    remove_timer(et);
+    et->timer.start += timediff;
+    insert_timer(et);
+  } else {
+    et->timer.start += timediff;
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_stop(struct etimer *et)
+{
+  if(on_heap(et)) {
+    remove_timer(et);
+    update_time();
+  }
+  /* Set the timer as expired */
+  et->p = PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_CONF_HEAP */
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -142,12 +364,6 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
-void
-etimer_request_poll(void)
-{
-  process_poll(&etimer_process);
-}
-/*---------------------------------------------------------------------------*/
 static void
 add_timer(struct etimer *timer)
 {
@@ -175,6 +391,50 @@ add_timer(struct etimer *timer)
 }
 /*---------------------------------------------------------------------------*/
 void
+etimer_adjust(struct etimer *et, int timediff)
+{
+  et->timer.start += timediff;
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_stop(struct etimer *et)
+{
+  struct etimer *t;
+
+  /* First check if et is the first event timer on the list. */
+  if(et == timerlist) {
+    timerlist = timerlist->next;
+    update_time();
+  } else {
+    /* Else walk through the list and try to find the item before the
+       et timer. */
+    for(t = timerlist; t != NULL && t->next != et; t = t->next);
+
+    if(t != NULL) {
+      /* We've found the item before the event timer that we are about
+	 to remove. We point the items next pointer to the event after
+	 the removed item. */
+      t->next = et->next;
+
+      update_time();
+    }
+  }
+
+  /* Remove the next pointer from the item to be removed. */
+  et->next = NULL;
+  /* Set the timer as expired */
+  et->p = PROCESS_NONE;
+}
+#endif /* ETIMER_CONF_HEAP */
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
+void
 etimer_set(struct etimer *et, clock_time_t interval)
 {
   timer_set(&et->timer, interval);
@@ -195,13 +455,6 @@ etimer_restart(struct etimer *et)
   add_timer(et);
 }
 /*---------------------------------------------------------------------------*/
-void
-etimer_adjust(struct etimer *et, int timediff)
-{
-  et->timer.start += timediff;
-  update_time();
-}
-/*---------------------------------------------------------------------------*/
 int
 etimer_expired(struct etimer *et)
 {
@@ -232,34 +485,4 @@ etimer_next_expiration_time(void)
   return etimer_pending() ? next_expiration : 0;
 }
 /*---------------------------------------------------------------------------*/
-void
-etimer_stop(struct etimer *et)
-{
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
-  }
-
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
-  /* Set the timer as expired */
-  et->p = PROCESS_NONE;
-}
-/*---------------------------------------------------------------------------*/
 /** @} */
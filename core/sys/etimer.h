@@ -66,6 +66,20 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * Keep the pending event timers in a pairing heap ordered by their
+ * expiration times instead of an unsorted list. Adding a timer then
+ * takes constant time and stopping or expiring one takes amortized
+ * logarithmic time, at the cost of three more pointers per timer. A
+ * timer needs no initialization before it is set. All
+ * pending timers must expire within half the range of clock_time_t
+ * of each other, which rules the heap out for long timers on
+ * platforms with a 16-bit clock.
+ */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -78,6 +92,11 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_CONF_HEAP
+  struct etimer *child;
+  struct etimer *prev;
+  struct etimer *tag;
+#endif /* ETIMER_CONF_HEAP */
 };
 
 /**
@@ -45,6 +45,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
@@ -66,11 +67,32 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * Each priority lane is a FIFO ring of its own, do_event() serves the
+ * high priority lane first. nevents counts the events of all lanes.
+ */
+struct event_lane {
+  struct event_data *events;
+  process_num_events_t size, nevents, fevent;
+};
+
+static process_num_events_t nevents;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#if PROCESS_CONF_NUMEVENTS_HIGH
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+static struct event_lane lanes[PROCESS_LANES] = {
+  { events, PROCESS_CONF_NUMEVENTS, 0, 0 },
+#if PROCESS_CONF_NUMEVENTS_HIGH
+  { events_high, PROCESS_CONF_NUMEVENTS_HIGH, 0, 0 },
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+};
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+process_num_events_t process_lane_maxevents[PROCESS_LANES];
+unsigned short process_lane_dropped[PROCESS_LANES];
 #endif
 
 static volatile unsigned char poll_requested;
@@ -208,11 +230,18 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_LANES; i++) {
+    lanes[i].nevents = lanes[i].fevent = 0;
+  }
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  memset(process_lane_maxevents, 0, sizeof(process_lane_maxevents));
+  memset(process_lane_dropped, 0, sizeof(process_lane_dropped));
 #endif /* PROCESS_CONF_STATS */
 
   process_current = process_list = NULL;
@@ -250,26 +279,34 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  static struct event_lane *lane;
   
   /*
-   * If there are any events in the queue, take the first one and walk
-   * through the list of processes to see if the event should be
-   * delivered to any of them. If so, we call the event handler
-   * function for the process. We only process one event at a time and
-   * call the poll handlers inbetween.
+   * If there are any events in the queue, take the first one of the
+   * highest priority lane that has one and walk through the list of
+   * processes to see if the event should be delivered to any of
+   * them. If so, we call the event handler function for the
+   * process. We only process one event at a time and call the poll
+   * handlers inbetween.
    */
 
   if(nevents > 0) {
+
+    lane = &lanes[PROCESS_LANES - 1];
+    while(lane->nevents == 0) {
+      lane--;
+    }
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = lane->events[lane->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = lane->events[lane->fevent].data;
+    receiver = lane->events[lane->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    lane->fevent = (lane->fevent + 1) % lane->size;
+    --lane->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -302,13 +339,23 @@ do_event(void)
 int
 process_run(void)
 {
-  /* Process poll events. */
-  if(poll_requested) {
-    do_poll();
-  }
+  int i;
+
+  /* Deliver up to PROCESS_CONF_BATCH events, the poll handlers run
+     before each of them. */
+  for(i = 0; i < PROCESS_CONF_BATCH; i++) {
+    /* Process poll events. */
+    if(poll_requested) {
+      do_poll();
+    }
 
-  /* Process one event from the queue */
-  do_event();
+    if(nevents == 0) {
+      break;
+    }
+
+    /* Process one event from the queue */
+    do_event();
+  }
 
   return nevents + poll_requested;
 }
@@ -321,8 +368,21 @@ process_nevents(void)
 /*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data, PROCESS_PRIO_NORMAL);
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+		  unsigned char prio)
 {
   static process_num_events_t snum;
+  static struct event_lane *lane;
+
+  if(prio >= PROCESS_LANES) {
+    prio = PROCESS_LANES - 1;
+  }
+  lane = &lanes[prio];
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -333,7 +393,10 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(lane->nevents == lane->size) {
+#if PROCESS_CONF_STATS
+    process_lane_dropped[prio]++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -344,16 +407,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(lane->fevent + lane->nevents) % lane->size;
+  lane->events[snum].ev = ev;
+  lane->events[snum].data = data;
+  lane->events[snum].p = p;
+  ++lane->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
   if(nevents > process_maxevents) {
     process_maxevents = nevents;
   }
+  if(lane->nevents > process_lane_maxevents[prio]) {
+    process_lane_maxevents[prio] = lane->nevents;
+  }
 #endif /* PROCESS_CONF_STATS */
   
   return PROCESS_ERR_OK;
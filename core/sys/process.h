@@ -89,6 +89,36 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priorities
+ *
+ * Events posted with PROCESS_PRIO_HIGH go to a queue of their own
+ * with PROCESS_CONF_NUMEVENTS_HIGH entries, which is served before
+ * the PROCESS_CONF_NUMEVENTS queue of normal events. Without a high
+ * priority queue (the default) all events share one queue.
+ * @{
+ */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 0
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+#define PROCESS_PRIO_NORMAL   0
+#define PROCESS_PRIO_HIGH     1
+
+#if PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_LANES         2
+#else /* PROCESS_CONF_NUMEVENTS_HIGH */
+#define PROCESS_LANES         1
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+/** @} */
+
+/**
+ * The largest number of events process_run() delivers in one call.
+ */
+#ifndef PROCESS_CONF_BATCH
+#define PROCESS_CONF_BATCH 1
+#endif /* PROCESS_CONF_BATCH */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -365,6 +395,23 @@ CCIF void process_start(struct process *p, const char *arg);
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
+/**
+ * Post an asynchronous event with a priority.
+ *
+ * This function works like process_post(), but queues the event in
+ * the lane of the given priority. Events of a higher priority are
+ * delivered before all events of a lower priority.
+ *
+ * \param prio PROCESS_PRIO_NORMAL or PROCESS_PRIO_HIGH.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The queue of the priority was full and the
+ * event could not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev, void* data,
+                           unsigned char prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -490,7 +537,8 @@ void process_init(void);
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes up to PROCESS_CONF_BATCH events, calling
+ * the poll handlers again in between. The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -520,6 +568,15 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_CONF_STATS
+/** The largest number of events that were waiting at a time. */
+extern process_num_events_t process_maxevents;
+/** The largest number of events that were waiting in each lane. */
+extern process_num_events_t process_lane_maxevents[PROCESS_LANES];
+/** The number of events each lane rejected with PROCESS_ERR_FULL. */
+extern unsigned short process_lane_dropped[PROCESS_LANES];
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 CCIF extern struct process *process_list;
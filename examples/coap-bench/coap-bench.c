@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the CoAP server on the native platform. Encoded
+ *         requests are fed to the coap_server process through the
+ *         packet buffer as if uIP had received them, and the heap
+ *         allocations and memcpy() calls made while serving them are
+ *         counted. The same requests are served with COAP_CONF_ZERO_COPY
+ *         set and cleared.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "lib/random.h"
+
+#include "rest.h"
+#include "buffer.h"
+
+#define REQUESTS 100000
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + uip_ext_len])
+
+/* length of the IPv6 extension headers of the requests that carry them */
+#define EXT_LEN 8
+#define UIP_APP_BUF  (&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
+
+/* the server is linked with --wrap=malloc and --wrap=memcpy */
+void *__real_malloc(size_t size);
+void *__real_memcpy(void *dst, const void *src, size_t n);
+
+static unsigned long allocs, alloc_bytes, copies, copy_bytes;
+static unsigned long responses, response_bytes, response_sum, misdirected;
+static unsigned long last_sum, hello_calls;
+static uint8_t last_response[MAX_PAYLOAD_LEN];
+static uint16_t last_len;
+
+void *
+__wrap_malloc(size_t size)
+{
+  allocs++;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void *
+__wrap_memcpy(void *dst, const void *src, size_t n)
+{
+  copies++;
+  copy_bytes += n;
+  return __real_memcpy(dst, src, n);
+}
+/*---------------------------------------------------------------------------*/
+/* The parts of uIP the server uses. */
+uip_buf_t uip_aligned_buf;
+void *uip_appdata;
+u16_t uip_len, uip_slen;
+u8_t uip_ext_len, uip_flags;
+struct uip_udp_conn *uip_udp_conn;
+process_event_t tcpip_event = 0x90;
+static struct uip_udp_conn conns[2];
+static int num_conns;
+
+struct uip_udp_conn *
+udp_new(const uip_ipaddr_t *ripaddr, u16_t port, void *appstate)
+{
+  struct uip_udp_conn *c = &conns[num_conns++];
+  memset(c, 0, sizeof(*c));
+  return c;
+}
+
+void
+uip_process(u8_t flag)
+{
+  /* what would go out on the wire */
+  const u8_t *p = UIP_APP_BUF;
+  int i;
+
+  responses++;
+  response_bytes += uip_slen;
+  if(uip_udp_conn->rport != UIP_HTONS(5683) ||
+     uip_udp_conn->lport != UIP_HTONS(MOTE_SERVER_LISTEN_PORT)) {
+    misdirected++;
+  }
+  last_sum = 0;
+  for(i = 0; i < uip_slen; i++) {
+    response_sum = response_sum * 31 + p[i];
+    last_sum = last_sum * 31 + p[i];
+    if(i < sizeof(last_response)) {
+      last_response[i] = p[i];
+    }
+  }
+  last_len = uip_slen;
+}
+
+void
+tcpip_ipv6_output(void)
+{
+}
+
+u16_t
+uip_htons(u16_t val)
+{
+  return UIP_HTONS(val);
+}
+
+u32_t
+uip_htonl(u32_t val)
+{
+  return UIP_HTONL(val);
+}
+
+clock_time_t
+clock_time(void)
+{
+  return 0;
+}
+
+unsigned long
+clock_seconds(void)
+{
+  return 0;
+}
+
+unsigned short
+random_rand(void)
+{
+  return rand();
+}
+
+void
+set_global_address(void)
+{
+}
+
+void
+configure_routing(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+RESOURCE(hello, METHOD_GET, "hello");
+void
+hello_handler(REQUEST *request, RESPONSE *response)
+{
+  char name[16];
+  char text[48];
+  int len;
+
+  hello_calls++;
+  if(!rest_get_query_variable(request, "name", name, sizeof(name))) {
+    strcpy(name, "world");
+  }
+  len = sprintf(text, "Hello %s!", name);
+  rest_set_header_content_type(response, TEXT_PLAIN);
+  rest_set_response_payload(response, (uint8_t *)text, len);
+}
+
+/* a 1000 byte log served block by block */
+RESOURCE(log, METHOD_GET, "log");
+void
+log_handler(REQUEST *request, RESPONSE *response)
+{
+  static const char line[] = "0123456789abcdef";
+  uint8_t block[64];
+  uint32_t offset;
+  uint16_t size;
+  uint8_t more;
+  int i;
+
+  rest_get_block(request, &offset, &size, &more);
+  if(size > sizeof(block)) {
+    size = sizeof(block);
+  }
+  if(offset + size > 1000) {
+    size = 1000 - offset;
+  }
+  for(i = 0; i < size; i++) {
+    block[i] = line[(offset + i) % 16];
+  }
+  rest_set_response_payload(response, block, size);
+  rest_set_block_more(response, offset + size < 1000);
+}
+
+/* whole representations, one larger than a block and one smaller */
+static void
+text(RESPONSE *response, uint16_t len)
+{
+  uint8_t payload[COAP_MAX_BLOCK_SIZE + 2];
+
+  memset(payload, 'x', len);
+  rest_set_response_payload(response, payload, len);
+}
+
+RESOURCE(status, METHOD_GET, "status");
+void
+status_handler(REQUEST *request, RESPONSE *response)
+{
+  text(response, COAP_MAX_BLOCK_SIZE + 2);
+}
+
+RESOURCE(note, METHOD_GET, "note");
+void
+note_handler(REQUEST *request, RESPONSE *response)
+{
+  text(response, 40);
+}
+
+static unsigned long uploaded;
+
+RESOURCE(upload, METHOD_PUT, "upload");
+void
+upload_handler(REQUEST *request, RESPONSE *response)
+{
+  uint8_t *payload;
+
+  uploaded += coap_get_payload(request, &payload);
+}
+/*---------------------------------------------------------------------------*/
+struct request {
+  uint8_t buf[64];
+  uint16_t len;
+};
+static struct request requests[64];
+static int num_requests;
+
+static void
+encode(message_type type, coap_method_t method, char *url, char *query,
+       int block, uint32_t num, uint8_t more, uint16_t payload_len)
+{
+  static uint8_t payload[40];
+  struct request *r = &requests[num_requests++];
+  coap_packet_t *packet;
+
+  init_buffer(COAP_DATA_BUFF_SIZE);
+  packet = (coap_packet_t *)allocate_buffer(sizeof(coap_packet_t));
+  init_packet(packet);
+  packet->type = type;
+  coap_set_method(packet, method);
+  coap_set_header_uri(packet, url);
+  if(query) {
+    coap_set_option(packet, Option_Type_Uri_Query, strlen(query), (uint8_t *)query);
+  }
+  if(block) {
+    coap_set_header_block(packet, num, more, 32);
+  }
+  if(payload_len) {
+    coap_set_payload(packet, payload, payload_len);
+  }
+  r->len = serialize_packet(packet, r->buf);
+  delete_buffer();
+}
+
+static void
+receive(struct request *r, uint16_t tid, u8_t ext_len)
+{
+  /* as left by uIP for the UDP input callback, the extension headers
+     move the UDP header and the request back */
+  int i;
+
+  for(i = 0; i < r->len; i++) {
+    UIP_APP_BUF[ext_len + i] = r->buf[i];
+  }
+  UIP_APP_BUF[ext_len + 2] = tid >> 8;
+  UIP_APP_BUF[ext_len + 3] = tid & 0xff;
+  uip_appdata = UIP_APP_BUF;
+  uip_len = r->len + ext_len;
+  uip_ext_len = ext_len;
+  uip_flags = UIP_NEWDATA;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  UIP_UDP_BUF->srcport = UIP_HTONS(5683);
+  /* the server port, created first */
+  uip_udp_conn = &conns[0];
+
+  process_post_synch(&coap_server, tcpip_event, NULL);
+}
+
+/* An empty message of the type, as sent to acknowledge or reject. */
+static void
+encode_empty(message_type type)
+{
+  struct request *r = &requests[num_requests];
+
+  r->buf[0] = (1 << COAP_HEADER_VERSION_POSITION) | (type << COAP_HEADER_TYPE_POSITION);
+  r->buf[1] = 0;
+  r->len = 4;
+}
+
+/*
+ * A retransmitted CON gets the cached response without a handler call,
+ * an ACK or RST that matches no transaction gets no response.
+ */
+static int
+exchanges(void)
+{
+  unsigned long sum, calls, sent, copied;
+  int failed = 0;
+
+  /* CON hello */
+  receive(&requests[0], 60000, 0);
+  sum = last_sum;
+  calls = hello_calls;
+  sent = responses;
+  copied = copies;
+  receive(&requests[0], 60000, 0);
+  if(hello_calls != calls || responses != sent + 1 || last_sum != sum) {
+    printf("duplicate CON: %lu handler calls, %lu responses\n",
+           hello_calls - calls, responses - sent);
+    failed = 1;
+  }
+  printf("duplicate CON: %lu memcpy, %lu handler calls\n",
+         copies - copied, hello_calls - calls);
+
+  /* a new tid from the same client is a new request */
+  receive(&requests[0], 60001, 0);
+  if(hello_calls != calls + 1) {
+    printf("new CON: not handled\n");
+    failed = 1;
+  }
+
+  sent = responses;
+  calls = hello_calls;
+  encode_empty(MESSAGE_TYPE_ACK);
+  receive(&requests[num_requests], 60000, 0);
+  encode_empty(MESSAGE_TYPE_RST);
+  receive(&requests[num_requests], 60001, 0);
+  if(responses != sent || hello_calls != calls) {
+    printf("ACK, RST: %lu responses\n", responses - sent);
+    failed = 1;
+  }
+  return failed;
+}
+
+/*
+ * Returns the payload length of the last response and whether it has
+ * a Block option.
+ */
+static int
+last_block(uint8_t *has_block)
+{
+  coap_packet_t *packet;
+  block_option_t block;
+  int len;
+
+  init_buffer(COAP_DATA_BUFF_SIZE);
+  packet = (coap_packet_t *)allocate_buffer(sizeof(coap_packet_t));
+  parse_message(packet, last_response, last_len);
+  *has_block = coap_get_header_block(packet, &block);
+  len = packet->payload_len;
+  delete_buffer();
+  return len;
+}
+
+/*
+ * A whole representation is cut into blocks only if the client asks
+ * for a block or it does not fit the datagram; a representation larger
+ * than a block that fits goes out whole.
+ */
+static int
+blocks(void)
+{
+  static const struct {
+    char *url;
+    int block;
+    int payload_len;
+    uint8_t has_block;
+  } cases[] = {
+    {"status", 0, COAP_MAX_BLOCK_SIZE + 2, 0},
+    {"note", 0, 40, 0},
+    {"note", 1, 32, 1},
+  };
+  uint8_t has_block;
+  int i, len, failed = 0;
+
+  for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    num_requests = 0;
+    encode(MESSAGE_TYPE_CON, COAP_GET, cases[i].url, NULL, cases[i].block, 0, 0, 0);
+    receive(&requests[0], 61000 + i, 0);
+    len = last_block(&has_block);
+    if(len != cases[i].payload_len || has_block != cases[i].has_block) {
+      printf("GET %s%s: %d bytes, %s Block option\n", cases[i].url,
+             cases[i].block ? " with a Block option" : "", len,
+             has_block ? "a" : "no");
+      failed = 1;
+    }
+  }
+  return failed;
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* resources added for the dispatch curve */
+#define MAX_ITEMS 512
+#define ITEM_REQUESTS 20000
+
+static resource_t items[MAX_ITEMS];
+static char item_urls[MAX_ITEMS][8];
+static int num_items;
+static unsigned long item_calls;
+
+static void
+item_handler(REQUEST *request, RESPONSE *response)
+{
+  item_calls++;
+}
+
+/*
+ * Dispatch over a growing number of resources. Each lookup walks the
+ * chain of one of REST_HASH_SIZE buckets, which stays short while the
+ * resources do not outnumber the buckets.
+ */
+static int
+dispatch(void)
+{
+  static const int sizes[] = {16, 128, 512};
+  unsigned long calls;
+  double start;
+  unsigned i;
+  int n;
+
+  printf("%-10s %8s %10s %8s\n", "dispatch", "buckets", "resources",
+         "ns/req");
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for(; num_items < sizes[i]; num_items++) {
+      sprintf(item_urls[num_items], "r/%d", num_items);
+      items[num_items].methods_to_handle = METHOD_GET;
+      items[num_items].url = item_urls[num_items];
+      items[num_items].handler = item_handler;
+      rest_activate_resource(&items[num_items]);
+    }
+
+    srand(1);
+    num_requests = 0;
+    while(num_requests < sizeof(requests) / sizeof(requests[0])) {
+      encode(MESSAGE_TYPE_NON, COAP_GET, item_urls[rand() % num_items], NULL,
+             0, 0, 0, 0);
+    }
+
+    calls = item_calls;
+    start = now();
+    for(n = 0; n < ITEM_REQUESTS; n++) {
+      receive(&requests[n % num_requests], 62000 + n, 0);
+    }
+    start = now() - start;
+    printf("%-10s %8d %10d %8.1f\n", COAP_ZERO_COPY ? "zero-copy" : "copy",
+           REST_HASH_SIZE, num_items, start / ITEM_REQUESTS);
+    if(item_calls != calls + ITEM_REQUESTS) {
+      printf("%lu of %d requests dispatched\n", item_calls - calls,
+             ITEM_REQUESTS);
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  double start;
+  unsigned long n;
+
+  process_init();
+  process_start(&etimer_process, NULL);
+  rest_init();
+  rest_activate_resource(&resource_hello);
+  rest_activate_resource(&resource_log);
+  rest_activate_resource(&resource_upload);
+  rest_activate_resource(&resource_status);
+  rest_activate_resource(&resource_note);
+  while(process_run() > 0);
+
+  encode(MESSAGE_TYPE_CON, COAP_GET, "hello", NULL, 0, 0, 0, 0);
+  encode(MESSAGE_TYPE_CON, COAP_GET, "hello", "name=contiki", 0, 0, 0, 0);
+  encode(MESSAGE_TYPE_NON, COAP_GET, "missing", NULL, 0, 0, 0, 0);
+  encode(MESSAGE_TYPE_CON, COAP_GET, "log", NULL, 1, 5, 0, 0);
+  encode(MESSAGE_TYPE_CON, COAP_PUT, "upload", NULL, 1, 0, 1, 32);
+  encode(MESSAGE_TYPE_CON, COAP_PUT, "upload", NULL, 1, 1, 0, 32);
+
+  allocs = alloc_bytes = copies = copy_bytes = 0;
+  start = now();
+  for(n = 0; n < REQUESTS; n++) {
+    /* a new tid every time, the response cache is not hit */
+    receive(&requests[n % num_requests], n, 0);
+  }
+  start = now() - start;
+
+  /* the response must not overwrite the UDP header it is sent back to */
+  for(n = 0; n < num_requests; n++) {
+    receive(&requests[n], REQUESTS + n, EXT_LEN);
+  }
+
+  printf("%-10s %8s %10s %10s %10s %10s %12s\n", "coap", "ns/req",
+         "allocs", "bytes", "memcpys", "bytes", "responses");
+  printf("%-10s %8.1f %10.2f %10.1f %10.2f %10.1f %12lx\n",
+         COAP_ZERO_COPY ? "zero-copy" : "copy", start / REQUESTS,
+         (double)allocs / REQUESTS, (double)alloc_bytes / REQUESTS,
+         (double)copies / REQUESTS, (double)copy_bytes / REQUESTS,
+         response_sum);
+
+  if(exchanges()) {
+    return 1;
+  }
+
+  /* three of the exchanges are answered */
+  if(responses != REQUESTS + num_requests + 3 || misdirected ||
+     uploaded != (REQUESTS / num_requests + 1) * 2 * 32) {
+    printf("%lu responses, %lu misdirected, %lu bytes uploaded\n",
+           responses, misdirected, uploaded);
+    return 1;
+  }
+  return blocks() || dispatch();
+}
+/*---------------------------------------------------------------------------*/
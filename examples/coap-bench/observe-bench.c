@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of CoAP Observe on the native platform. Clients subscribe
+ *         to periodic resources through the coap_server process, and the
+ *         notifications it sends are checked against a simulated clock:
+ *         one rendering per change, one datagram per observer from the
+ *         notification port, expired observers of any resource making
+ *         room for new ones, no requests taken on the notification
+ *         port, and the retransmission of unacknowledged notifications.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "lib/random.h"
+
+#include "rest.h"
+#include "buffer.h"
+#include "coap-transactions.h"
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_APP_BUF  (&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
+
+/* the port the observers take requests and notifications on */
+#define CLIENT_PORT  MOTE_SERVER_LISTEN_PORT
+
+#define SENT_MAX 32
+
+struct datagram {
+  u16_t lport, rport;
+  uip_ipaddr_t addr;
+  uint8_t type, code;
+  uint16_t tid;
+  clock_time_t time;
+};
+static struct datagram sent[SENT_MAX];
+static int num_sent, failures;
+static clock_time_t bench_clock;
+/*---------------------------------------------------------------------------*/
+/* The parts of uIP the server uses. */
+uip_buf_t uip_aligned_buf;
+void *uip_appdata;
+u16_t uip_len, uip_slen;
+u8_t uip_ext_len, uip_flags;
+struct uip_udp_conn *uip_udp_conn;
+process_event_t tcpip_event = 0x90;
+static struct uip_udp_conn conns[2];
+static int num_conns;
+
+/* created by the server in this order */
+#define SERVER_CONN (&conns[0])
+#define NOTIFY_CONN (&conns[1])
+
+struct uip_udp_conn *
+udp_new(const uip_ipaddr_t *ripaddr, u16_t port, void *appstate)
+{
+  struct uip_udp_conn *c = &conns[num_conns++];
+  memset(c, 0, sizeof(*c));
+  return c;
+}
+
+void
+uip_process(u8_t flag)
+{
+  const u8_t *p = UIP_APP_BUF;
+  struct datagram *d;
+
+  if(num_sent == SENT_MAX) {
+    return;
+  }
+  d = &sent[num_sent++];
+  d->lport = uip_udp_conn->lport;
+  d->rport = uip_udp_conn->rport;
+  uip_ipaddr_copy(&d->addr, &uip_udp_conn->ripaddr);
+  d->type = (p[0] & COAP_HEADER_TYPE_MASK) >> COAP_HEADER_TYPE_POSITION;
+  d->code = p[1];
+  d->tid = (p[2] << 8) | p[3];
+  d->time = bench_clock;
+}
+
+void
+tcpip_ipv6_output(void)
+{
+}
+
+u16_t
+uip_htons(u16_t val)
+{
+  return UIP_HTONS(val);
+}
+
+u32_t
+uip_htonl(u32_t val)
+{
+  return UIP_HTONL(val);
+}
+
+clock_time_t
+clock_time(void)
+{
+  return bench_clock;
+}
+
+unsigned long
+clock_seconds(void)
+{
+  return bench_clock / CLOCK_SECOND;
+}
+
+unsigned short
+random_rand(void)
+{
+  return rand();
+}
+
+void
+set_global_address(void)
+{
+}
+
+void
+configure_routing(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* Two sensors, changed by the test rather than by their period. */
+static int renderings;
+
+PERIODIC_RESOURCE(temp, METHOD_GET, "temp", 0);
+void
+temp_handler(REQUEST *request, RESPONSE *response)
+{
+  rest_set_response_payload(response, (uint8_t *)"21", 2);
+}
+
+int
+temp_periodic_handler(resource_t *resource)
+{
+  return 1;
+}
+
+void
+temp_periodic_request_generator(REQUEST *request)
+{
+  renderings++;
+  rest_set_request_payload(request, (uint8_t *)"22", 2);
+}
+
+PERIODIC_RESOURCE(hum, METHOD_GET, "hum", 0);
+void
+hum_handler(REQUEST *request, RESPONSE *response)
+{
+  rest_set_response_payload(response, (uint8_t *)"40", 2);
+}
+
+int
+hum_periodic_handler(resource_t *resource)
+{
+  return 1;
+}
+
+void
+hum_periodic_request_generator(REQUEST *request)
+{
+  renderings++;
+  rest_set_request_payload(request, (uint8_t *)"41", 2);
+}
+/*---------------------------------------------------------------------------*/
+/* Let the processes run, then advance the clock by ticks. */
+static void
+advance(clock_time_t ticks)
+{
+  clock_time_t i;
+
+  while(process_run() > 0);
+  for(i = 0; i < ticks; i++) {
+    bench_clock++;
+    if(etimer_pending() && etimer_next_expiration_time() <= bench_clock) {
+      etimer_request_poll();
+    }
+    while(process_run() > 0);
+  }
+}
+
+static void
+client_addr(uip_ipaddr_t *addr, int client)
+{
+  uip_ip6addr(addr, 0xfe80, 0, 0, 0, 0, 0, 0, client);
+}
+
+/* A datagram from the client arrives on the connection. */
+static void
+deliver(struct uip_udp_conn *conn, int client, message_type type,
+        uint16_t tid, char *url, int lifetime)
+{
+  coap_packet_t *packet;
+  int len;
+
+  init_buffer(COAP_DATA_BUFF_SIZE);
+  packet = (coap_packet_t *)allocate_buffer(sizeof(coap_packet_t));
+  init_packet(packet);
+  packet->type = type;
+  packet->tid = tid;
+  if(url) {
+    coap_set_method(packet, COAP_GET);
+    coap_set_header_uri(packet, url);
+  }
+  if(lifetime >= 0) {
+    coap_set_header_subscription_lifetime(packet, lifetime);
+  }
+  len = serialize_packet(packet, UIP_APP_BUF);
+  delete_buffer();
+
+  uip_appdata = UIP_APP_BUF;
+  uip_len = len;
+  uip_ext_len = 0;
+  uip_flags = UIP_NEWDATA;
+  client_addr(&UIP_IP_BUF->srcipaddr, client);
+  UIP_UDP_BUF->srcport = UIP_HTONS(CLIENT_PORT);
+  uip_udp_conn = conn;
+
+  process_post_synch(&coap_server, tcpip_event, NULL);
+}
+
+/* The client subscribes, returns the code of the response or 0. */
+static int
+subscribe(periodic_resource_t *resource, int client, int lifetime)
+{
+  static uint16_t tid;
+
+  num_sent = 0;
+  deliver(SERVER_CONN, client, MESSAGE_TYPE_CON, ++tid,
+          (char *)resource->resource->url, lifetime);
+  return num_sent == 1 ? sent[0].code : 0;
+}
+
+/* Acknowledges the notifications sent so far, returns their number. */
+static int
+acknowledge(void)
+{
+  int i, n;
+
+  n = num_sent;
+  num_sent = 0;
+  for(i = 0; i < n; i++) {
+    deliver(NOTIFY_CONN, sent[i].addr.u8[15],
+            MESSAGE_TYPE_ACK, sent[i].tid, NULL, -1);
+  }
+  return n;
+}
+
+static void
+check(const char *scenario, int ok)
+{
+  if(!ok) {
+    printf("FAILED: %s\n", scenario);
+    failures++;
+  }
+}
+
+static void
+report(const char *scenario, int observers, int notifications, int rendered)
+{
+  printf("%-24s %9d %13d %9d\n", scenario, observers, notifications, rendered);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Six observers of one resource get one rendering of a change, sent to
+ * each of them from the notification port.
+ */
+static void
+bench_fan_out(void)
+{
+  uint8_t notified[8];
+  int i, client, notifications;
+
+  for(i = 1; i <= 6; i++) {
+    check("fan-out: subscribe", subscribe(&periodic_resource_temp, i, 60) == OK_200);
+  }
+  check("fan-out: observers", coap_count_observers(&periodic_resource_temp) == 6);
+
+  memset(notified, 0, sizeof(notified));
+  renderings = notifications = 0;
+  num_sent = 0;
+  resource_changed(&periodic_resource_temp);
+  for(i = 0; i < 8 * COAP_NOTIFY_INTERVAL; i++) {
+    advance(1);
+    for(client = 0; client < num_sent; client++) {
+      check("fan-out: from the notification port",
+            sent[client].lport == UIP_HTONS(MOTE_CLIENT_LISTEN_PORT) &&
+            sent[client].rport == UIP_HTONS(CLIENT_PORT) &&
+            sent[client].type == MESSAGE_TYPE_CON);
+      notified[sent[client].addr.u8[15] % 8]++;
+    }
+    notifications += acknowledge();
+  }
+  for(i = 1; i <= 6; i++) {
+    check("fan-out: each observer once", notified[i] == 1);
+  }
+  check("fan-out: one rendering", renderings == 1);
+  report("fan-out", 6, notifications, renderings);
+
+  for(i = 1; i <= 6; i++) {
+    subscribe(&periodic_resource_temp, i, 0);
+  }
+  check("fan-out: unsubscribed", coap_count_observers(&periodic_resource_temp) == 0);
+}
+
+/*
+ * Observers whose lifetime ran out make room in the shared pool for an
+ * observer of another resource.
+ */
+static void
+bench_expired(void)
+{
+  int i;
+
+  for(i = 1; i <= COAP_MAX_OBSERVERS; i++) {
+    check("expired: subscribe", subscribe(&periodic_resource_temp, i, 10) == OK_200);
+  }
+  check("expired: pool full",
+        subscribe(&periodic_resource_hum, COAP_MAX_OBSERVERS + 1, 60) == INTERNAL_SERVER_ERROR_500);
+  advance(11 * CLOCK_SECOND);
+  check("expired: room made",
+        subscribe(&periodic_resource_hum, COAP_MAX_OBSERVERS + 1, 60) == OK_200);
+  check("expired: observers", coap_count_observers(&periodic_resource_temp) == 0 &&
+        coap_count_observers(&periodic_resource_hum) == 1);
+  report("expired", COAP_MAX_OBSERVERS + 1, 0, 0);
+
+  subscribe(&periodic_resource_hum, COAP_MAX_OBSERVERS + 1, 0);
+}
+
+/*
+ * The notification port takes no requests, it has no remote address
+ * set and would answer from the wrong port.
+ */
+static void
+bench_notify_port(void)
+{
+  num_sent = 0;
+  deliver(NOTIFY_CONN, 1, MESSAGE_TYPE_CON, 1000, "temp", 60);
+  check("notification port: no response", num_sent == 0);
+  check("notification port: no observer", coap_count_observers(&periodic_resource_temp) == 0);
+  report("notification port", 0, 0, 0);
+}
+
+/*
+ * A notification is a confirmable message: an ACK ends it, a RST drops
+ * the observer, and without either it is retransmitted with a doubling
+ * timeout until the observer is dropped.
+ */
+static void
+bench_retransmit(void)
+{
+  clock_time_t gap;
+  int i, ok;
+
+  /* acknowledged */
+  subscribe(&periodic_resource_temp, 1, 600);
+  num_sent = 0;
+  resource_changed(&periodic_resource_temp);
+  advance(COAP_NOTIFY_INTERVAL + 1);
+  check("ACK: notified", num_sent == 1);
+  acknowledge();
+  advance(100 * CLOCK_SECOND);
+  check("ACK: not retransmitted", num_sent == 0);
+  check("ACK: observer kept", coap_count_observers(&periodic_resource_temp) == 1);
+  report("ACK", 1, 1, 1);
+  subscribe(&periodic_resource_temp, 1, 0);
+
+  /* rejected */
+  subscribe(&periodic_resource_temp, 2, 600);
+  num_sent = 0;
+  resource_changed(&periodic_resource_temp);
+  advance(COAP_NOTIFY_INTERVAL + 1);
+  check("RST: notified", num_sent == 1);
+  num_sent = 0;
+  deliver(NOTIFY_CONN, 2, MESSAGE_TYPE_RST, sent[0].tid, NULL, -1);
+  check("RST: observer dropped", coap_count_observers(&periodic_resource_temp) == 0);
+  advance(100 * CLOCK_SECOND);
+  check("RST: not retransmitted", num_sent == 0);
+  report("RST", 1, 1, 1);
+
+  /* unanswered */
+  subscribe(&periodic_resource_temp, 3, 600);
+  num_sent = 0;
+  resource_changed(&periodic_resource_temp);
+  advance(100 * CLOCK_SECOND);
+  check("no reply: retransmitted", num_sent == 1 + COAP_MAX_RETRANSMIT);
+  ok = num_sent > 1;
+  for(i = 1; i < num_sent; i++) {
+    ok = ok && sent[i].tid == sent[0].tid;
+    gap = sent[i].time - sent[i - 1].time;
+    ok = ok && gap >= COAP_RESPONSE_TIMEOUT << (i - 1) &&
+      gap <= COAP_RESPONSE_TIMEOUT * 3 / 2 << (i - 1);
+    if(i > 1) {
+      ok = ok && gap == 2 * (sent[i - 1].time - sent[i - 2].time);
+    }
+  }
+  check("no reply: doubling timeout", ok);
+  check("no reply: observer dropped", coap_count_observers(&periodic_resource_temp) == 0);
+  report("no reply", 1, num_sent, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  process_init();
+  process_start(&etimer_process, NULL);
+  rest_init();
+  rest_activate_periodic_resource(&periodic_resource_temp);
+  rest_activate_periodic_resource(&periodic_resource_hum);
+  advance(0);
+
+  printf("%-24s %9s %13s %9s\n", "observe", "observers", "notifications", "rendered");
+  bench_fan_out();
+  bench_expired();
+  bench_notify_port();
+  bench_retransmit();
+  return failures ? 1 : 0;
+}
+/*---------------------------------------------------------------------------*/
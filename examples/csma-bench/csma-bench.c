@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the per-neighbor queues of the CSMA layer on the
+ *         native platform. Unicast packets to four neighbors go through
+ *         csma_driver to a model of a radio duty cycling layer in which
+ *         every frame holds the air for a fixed time. The same traffic
+ *         is sent with all neighbors up and with one neighbor that never
+ *         acknowledges, and the program reports the latency of the
+ *         packets to the other neighbors, which must not stall behind
+ *         the dead one, and how often the dead neighbor is tried.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/mac/csma.h"
+
+#define NEIGHBORS 4
+#define DEAD      1                    /* the neighbor that goes away */
+#define PERIOD    (CLOCK_SECOND / 4)   /* packets to every neighbor */
+#define AIRTIME   (CLOCK_SECOND / 100) /* a frame and its acknowledgement */
+#define DURATION  (60 * CLOCK_SECOND)
+#define PACKETS   (NEIGHBORS * DURATION / PERIOD)
+
+static clock_time_t now;
+static int down;
+
+static clock_time_t queued_at[PACKETS];
+static clock_time_t latency[PACKETS];
+static int delivered, dropped, dead_dropped;
+static unsigned long transmissions[NEIGHBORS + 1];
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return now;
+}
+
+unsigned long
+clock_seconds(void)
+{
+  return now / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+/* The radio duty cycling layer: one frame on the air at a time, and
+   the dead neighbor never acknowledges. */
+static struct ctimer air_timer;
+static mac_callback_t air_sent;
+static void *air_ptr;
+static int air_status;
+
+static void
+air_done(void *ptr)
+{
+  mac_callback_t sent = air_sent;
+
+  air_sent = NULL;
+  mac_call_sent_callback(sent, air_ptr, air_status, 1);
+}
+
+static void
+rdc_send(mac_callback_t sent, void *ptr)
+{
+  int addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0];
+
+  if(air_sent != NULL) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 1);
+    return;
+  }
+  transmissions[addr]++;
+  air_sent = sent;
+  air_ptr = ptr;
+  air_status = addr == down ? MAC_TX_NOACK : MAC_TX_OK;
+  ctimer_set(&air_timer, AIRTIME, air_done, NULL);
+}
+
+static void
+rdc_input(void)
+{
+}
+
+static int
+rdc_on(void)
+{
+  return 1;
+}
+
+static int
+rdc_off(int keep_radio_on)
+{
+  return 1;
+}
+
+static unsigned short
+rdc_channel_check_interval(void)
+{
+  return 0;
+}
+
+const struct rdc_driver bench_rdc = {
+  "bench", NULL, rdc_send, rdc_input, rdc_on, rdc_off, rdc_channel_check_interval
+};
+
+static void
+net_input(void)
+{
+}
+
+const struct network_driver bench_net = { "bench", NULL, net_input };
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int num_tx)
+{
+  long id = (long)ptr;
+
+  if(id % NEIGHBORS + 1 == down) {
+    dead_dropped += status != MAC_TX_OK;
+  } else if(status == MAC_TX_OK) {
+    latency[delivered++] = now - queued_at[id];
+  } else {
+    dropped++;
+  }
+}
+
+static void
+send(long id)
+{
+  rimeaddr_t addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = id % NEIGHBORS + 1;
+  packetbuf_clear();
+  packetbuf_set_datalen(64);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+  queued_at[id] = now;
+  csma_driver.send(packet_sent, (void *)id);
+}
+
+static int
+compare(const void *a, const void *b)
+{
+  return *(const clock_time_t *)a - *(const clock_time_t *)b;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends every neighbor a packet every PERIOD, staggered, and lets the
+   queues drain. Returns the 99th percentile latency of the packets to
+   the neighbors that are up. */
+static clock_time_t
+run(const char *name, int dead)
+{
+  long id = 0;
+  int i;
+  clock_time_t p99;
+
+  down = dead;
+  delivered = dropped = dead_dropped = 0;
+  memset(transmissions, 0, sizeof(transmissions));
+
+  for(now = 0; now < DURATION + 30 * CLOCK_SECOND; now++) {
+    while(id < PACKETS && now >= id * PERIOD / NEIGHBORS) {
+      send(id++);
+    }
+    etimer_request_poll();
+    while(process_run() > 0);
+  }
+
+  qsort(latency, delivered, sizeof(latency[0]), compare);
+  p99 = latency[delivered * 99 / 100];
+  printf("%-10s %9d %8d %8lu %8lu %8lu %10lu %10d\n", name,
+         delivered, dropped,
+         (unsigned long)latency[delivered / 2] * 1000 / CLOCK_SECOND,
+         (unsigned long)p99 * 1000 / CLOCK_SECOND,
+         (unsigned long)latency[delivered - 1] * 1000 / CLOCK_SECOND,
+         dead ? transmissions[dead] : 0, dead ? dead_dropped : 0);
+  for(i = 0; i < PACKETS; i++) {
+    latency[i] = 0;
+  }
+  return p99;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  struct csma_neighbor_stats stats[NEIGHBORS];
+  clock_time_t up, one_down;
+  int i, n;
+
+  process_init();
+  process_start(&etimer_process, NULL);
+  ctimer_init();
+  queuebuf_init();
+  packetbuf_clear();
+  csma_driver.init();
+
+  printf("%-10s %9s %8s %8s %8s %8s %10s %10s\n", "csma",
+         "delivered", "dropped", "p50 ms", "p99 ms", "max ms",
+         "dead tx", "dead drops");
+  up = run("all up", 0);
+  one_down = run("one down", DEAD);
+
+  n = csma_neighbor_stats(stats, NEIGHBORS);
+  for(i = 0; i < n; i++) {
+    printf("neighbor %d: %d queued, %u sent, %u dropped\n",
+           stats[i].addr.u8[0], stats[i].queued, stats[i].sent, stats[i].dropped);
+  }
+
+  /* the neighbors that are up must not wait for the dead one */
+  if(one_down > 2 * up + AIRTIME) {
+    printf("p99 latency %lu with a dead neighbor, %lu without\n",
+           (unsigned long)one_down, (unsigned long)up);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
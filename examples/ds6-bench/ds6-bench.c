@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2004, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Check and benchmark of the IPv6 routing table on the native
+ *         platform. Routes of random, nested prefixes are added and
+ *         removed in rounds. Every uip_ds6_route_add() is compared
+ *         with the route that a linear scan picks (the route of the
+ *         same prefix and length, else the first free entry), and
+ *         after each round every lookup of uip_ds6_route_lookup() is
+ *         compared with a linear longest prefix match over the table.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/uip-ds6.h"
+#include "net/uip-nd6.h"
+#include "net/uip-packetqueue.h"
+
+#define ROUNDS  50
+#define LOOKUPS 1000
+
+/* The routes are drawn below a few /16 bases so that they nest. */
+#define BASES 4
+
+/* UIP_DS6_ROUTE_NB is a sum without parentheses */
+#define ROUTES (UIP_DS6_ROUTE_NB)
+
+extern uip_ds6_route_t uip_ds6_routing_table[];
+
+uip_lladdr_t uip_lladdr;
+
+static uip_ipaddr_t dests[LOOKUPS];
+static unsigned long adds, lookups, mismatches;
+static double add_ns, lookup_ns;
+
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_nd6_ns_output(uip_ipaddr_t *src, uip_ipaddr_t *dest, uip_ipaddr_t *tgt)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_nd6_rs_output(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetqueue_new(struct uip_packetqueue_handle *handle)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetqueue_free(struct uip_packetqueue_handle *handle)
+{
+}
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_addr(uip_ipaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < 16; i++) {
+    addr->u8[i] = rand();
+  }
+  addr->u8[0] = 0x20;
+  addr->u8[1] = rand() % BASES;
+}
+/*---------------------------------------------------------------------------*/
+/* An address below an existing route, or a random one. */
+static void
+random_dest(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *route;
+  uip_ipaddr_t suffix;
+  int i;
+
+  route = &uip_ds6_routing_table[rand() % ROUTES];
+  random_addr(addr);
+  if(route->isused && rand() % 4) {
+    suffix = *addr;
+    *addr = route->ipaddr;
+    for(i = route->length; i < 128; i++) {
+      addr->u8[i >> 3] &= ~(0x80 >> (i & 7));
+      addr->u8[i >> 3] |= suffix.u8[i >> 3] & (0x80 >> (i & 7));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Mostly lengths that are not a multiple of 8, and a few default routes. */
+static uint8_t
+random_length(void)
+{
+  return rand() % 16 == 0 ? 0 : 16 + rand() % 113;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+linear_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *route, *found = NULL;
+
+  for(route = uip_ds6_routing_table;
+      route < uip_ds6_routing_table + ROUTES; route++) {
+    if(route->isused && uip_ipaddr_prefixcmp(addr, &route->ipaddr,
+                                             route->length) &&
+       (found == NULL || route->length > found->length)) {
+      found = route;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+linear_add(uip_ipaddr_t *prefix, uint8_t length)
+{
+  uip_ds6_route_t *route;
+
+  for(route = uip_ds6_routing_table;
+      route < uip_ds6_routing_table + ROUTES; route++) {
+    if(route->isused && route->length == length &&
+       uip_ipaddr_prefixcmp(prefix, &route->ipaddr, length)) {
+      return route;
+    }
+  }
+  for(route = uip_ds6_routing_table;
+      route < uip_ds6_routing_table + ROUTES; route++) {
+    if(!route->isused) {
+      return route;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add(uip_ipaddr_t *prefix, uint8_t length, uip_ipaddr_t *nexthop)
+{
+  uip_ds6_route_t *route, *expected;
+  double start;
+
+  expected = linear_add(prefix, length);
+  start = now();
+  route = uip_ds6_route_add(prefix, length, nexthop, 0);
+  add_ns += now() - start;
+  adds++;
+  if(route != expected && mismatches++ < 5) {
+    printf("add /%d: entry %d instead of %d\n", length,
+           route != NULL ? (int)(route - uip_ds6_routing_table) : -1,
+           expected != NULL ? (int)(expected - uip_ds6_routing_table) : -1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(void)
+{
+  uip_ds6_route_t *route, *expected;
+  double start;
+  int i;
+
+  for(i = 0; i < LOOKUPS; i++) {
+    random_dest(&dests[i]);
+  }
+
+  start = now();
+  for(i = 0; i < LOOKUPS; i++) {
+    route = uip_ds6_route_lookup(&dests[i]);
+    /* keep the compiler from dropping the lookups */
+    __asm__ volatile("" : : "r"(route));
+  }
+  lookup_ns += now() - start;
+  lookups += LOOKUPS;
+
+  for(i = 0; i < LOOKUPS; i++) {
+    route = uip_ds6_route_lookup(&dests[i]);
+    expected = linear_lookup(&dests[i]);
+    if(route == expected ||
+       (route != NULL && expected != NULL &&
+        route->length == expected->length &&
+        uip_ipaddr_prefixcmp(&dests[i], &route->ipaddr, route->length))) {
+      continue;
+    }
+    if(mismatches++ < 5) {
+      printf("lookup %d: /%d instead of /%d\n", i,
+             route != NULL ? route->length : -1,
+             expected != NULL ? expected->length : -1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  uip_ds6_route_t *route;
+  uip_ipaddr_t prefix, nexthop;
+  unsigned long table;
+  int round, i, j, used;
+
+  srand(1);
+  memset(&nexthop, 0, sizeof(nexthop));
+
+  for(round = 0; round < ROUNDS; round++) {
+    /* fill up the table */
+    for(i = 0; i < ROUTES; i++) {
+      random_addr(&prefix);
+      nexthop.u8[15] = rand() % 8;
+      add(&prefix, random_length(), &nexthop);
+    }
+    check();
+
+    /* release a third of the routes, in each of the ways routes go */
+    for(i = 0; i < ROUTES / 3; i++) {
+      route = &uip_ds6_routing_table[rand() % ROUTES];
+      if(!route->isused) {
+        continue;
+      }
+      switch(rand() % 32) {
+      case 0:
+        uip_ds6_route_rm_by_nexthop(&route->nexthop);
+        break;
+      case 1:
+        route->isused = 0;
+        break;
+      default:
+        uip_ds6_route_rm(route);
+        break;
+      }
+    }
+    check();
+  }
+
+  /* the table in a line, to compare the builds */
+  used = 0;
+  table = 0;
+  for(i = 0; i < ROUTES; i++) {
+    route = &uip_ds6_routing_table[i];
+    if(route->isused) {
+      used++;
+      table = table * 31 + i;
+      table = table * 31 + route->length;
+      for(j = 0; j < 16; j++) {
+        table = table * 31 + route->ipaddr.u8[j];
+      }
+    }
+  }
+  printf("%-8s %6d %6d %10.1f %10.1f %10lu %08lx\n",
+         UIP_DS6_ROUTE_HASH ? "hash" : "list", ROUTES, used,
+         add_ns / adds, lookup_ns / lookups, mismatches, table);
+  return mismatches != 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2004, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the event timers on the native platform. A
+ *         process keeps a number of timers pending and sets each one
+ *         again with a random interval when it expires, while the
+ *         clock advances one tick at a time. Every fourth expiration
+ *         also stops and restarts another timer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+
+#define TICKS 20000
+
+static struct etimer timers[4096];
+static int num_timers;
+static clock_time_t ticks;
+static unsigned long expirations, late, early, restarts;
+static double restart_ns;
+
+PROCESS(bench_process, "Timer benchmark");
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return ticks;
+}
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+interval(void)
+{
+  /* one expiration per tick on average */
+  return 1 + rand() % (2 * num_timers);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer unset;
+  static double start;
+  struct etimer *t;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < num_timers; i++) {
+    etimer_set(&timers[i], interval());
+  }
+
+  /* A timer that was never set, as in a struct from memb_alloc(), has
+     garbage in its fields. */
+  memset(&unset, 0xa5, sizeof(unset));
+  etimer_stop(&unset);
+  memset(&unset, 0xa5, sizeof(unset));
+  etimer_set(&unset, interval());
+  etimer_stop(&unset);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    t = data;
+    if(!etimer_expired(t)) {
+      /* set again after the event was posted */
+      continue;
+    }
+    if(ticks < etimer_expiration_time(t)) {
+      early++;
+    } else if(ticks > etimer_expiration_time(t)) {
+      late++;
+    }
+    expirations++;
+    etimer_set(t, interval());
+
+    if(expirations % 4 == 0) {
+      t = &timers[rand() % num_timers];
+      start = now();
+      etimer_stop(t);
+      etimer_set(t, interval());
+      restart_ns += now() - start;
+      restarts++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  static const int sizes[] = {16, 64, 256, 1024, 4096};
+  double start;
+  unsigned i;
+  int j;
+
+  process_init();
+  process_start(&etimer_process, NULL);
+
+  printf("%-8s %6s %12s %12s %8s\n", "etimer", "timers", "ns/expiry",
+         "ns/restart", "late");
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    num_timers = sizes[i];
+    expirations = late = early = restarts = 0;
+    restart_ns = 0;
+    srand(1);
+    process_start(&bench_process, NULL);
+
+    start = now();
+    for(j = 0; j < TICKS; j++) {
+      ticks++;
+      etimer_request_poll();
+      while(process_run() > 0);
+    }
+    printf("%-8s %6d %12.1f %12.1f %8lu\n", ETIMER_CONF_HEAP ? "heap" : "list",
+           num_timers, (now() - start) / expirations, restart_ns / restarts,
+           late);
+
+    process_exit(&bench_process);
+    while(process_run() > 0);
+    if(early > 0 || etimer_pending()) {
+      printf("%lu timers expired early, %d still pending\n", early,
+             etimer_pending());
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,712 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Load generator for the web server on the native platform.
+ *         Simulated browsers fetch a page and its assets from the
+ *         httpd.c of apps/webserver. Requests and responses go
+ *         through httpd_appcall() as if uIP had delivered them, over a
+ *         model of a multi-hop 6LoWPAN link: the air time of every
+ *         segment is shared, a connection has one segment in flight
+ *         as with uIP, and a handshake costs a round trip. The program
+ *         reports requests/s and latency percentiles in simulated time
+ *         at several numbers of browsers, with a pool of four
+ *         connection states.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki-net.h"
+#include "httpd.h"
+#include "webserver.h"
+#include "httpd-cgi.h"
+
+#define RTT      0.120   /* s, round trip over three hops */
+#define BITRATE  80000.0 /* bit/s that forwarding leaves of 250 kbit/s */
+#define OVERHEAD 40      /* bytes of compressed headers per segment */
+#define MSS      192
+#define POLL     0.5     /* s, the uIP periodic timer */
+#define RETRY    1.0     /* s before a refused connection is retried */
+#define THINK    3.0     /* s, mean time between the pages of a browser */
+#define PAGES    20
+
+#define MAX_CONNS    512
+#define MAX_REQUESTS 8192
+
+static const char *assets[] = { "/index.html", "/style.css", "/favicon.ico" };
+
+/* Events up to EV_RST are about a connection, the others about a
+   browser or a request. */
+enum {
+  EV_CONNECT, EV_DATA, EV_ACKED, EV_CLOSED, EV_POLLED,
+  EV_RECV, EV_FIN, EV_RST, EV_POLL, EV_PAGE, EV_REISSUE
+};
+
+struct event {
+  double time;
+  unsigned long seq;
+  int type;
+  int id;
+  unsigned gen;
+  int len;
+  char *data;
+};
+
+struct conn {
+  int used;
+  unsigned gen;        /* events of an earlier use are dropped */
+  int browser;
+  struct uip_conn u;
+  int server_open;     /* httpd still gets events */
+  int closing;         /* the server sent its FIN */
+  int client_open;     /* the browser may send on it */
+  int inflight;        /* a server segment waits for its ACK */
+  int persistent;      /* the last response said keep-alive */
+  int refused;         /* reset when it connected */
+  int status;
+  int queue[4], head, count;
+  char hdr[512];
+  int hdrlen;
+  long body;           /* left of the body, -1 to the FIN */
+  int inbody;
+};
+
+struct request {
+  int browser;
+  int asset;
+  double issued;
+};
+
+struct browser {
+  int conn;
+  int pages;
+  int outstanding;
+  int done;
+};
+
+static struct event *heap;
+static int heap_len, heap_size;
+static unsigned long seq;
+static double now, medium;
+
+static struct conn conns[MAX_CONNS];
+static struct request requests[MAX_REQUESTS];
+static int num_requests;
+static struct browser *browsers;
+static int num_browsers, browsers_done;
+
+static double latencies[MAX_REQUESTS];
+static int completed, opened, refused, resets, retried, errors;
+static double last_done, cpu;
+/*---------------------------------------------------------------------------*/
+/* The parts of uIP and Contiki the server uses. */
+uip_buf_t uip_aligned_buf;
+void *uip_appdata, *uip_sappdata;
+u16_t uip_len, uip_slen;
+u8_t uip_flags;
+struct uip_conn *uip_conn;
+
+void
+uip_send(const void *data, int len)
+{
+  if(len > 0) {
+    uip_slen = len;
+    if(data != uip_sappdata) {
+      memcpy(uip_sappdata, data, len);
+    }
+  }
+}
+
+u16_t
+uip_htons(u16_t val)
+{
+  return UIP_HTONS(val);
+}
+
+void
+tcp_attach(struct uip_conn *conn, void *appstate)
+{
+  conn->appstate.p = NULL;
+  conn->appstate.state = appstate;
+}
+
+void
+tcp_listen(u16_t port)
+{
+}
+
+static void schedule(double time, int type, int id, const char *data, int len);
+
+void
+tcpip_poll_tcp(struct uip_conn *conn)
+{
+  schedule(now, EV_POLLED, (int)((struct conn *)((char *)conn -
+		offsetof(struct conn, u)) - conns), NULL, 0);
+}
+
+clock_time_t
+clock_time(void)
+{
+  return (clock_time_t)(now * CLOCK_SECOND);
+}
+
+void
+webserver_log(char *msg)
+{
+}
+
+void
+webserver_log_file(uip_ipaddr_t *requester, char *file)
+{
+}
+
+static
+PT_THREAD(nullfunction(struct httpd_state *s, char *ptr))
+{
+  PSOCK_BEGIN(&s->sout);
+  PSOCK_END(&s->sout);
+}
+
+httpd_cgifunction
+httpd_cgi(char *name)
+{
+  return nullfunction;
+}
+
+void
+httpd_cgi_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule(double time, int type, int id, const char *data, int len)
+{
+  struct event e, t;
+  int i, p;
+
+  if(heap_len == heap_size) {
+    heap_size = heap_size ? heap_size * 2 : 256;
+    heap = realloc(heap, heap_size * sizeof(struct event));
+  }
+  e.time = time;
+  e.seq = seq++;
+  e.type = type;
+  e.id = id;
+  e.gen = type <= EV_RST ? conns[id].gen : 0;
+  e.len = len;
+  e.data = NULL;
+  if(len > 0) {
+    e.data = malloc(len);
+    memcpy(e.data, data, len);
+  }
+  i = heap_len++;
+  heap[i] = e;
+  while(i > 0) {
+    p = (i - 1) / 2;
+    if(heap[p].time < heap[i].time ||
+       (heap[p].time == heap[i].time && heap[p].seq < heap[i].seq)) {
+      break;
+    }
+    t = heap[p]; heap[p] = heap[i]; heap[i] = t;
+    i = p;
+  }
+}
+
+static int
+earlier(int a, int b)
+{
+  return heap[a].time < heap[b].time ||
+    (heap[a].time == heap[b].time && heap[a].seq < heap[b].seq);
+}
+
+static struct event
+next_event(void)
+{
+  struct event e, t;
+  int i, c;
+
+  e = heap[0];
+  heap[0] = heap[--heap_len];
+  i = 0;
+  while((c = 2 * i + 1) < heap_len) {
+    if(c + 1 < heap_len && earlier(c + 1, c)) {
+      c++;
+    }
+    if(!earlier(c, i)) {
+      break;
+    }
+    t = heap[c]; heap[c] = heap[i]; heap[i] = t;
+    i = c;
+  }
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns when a segment sent at the given time arrives. Segments sent
+   now queue for the shared medium, later ones of the same exchange
+   only add their air time. */
+static double
+transmit(double at, int len)
+{
+  double air;
+
+  air = (len + OVERHEAD) * 8 / BITRATE;
+  if(at > now) {
+    return at + air + RTT / 2;
+  }
+  medium = (now > medium ? now : medium) + air;
+  return medium + RTT / 2;
+}
+
+static int
+new_conn(int browser)
+{
+  unsigned gen;
+  int i;
+
+  for(i = 0; i < MAX_CONNS; i++) {
+    if(!conns[i].used) {
+      gen = conns[i].gen + 1;
+      memset(&conns[i], 0, sizeof(conns[i]));
+      conns[i].gen = gen;
+      conns[i].used = 1;
+      conns[i].browser = browser;
+      conns[i].client_open = 1;
+      conns[i].u.mss = conns[i].u.initialmss = MSS;
+      conns[i].u.lport = UIP_HTONS(80);
+      conns[i].u.tcpstateflags = UIP_ESTABLISHED;
+      opened++;
+      return i;
+    }
+  }
+  fprintf(stderr, "out of connections\n");
+  exit(1);
+}
+
+static void
+release(struct conn *c)
+{
+  if(!c->server_open && !c->client_open) {
+    c->used = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+server_call(int id, u8_t flags, const char *data, int len)
+{
+  struct conn *c = &conns[id];
+  struct timespec t0, t1;
+  double arrival;
+
+  uip_conn = &c->u;
+  uip_flags = flags;
+  uip_appdata = uip_sappdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
+  memcpy(uip_appdata, data, len);
+  uip_len = len;
+  uip_slen = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  httpd_appcall(c->u.appstate.state);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  cpu += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  if(flags & UIP_CLOSE) {
+    /* the state is gone, whatever the application did */
+    c->server_open = 0;
+    release(c);
+  } else if(uip_flags == UIP_ABORT) {
+    c->server_open = 0;
+    c->refused = (flags & UIP_CONNECTED) != 0;
+    schedule(transmit(now, 0), EV_RST, id, NULL, 0);
+  } else if(uip_flags == UIP_CLOSE) {
+    /* uIP drops data sent along with the close */
+    c->closing = 1;
+    arrival = transmit(now, 0);
+    schedule(arrival, EV_FIN, id, NULL, 0);
+    schedule(transmit(arrival, 0), EV_CLOSED, id, NULL, 0);
+  } else if(uip_slen > 0) {
+    if(c->inflight || uip_slen > MSS) {
+      errors++;
+    }
+    c->inflight = 1;
+    arrival = transmit(now, uip_slen);
+    schedule(arrival, EV_RECV, id, uip_sappdata, uip_slen);
+    schedule(transmit(arrival, 0), EV_ACKED, id, NULL, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+takes_gzip(int browser)
+{
+  return browser % 2 == 0;
+}
+
+static void
+send_request(int id, int r)
+{
+  struct conn *c = &conns[id];
+  char buf[160];
+  double t;
+  int len;
+
+  /* The User-Agent line fills the 49 byte input buffer of the server
+     up to its CR LF, which must neither be taken for the end of the
+     headers nor hide the Accept-Encoding line after it. Every other
+     browser refuses gzip with a q-value of 0. */
+  len = sprintf(buf, "GET %s HTTP/1.1\r\nHost: [aaaa::1]\r\n"
+		"User-Agent: httpd-bench/1.0 (a simulated browser)\r\n"
+		"Accept-Encoding: %s\r\n\r\n", assets[requests[r].asset],
+		takes_gzip(requests[r].browser) ? "gzip, deflate" : "gzip;q=0, deflate");
+  c->queue[(c->head + c->count++) % 4] = r;
+  if(!c->server_open && !c->closing) {
+    /* SYN, SYN-ACK and the ACK that carries the request */
+    t = transmit(now, 0);
+    t = transmit(t, 0);
+    schedule(transmit(t, len), EV_CONNECT, id, buf, len);
+  } else {
+    schedule(transmit(now, len), EV_DATA, id, buf, len);
+  }
+}
+
+static void
+dispatch(int r)
+{
+  int b = requests[r].browser;
+  struct browser *br = &browsers[b];
+  struct conn *c;
+  int id;
+
+  /* pipeline on a connection known to persist, else open one */
+  c = br->conn >= 0 ? &conns[br->conn] : NULL;
+  if(c != NULL && c->client_open && !c->closing && c->persistent && c->count < 4) {
+    send_request(br->conn, r);
+    return;
+  }
+  id = new_conn(b);
+  if(c == NULL || !c->client_open || c->closing) {
+    br->conn = id;
+  }
+  send_request(id, r);
+}
+
+static void
+issue(int b, int asset)
+{
+  int r;
+
+  if(num_requests == MAX_REQUESTS) {
+    fprintf(stderr, "out of requests\n");
+    exit(1);
+  }
+  r = num_requests++;
+  requests[r].browser = b;
+  requests[r].asset = asset;
+  requests[r].issued = now;
+  browsers[b].outstanding++;
+  dispatch(r);
+}
+
+static void
+page_done(int b)
+{
+  struct browser *br = &browsers[b];
+  struct conn *c;
+
+  if(++br->pages < PAGES) {
+    schedule(now + THINK * (0.5 + (double)rand() / RAND_MAX), EV_PAGE, b, NULL, 0);
+    return;
+  }
+  br->done = 1;
+  browsers_done++;
+  if(br->conn >= 0) {
+    c = &conns[br->conn];
+    if(c->client_open && !c->closing) {
+      /* FIN from the browser */
+      c->client_open = 0;
+      schedule(transmit(now, 0), EV_CLOSED, br->conn, NULL, 0);
+    }
+  }
+}
+
+static void
+complete(struct conn *c, int status)
+{
+  struct request *rq;
+  struct browser *br;
+  int r;
+
+  if(c->count == 0) {
+    errors++;
+    return;
+  }
+  r = c->queue[c->head];
+  c->head = (c->head + 1) % 4;
+  c->count--;
+  rq = &requests[r];
+  br = &browsers[rq->browser];
+  if(status != (rq->asset == 2 ? 404 : 200)) {
+    errors++;
+  }
+  latencies[completed++] = now - rq->issued;
+  last_done = now;
+  if(--br->outstanding == 0) {
+    if(rq->asset == 0) {
+      issue(rq->browser, 1);
+      issue(rq->browser, 2);
+    } else {
+      page_done(rq->browser);
+    }
+  }
+}
+
+static void
+receive(struct conn *c, const char *data, int len)
+{
+  char *p;
+  int n;
+
+  while(len > 0) {
+    if(!c->inbody) {
+      if(c->hdrlen == sizeof(c->hdr) - 1) {
+	errors++;
+	return;
+      }
+      c->hdr[c->hdrlen++] = *data++;
+      len--;
+      c->hdr[c->hdrlen] = 0;
+      if(c->hdrlen < 4 || strcmp(&c->hdr[c->hdrlen - 4], "\r\n\r\n") != 0) {
+	continue;
+      }
+      c->status = atoi(c->hdr + 9);
+      c->persistent = strstr(c->hdr, "Connection: keep-alive") != NULL;
+      /* every asset has a gzip variant, sent when the request takes it */
+      if(c->count > 0 &&
+	 (strstr(c->hdr, "Content-Encoding: gzip") != NULL) !=
+	 takes_gzip(requests[c->queue[c->head]].browser)) {
+	errors++;
+      }
+      if(strstr(c->hdr, "Vary: Accept-Encoding") == NULL) {
+	errors++;
+      }
+      p = strstr(c->hdr, "Content-Length: ");
+      c->body = p != NULL ? atol(p + 16) : -1;
+      c->hdrlen = 0;
+      c->inbody = 1;
+    } else {
+      n = len;
+      if(c->body >= 0 && n > c->body) {
+	n = c->body;
+      }
+      if(c->body >= 0) {
+	c->body -= n;
+      }
+      data += n;
+      len -= n;
+    }
+    if(c->inbody && c->body == 0) {
+      c->inbody = 0;
+      complete(c, c->status);
+    }
+  }
+}
+
+/* The server closed or reset the connection. Requests left without a
+   response go out again, after a while if the connection was refused. */
+static void
+lost(int id, int reset)
+{
+  struct conn *c = &conns[id];
+  struct browser *br = &browsers[c->browser];
+  int r;
+
+  c->client_open = 0;
+  if(c->inbody && c->body < 0) {
+    /* the FIN ends a response without a length */
+    c->inbody = 0;
+    complete(c, c->status);
+  }
+  if(br->conn == id) {
+    br->conn = -1;
+  }
+  if(c->refused) {
+    refused++;
+  } else if(reset) {
+    resets++;
+  }
+  while(c->count > 0) {
+    r = c->queue[c->head];
+    c->head = (c->head + 1) % 4;
+    c->count--;
+    if(c->refused) {
+      schedule(now + RETRY, EV_REISSUE, r, NULL, 0);
+    } else {
+      retried++;
+      dispatch(r);
+    }
+  }
+  release(c);
+}
+/*---------------------------------------------------------------------------*/
+static int
+run(int n)
+{
+  struct event e;
+  struct conn *c;
+  int i, active;
+
+  srand(1);
+  memset(conns, 0, sizeof(conns));
+  num_requests = completed = opened = refused = resets = retried = errors = 0;
+  now = medium = last_done = cpu = 0;
+  heap_len = 0;
+  browsers = calloc(n, sizeof(struct browser));
+  num_browsers = n;
+  browsers_done = 0;
+  httpd_init();
+
+  for(i = 0; i < n; i++) {
+    browsers[i].conn = -1;
+    schedule(THINK * i / n, EV_PAGE, i, NULL, 0);
+  }
+  schedule(POLL, EV_POLL, 0, NULL, 0);
+
+  while(heap_len > 0) {
+    e = next_event();
+    now = e.time;
+    if(e.type <= EV_RST && e.gen != conns[e.id].gen) {
+      free(e.data);
+      continue;
+    }
+    c = &conns[e.id];
+    switch(e.type) {
+    case EV_PAGE:
+      issue(e.id, 0);
+      break;
+    case EV_REISSUE:
+      dispatch(e.id);
+      break;
+    case EV_CONNECT:
+      c->server_open = 1;
+      server_call(e.id, UIP_CONNECTED | UIP_NEWDATA, e.data, e.len);
+      break;
+    case EV_DATA:
+      if(c->server_open && !c->closing) {
+	server_call(e.id, UIP_NEWDATA, e.data, e.len);
+      }
+      break;
+    case EV_ACKED:
+      c->inflight = 0;
+      if(c->server_open && !c->closing) {
+	server_call(e.id, UIP_ACKDATA, NULL, 0);
+      }
+      break;
+    case EV_CLOSED:
+      if(c->server_open) {
+	server_call(e.id, UIP_CLOSE, NULL, 0);
+      }
+      break;
+    case EV_POLLED:
+      if(c->server_open && !c->closing && !c->inflight) {
+	server_call(e.id, UIP_POLL, NULL, 0);
+      }
+      break;
+    case EV_POLL:
+      active = 0;
+      for(i = 0; i < MAX_CONNS; i++) {
+	if(conns[i].used && conns[i].server_open && !conns[i].closing) {
+	  active++;
+	  if(!conns[i].inflight) {
+	    server_call(i, UIP_POLL, NULL, 0);
+	  }
+	}
+      }
+      if(active > 0 || browsers_done < n) {
+	schedule(now + POLL, EV_POLL, 0, NULL, 0);
+      }
+      break;
+    case EV_RECV:
+      if(c->client_open) {
+	receive(c, e.data, e.len);
+      }
+      break;
+    case EV_FIN:
+      lost(e.id, 0);
+      break;
+    case EV_RST:
+      lost(e.id, 1);
+      break;
+    }
+    free(e.data);
+  }
+  free(browsers);
+  return completed == n * PAGES * 3 ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+int
+main(void)
+{
+  static const int levels[] = { 1, 2, 4, 8, 16, 32 };
+  int i, fail;
+
+  printf("%-10s %8s %8s %8s %8s %8s %9s %8s %8s %8s %8s\n", "httpd",
+	 "browsers", "requests", "req/s", "p50 ms", "p99 ms", "conns/req",
+	 "refused", "resets", "retried", "us/req");
+  fail = 0;
+  for(i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    if(run(levels[i]) < 0 || errors > 0) {
+      printf("%d browsers: %d of %d requests, %d errors\n",
+	     levels[i], completed, levels[i] * PAGES * 3, errors);
+      fail = 1;
+      continue;
+    }
+    qsort(latencies, completed, sizeof(double), compare);
+    printf("%-10s %8d %8d %8.2f %8.0f %8.0f %9.2f %8d %8d %8d %8.1f\n",
+	   HTTPD_KEEPALIVE ? "keepalive" : "close", levels[i], completed,
+	   completed / last_done, latencies[completed / 2] * 1000,
+	   latencies[completed * 99 / 100] * 1000,
+	   (double)opened / completed, refused, resets, retried,
+	   cpu / completed * 1e6);
+  }
+  return fail;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2004, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Microbenchmark of memb_alloc() and memb_free() on the native
+ *         platform. The pool is kept full while a random block is
+ *         released and allocated again, which is the worst case of the
+ *         reference count scan and the common case of packet pools.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/memb.h"
+
+#define ITERATIONS 1000000
+
+struct block {
+  unsigned char data[32];
+};
+
+MEMB(pool4, struct block, 4);
+MEMB(pool8, struct block, 8);
+MEMB(pool16, struct block, 16);
+MEMB(pool32, struct block, 32);
+MEMB(pool64, struct block, 64);
+MEMB(pool128, struct block, 128);
+MEMB(pool254, struct block, 254);
+MEMB(pool512, struct block, 512);
+MEMB(pool1024, struct block, 1024);
+
+static struct memb *pools[] = {&pool4, &pool8, &pool16, &pool32, &pool64,
+                               &pool128, &pool254, &pool512, &pool1024};
+
+static void *held[1024];
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run(struct memb *m)
+{
+  double start;
+  long i;
+  int j;
+
+  memb_init(m);
+  for(j = 0; j < m->num; j++) {
+    held[j] = memb_alloc(m);
+    if(held[j] == NULL || !memb_inmemb(m, held[j])) {
+      printf("pool of %d: allocation %d failed\n", m->num, j);
+      return -1;
+    }
+  }
+  if(memb_alloc(m) != NULL || memb_free(m, (char *)held[0] + 1) != -1) {
+    printf("pool of %d: full pool or bad pointer accepted\n", m->num);
+    return -1;
+  }
+
+  /* Callers such as collect-neighbor.c still read a block after
+     releasing it, so memb_free() must leave it as it was. */
+  for(j = 0; j < m->num; j++) {
+    memset(held[j], j, sizeof(struct block));
+  }
+  for(j = 0; j < m->num; j += 2) {
+    memb_free(m, held[j]);
+  }
+  for(j = 0; j < m->num; j++) {
+    if(((unsigned char *)held[j])[0] != (unsigned char)j ||
+       ((unsigned char *)held[j])[sizeof(struct block) - 1] !=
+       (unsigned char)j) {
+      printf("pool of %d: block %d changed by memb_free()\n", m->num, j);
+      return -1;
+    }
+  }
+  for(j = 0; j < m->num; j += 2) {
+    if((held[j] = memb_alloc(m)) == NULL) {
+      printf("pool of %d: reallocation %d failed\n", m->num, j);
+      return -1;
+    }
+  }
+
+  srand(1);
+  start = now();
+  for(i = 0; i < ITERATIONS; i++) {
+    j = rand() % m->num;
+    if(memb_free(m, held[j]) != 0 || (held[j] = memb_alloc(m)) == NULL) {
+      printf("pool of %d: iteration %ld failed\n", m->num, i);
+      return -1;
+    }
+  }
+  printf("%-10s %6d %12.1f\n", MEMB_FREE_LIST ? "free-list" : "scan", m->num,
+         (now() - start) / ITERATIONS);
+
+  for(j = 0; j < m->num; j++) {
+    if(memb_free(m, held[j]) != 0 || memb_free(m, held[j]) != 0) {
+      printf("pool of %d: release %d failed\n", m->num, j);
+      return -1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  unsigned i;
+
+  printf("%-10s %6s %12s\n", "memb", "blocks", "ns/free+alloc");
+  for(i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    if(run(pools[i]) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,126 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+
+#include "bench-arch.h"
+#include "dispatcher.h"
+#include "keytools.h"
+#include "mib-init.h"
+#include "snmpd-conf.h"
+#include "utils.h"
+#include "logging.h"
+
+unsigned long bench_allocs;
+unsigned long bench_alloc_bytes;
+
+/* the agent is linked with --wrap=malloc and --wrap=realloc */
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    bench_allocs++;
+    bench_alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    bench_allocs++;
+    bench_alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+/* the clock does not advance, so that replayed v3 requests stay in the time window */
+clock_time_t clock_time(void)
+{
+    return 100000;
+}
+
+unsigned long clock_seconds(void)
+{
+    return 1000;
+}
+
+s8t bench_init()
+{
+    static u8t initialized = 0;
+    if (!initialized) {
+#if ENABLE_SNMPv3
+        TRY(usm_users_init());
+#endif
+        TRY(mib_init());
+        initialized = 1;
+    }
+    return 0;
+}
+
+s8t bench_dispatch(const u8t* request, const u16t req_len, u8t** response, u16t* resp_len)
+{
+    static u8t buf[BENCH_BUFSIZE];
+#if ENABLE_ZERO_COPY
+    /* the request at the end of the buffer, the response is encoded in front of it */
+    u16t max_len;
+    if (req_len > BENCH_BUFSIZE) {
+        return FAILURE;
+    }
+    max_len = BENCH_BUFSIZE - req_len;
+    memcpy(buf + max_len, request, req_len);
+    if (max_len > MAX_BUF_SIZE) {
+        max_len = MAX_BUF_SIZE;
+    }
+    *response = buf;
+    return dispatch(buf + BENCH_BUFSIZE - req_len, req_len, buf, resp_len, max_len);
+#else
+    static u8t output[MAX_BUF_SIZE];
+    if (req_len > BENCH_BUFSIZE) {
+        return FAILURE;
+    }
+    memcpy(buf, request, req_len);
+    *response = output;
+    return dispatch(buf, req_len, output, resp_len, MAX_BUF_SIZE);
+#endif
+}
+
+u16t bench_hex_decode(char* line)
+{
+    u16t i, len = 0;
+    u8t c, value = 0, digits = 0;
+    for (i = 0; line[i]; i++) {
+        c = line[i];
+        if (c >= '0' && c <= '9') {
+            c -= '0';
+        } else if (c >= 'a' && c <= 'f') {
+            c -= 'a' - 10;
+        } else if (c >= 'A' && c <= 'F') {
+            c -= 'A' - 10;
+        } else {
+            continue;
+        }
+        value = (value << 4) | c;
+        if (++digits == 2) {
+            line[len++] = value;
+            digits = 0;
+        }
+    }
+    return len;
+}
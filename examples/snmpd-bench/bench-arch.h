@@ -0,0 +1,63 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         Host glue of the benchmark and the fuzz target: the agent state,
+ *         the packet buffer layout of udp_handler() and the allocation counters.
+ */
+
+#ifndef __BENCH_ARCH_H__
+#define __BENCH_ARCH_H__
+
+#include "snmpd-types.h"
+
+/** \brief size of the emulated uIP packet buffer available to the application. */
+#define BENCH_BUFSIZE   1280
+
+/** \brief number of calls to malloc() and realloc() made by the agent. */
+extern unsigned long bench_allocs;
+
+/** \brief number of bytes requested from malloc() and realloc() by the agent. */
+extern unsigned long bench_alloc_bytes;
+
+/**
+ * \brief Initializes the usmUserTable and the MIB once.
+ * \return 0 - if the processing has successfully finished, otherwise - non-zero value.
+ */
+s8t bench_init();
+
+/**
+ * \brief Hands a request to dispatch() the way udp_handler() does. The request is copied
+ *        because the agent decrypts and authenticates it in place.
+ * \param request      the request.
+ * \param req_len      length of the request.
+ * \param response     set to the response, valid until the next call.
+ * \param resp_len     length of the response.
+ * \return the return value of dispatch().
+ */
+s8t bench_dispatch(const u8t* request, const u16t req_len, u8t** response, u16t* resp_len);
+
+/**
+ * \brief Decodes a line of hex digits in place.
+ * \return number of decoded bytes.
+ */
+u16t bench_hex_decode(char* line);
+
+#endif /* __BENCH_ARCH_H__ */
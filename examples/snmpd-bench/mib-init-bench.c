@@ -0,0 +1,188 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         Synthetic MIB of the benchmark: the system group, BENCH_SCALARS scalars
+ *         under 1.3.6.1.4.1.99999.1 and a table of BENCH_ROWS rows and
+ *         BENCH_COLUMNS columns under 1.3.6.1.4.1.99999.2.1.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mib-init.h"
+#include "ber.h"
+#include "utils.h"
+#include "logging.h"
+
+#ifndef BENCH_SCALARS
+#define BENCH_SCALARS   2000
+#endif
+
+#ifndef BENCH_ROWS
+#define BENCH_ROWS      1000
+#endif
+
+#define BENCH_COLUMNS   3
+
+/* 1.3.6.1.4.1.99999 */
+#define BENCH_PREFIX    0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f
+
+/** \brief prefix, subidentifier of the scalar (up to 3 bytes) and the instance .0 */
+#define BENCH_SCALAR_OID_LEN    13
+
+static u8t ber_oid_system_desc[]    = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x01, 0x00};
+static ptr_t oid_system_desc        = {ber_oid_system_desc, 8};
+static u8t ber_oid_system_time[]    = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00};
+static ptr_t oid_system_time        = {ber_oid_system_time, 8};
+
+static u8t ber_oid_bench_table[]    = {BENCH_PREFIX, 0x02, 0x01};
+static ptr_t oid_bench_table        = {ber_oid_bench_table, 10};
+
+static u8t scalar_oids[BENCH_SCALARS][BENCH_SCALAR_OID_LEN];
+static ptr_t scalar_oid_ptrs[BENCH_SCALARS];
+
+s8t getSysDescr(mib_object_t* object, u8t* oid, u8t len)
+{
+    if (!object->varbind.value.p_value.len) {
+        object->varbind.value.p_value.ptr = (u8t*)"Contiki SNMP benchmark";
+        object->varbind.value.p_value.len = 22;
+    }
+    return 0;
+}
+
+s8t getTimeTicks(mib_object_t* object, u8t* oid, u8t len)
+{
+    object->varbind.value.u_value = 1234;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Column 1 is the row index, column 2 a counter and column 3 a string.
+ */
+s8t getBenchEntry(mib_object_t* object, u8t* oid, u8t len)
+{
+    u32t column, row;
+    u8t i;
+    i = ber_decode_oid_item(oid, len, &column);
+    if (i >= len || i + ber_decode_oid_item(oid + i, len - i, &row) != len) {
+        return -1;
+    }
+    if (row < 1 || row > BENCH_ROWS) {
+        return -1;
+    }
+    switch (column) {
+        case 1:
+            object->varbind.value_type = BER_TYPE_INTEGER;
+            object->varbind.value.i_value = row;
+            break;
+        case 2:
+            object->varbind.value_type = BER_TYPE_COUNTER;
+            object->varbind.value.u_value = row * 1000;
+            break;
+        case 3:
+            object->varbind.value_type = BER_TYPE_OCTET_STRING;
+            object->varbind.value.p_value.ptr = (u8t*)"benchmark row";
+            object->varbind.value.p_value.len = 13;
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+#if ENABLE_MIB_TABLE_CURSOR
+static mib_table_cursor_t bench_table_cursor;
+#endif
+
+ptr_t* getNextBenchEntryOid(mib_object_t* object, u8t* oid, u8t len)
+{
+    u32t column = 0, row = 0;
+    u8t i = 0;
+
+    /* a walk continues from the row returned last */
+    if (!mib_table_resume(object, &column, &row)) {
+        if (len) {
+            i = ber_decode_oid_item(oid, len, &column);
+        }
+        if (i < len) {
+            ber_decode_oid_item(oid + i, len - i, &row);
+        }
+    }
+    if (column < 1) {
+        column = 1;
+        row = 0;
+    }
+    if (row >= BENCH_ROWS) {
+        column++;
+        row = 0;
+    }
+    if (column > BENCH_COLUMNS) {
+        return 0;
+    }
+    return mib_table_instance(object, column, row + 1);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Initialize the MIB.
+ */
+s8t mib_init()
+{
+    static const u8t prefix[] = {BENCH_PREFIX, 0x01};
+    u32t value;
+    u16t i;
+
+    if (add_scalar(&oid_system_desc, 0, BER_TYPE_OCTET_STRING, 0, &getSysDescr, 0) == -1 ||
+        add_scalar(&oid_system_time, 0, BER_TYPE_TIME_TICKS, 0, &getTimeTicks, 0) == -1) {
+        return -1;
+    }
+
+    /* 1.3.6.1.4.1.99999.1.<i>.0, alternately integers, counters and strings */
+    for (i = 0; i < BENCH_SCALARS; i++) {
+        memcpy(scalar_oids[i], prefix, sizeof(prefix));
+        ber_encode_oid_item(i + 1, scalar_oids[i] + sizeof(prefix));
+        scalar_oid_ptrs[i].ptr = scalar_oids[i];
+        scalar_oid_ptrs[i].len = sizeof(prefix) + ber_encoded_oid_item_length(i + 1) + 1;
+        scalar_oids[i][scalar_oid_ptrs[i].len - 1] = 0;
+        value = i;
+        switch (i % 3) {
+            case 0:
+                TRY(add_scalar(&scalar_oid_ptrs[i], 0, BER_TYPE_INTEGER, &value, 0, 0));
+                break;
+            case 1:
+                TRY(add_scalar(&scalar_oid_ptrs[i], 0, BER_TYPE_COUNTER, &value, 0, 0));
+                break;
+            default:
+                TRY(add_scalar(&scalar_oid_ptrs[i], 0, BER_TYPE_OCTET_STRING, "benchmark scalar", 0, 0));
+                break;
+        }
+    }
+
+#if ENABLE_MIB_TABLE_CURSOR
+    if (add_table_cursor(&oid_bench_table, &getBenchEntry, &getNextBenchEntryOid, 0, &bench_table_cursor) == -1) {
+#else
+    if (add_table(&oid_bench_table, &getBenchEntry, &getNextBenchEntryOid, 0) == -1) {
+#endif
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,376 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         Runs the notification originator on the host against a simulated clock
+ *         and checks the PDUs it sends: coalescing, the token bucket, a failed
+ *         encoding and the retransmission of InformRequests.
+ *
+ *         usage: notify-bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snmpd-conf.h"
+
+/* the originator is off by default, the benchmark builds it in */
+#undef ENABLE_NOTIFICATIONS
+#define ENABLE_NOTIFICATIONS 1
+#include "notification-originator.c"
+
+/** \brief maximum number of datagrams recorded between two checks. */
+#define BENCH_SENT_MAX  32
+
+/* two notifications, each with variable bindings under its own prefix */
+static u8t ber_oid_link_down[]  = {0x2b, 0x06, 0x01, 0x06, 0x03, 0x01, 0x01, 0x05, 0x03};
+static ptr_t oid_link_down      = {ber_oid_link_down, 9};
+static u8t ber_oid_link_up[]    = {0x2b, 0x06, 0x01, 0x06, 0x03, 0x01, 0x01, 0x05, 0x04};
+static ptr_t oid_link_up        = {ber_oid_link_up, 9};
+static u8t ber_oid_if_index[]   = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x01, 0x01};
+static ptr_t oid_if_index       = {ber_oid_if_index, 10};
+static u8t ber_oid_if_descr[]   = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x02, 0x01};
+static ptr_t oid_if_descr       = {ber_oid_if_descr, 10};
+static ptr_t oid_if_entry       = {ber_oid_if_index, 8};
+static u8t ber_oid_long[NOTIFICATION_OID_LENGTH] = {0x2b, 0x06, 0x01, 0x04, 0x01};
+static ptr_t oid_long           = {ber_oid_long, NOTIFICATION_OID_LENGTH};
+
+typedef struct {
+    u8t data[MAX_BUF_SIZE];
+    u16t len;
+    u16t port;
+} bench_datagram_t;
+
+static bench_datagram_t sent[BENCH_SENT_MAX];
+static u8t sent_num;
+static u8t failures;
+
+/*-----------------------------------------------------------------------------------*/
+/* The parts of Contiki and uIP the originator uses. */
+uip_buf_t uip_aligned_buf;
+void* uip_appdata;
+u16_t uip_len;
+u8_t uip_flags;
+process_event_t tcpip_event = 0x90;
+static struct uip_udp_conn udp_conn;
+static clock_time_t bench_clock;
+
+struct uip_udp_conn* udp_new(const uip_ipaddr_t* ripaddr, u16_t port, void* appstate)
+{
+    memset(&udp_conn, 0, sizeof(udp_conn));
+    return &udp_conn;
+}
+
+void uip_udp_packet_sendto(struct uip_udp_conn* c, const void* data, int len, const uip_ipaddr_t* toaddr, u16_t toport)
+{
+    if (sent_num < BENCH_SENT_MAX) {
+        memcpy(sent[sent_num].data, data, len);
+        sent[sent_num].len = len;
+        sent[sent_num].port = UIP_HTONS(toport);
+        sent_num++;
+    }
+}
+
+u16_t uip_htons(u16_t val)
+{
+    return UIP_HTONS(val);
+}
+
+clock_time_t clock_time(void)
+{
+    return bench_clock;
+}
+
+unsigned long clock_seconds(void)
+{
+    return bench_clock / CLOCK_SECOND;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Let the processes run, then advance the clock by ms milliseconds.
+ */
+static void advance(u32t ms)
+{
+    u32t i;
+    while (process_run() > 0);
+    for (i = 0; i < ms; i++) {
+        bench_clock++;
+        if (etimer_pending() && etimer_next_expiration_time() <= bench_clock) {
+            etimer_request_poll();
+        }
+        while (process_run() > 0);
+    }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Decode a datagram: the PDU type, the request id, the snmpTrapOID and the number of
+ * variable bindings after it, which have to start with prefix.
+ * Returns 0 if the datagram is not a well formed SNMPv2c notification.
+ */
+static u8t decode(bench_datagram_t* d, u8t* pdu_type, s32t* id, ptr_t* trap_oid, u8t* varbinds_num, const ptr_t* prefix)
+{
+    u16t pos = 0, length;
+    s32t version, value;
+    u8t type, *community;
+    u16t community_len;
+    ptr_t oid;
+
+    if (ber_decode_sequence(d->data, d->len, &pos) != ERR_NO_ERROR ||
+            ber_decode_integer(d->data, d->len, &pos, &version) != ERR_NO_ERROR || version != SNMP_VERSION_2C ||
+            ber_decode_string(d->data, d->len, &pos, &community, &community_len) != ERR_NO_ERROR ||
+            ber_decode_type_length(d->data, d->len, &pos, pdu_type, &length) != ERR_NO_ERROR ||
+            ber_decode_integer(d->data, d->len, &pos, id) != ERR_NO_ERROR ||
+            ber_decode_integer(d->data, d->len, &pos, &value) != ERR_NO_ERROR || value != 0 ||
+            ber_decode_integer(d->data, d->len, &pos, &value) != ERR_NO_ERROR ||
+            ber_decode_sequence(d->data, d->len, &pos) != ERR_NO_ERROR) {
+        return 0;
+    }
+    *varbinds_num = 0;
+    while (pos < d->len) {
+        if (ber_decode_sequence_length(d->data, d->len, &pos, &length) != ERR_NO_ERROR ||
+                ber_decode_oid(d->data, d->len, &pos, &oid) != ERR_NO_ERROR) {
+            return 0;
+        }
+        if (oid.len == oid_snmp_trap_oid.len && !memcmp(oid.ptr, oid_snmp_trap_oid.ptr, oid.len)) {
+            if (ber_decode_oid(d->data, d->len, &pos, trap_oid) != ERR_NO_ERROR) {
+                return 0;
+            }
+            continue;
+        }
+        /* ber_decode_value() only knows the types of requests, skip the value */
+        if (ber_decode_type_length(d->data, d->len, &pos, &type, &length) != ERR_NO_ERROR || pos + length > d->len) {
+            return 0;
+        }
+        pos += length;
+        if (!(oid.len == oid_sys_up_time.len && !memcmp(oid.ptr, oid_sys_up_time.ptr, oid.len))) {
+            if (oid.len < prefix->len || memcmp(oid.ptr, prefix->ptr, prefix->len)) {
+                return 0;
+            }
+            (*varbinds_num)++;
+        }
+    }
+    return 1;
+}
+
+static void check(const char* scenario, u8t ok)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", scenario);
+        failures++;
+    }
+}
+
+static void report(const char* scenario, u8t raised, u8t pdus, u8t varbinds, u32t dropped, u8t retransmitted)
+{
+    printf("%-24s %8d %6d %9d %8d %14d\n", scenario, raised, pdus, varbinds, (int)dropped, retransmitted);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Notifications of the same snmpTrapOID share a PDU, a different one closes it.
+ */
+static void bench_coalesce()
+{
+    const ptr_t* trap[] = {&oid_link_down, &oid_link_down, &oid_link_down, &oid_link_up, &oid_link_down};
+    varbind_t varbinds[2];
+    ptr_t trap_oid;
+    u8t i, pdu_type, num, total = 0;
+    s32t id;
+
+    varbinds[0].oid_ptr = &oid_if_index;
+    varbinds[0].value_type = BER_TYPE_INTEGER;
+    varbinds[0].value.i_value = 1;
+    varbinds[1].oid_ptr = &oid_if_descr;
+    varbinds[1].value_type = BER_TYPE_OCTET_STRING;
+    varbinds[1].value.p_value.ptr = (u8t*)"eth0";
+    varbinds[1].value.p_value.len = 4;
+
+    sent_num = 0;
+    for (i = 0; i < 5; i++) {
+        check("coalesce: raise", snmp_notify(trap[i], varbinds, 2) == 0);
+        advance(10);
+    }
+    advance(NOTIFICATION_BATCH_WINDOW);
+
+    /* linkDown x3, linkUp, linkDown */
+    check("coalesce: three PDUs", sent_num == 3);
+    for (i = 0; i < sent_num; i++) {
+        check("coalesce: decode", decode(&sent[i], &pdu_type, &id, &trap_oid, &num, &oid_if_entry));
+        check("coalesce: snmpTrapOID", trap_oid.len == trap[i ? i + 2 : 0]->len &&
+                !memcmp(trap_oid.ptr, trap[i ? i + 2 : 0]->ptr, trap_oid.len));
+        check("coalesce: variable bindings", num == (i ? 2 : 6));
+        total += num;
+    }
+    report("coalesce", 5, sent_num, total, notificationsDropped, 0);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * One notification every 100 ms for 10 s against the token bucket.
+ */
+static void bench_rate_limit()
+{
+    varbind_t varbind;
+    u32t dropped = notificationsDropped;
+    u8t i, expected;
+
+    varbind.oid_ptr = &oid_if_index;
+    varbind.value_type = BER_TYPE_INTEGER;
+    varbind.value.i_value = 1;
+
+    /* a full bucket */
+    advance(NOTIFICATION_BURST * NOTIFICATION_TOKEN_INTERVAL);
+    sent_num = 0;
+    for (i = 0; i < 100; i++) {
+        /* alternate the notifications, so that every one is a PDU of its own */
+        snmp_notify(i & 1 ? &oid_link_up : &oid_link_down, &varbind, 1);
+        advance(100);
+    }
+    advance(NOTIFICATION_BATCH_WINDOW);
+
+    expected = NOTIFICATION_BURST + (100 * 100 + NOTIFICATION_BATCH_WINDOW) / NOTIFICATION_TOKEN_INTERVAL;
+    check("rate limit: PDUs sent", sent_num <= expected && sent_num >= expected - 1);
+    check("rate limit: PDUs dropped", sent_num + notificationsDropped - dropped == 100);
+    report("rate limit", 100, sent_num, sent_num, notificationsDropped - dropped, 0);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * A PDU that does not fit into MAX_BUF_SIZE leaves the bucket untouched.
+ */
+static void bench_encode_failure()
+{
+    static u8t value[NOTIFICATION_VALUE_LENGTH];
+    varbind_t varbind;
+    u32t dropped = notificationsDropped;
+    u8t i;
+
+    /* a full bucket once it is refilled */
+    advance(NOTIFICATION_BURST * NOTIFICATION_TOKEN_INTERVAL);
+
+    varbind.oid_ptr = &oid_long;
+    varbind.value_type = BER_TYPE_OCTET_STRING;
+    varbind.value.p_value.ptr = value;
+    varbind.value.p_value.len = sizeof(value);
+
+    /* snmp_notify() keeps NOTIFICATION_BATCH_LEN below MAX_BUF_SIZE, fill the PDU directly */
+    sent_num = 0;
+    memset(&batches[0], 0, sizeof(batch_t));
+    memcpy(batches[0].trap_oid_buf, oid_link_down.ptr, oid_link_down.len);
+    batches[0].trap_oid.ptr = batches[0].trap_oid_buf;
+    batches[0].trap_oid.len = oid_link_down.len;
+    for (i = 0; i < NOTIFICATION_BATCH_MAX; i++) {
+        batch_varbind_copy(&batches[0].varbinds[i], &varbind);
+        batches[0].varbinds[i].item.next_ptr = i + 1 < NOTIFICATION_BATCH_MAX ? &batches[0].varbinds[i + 1].item : 0;
+    }
+    batches[0].varbinds_num = NOTIFICATION_BATCH_MAX;
+    batches[0].state = BATCH_CLOSED;
+    batch_send(&batches[0]);
+
+    check("encode failure: nothing sent", sent_num == 0);
+    check("encode failure: dropped", notificationsDropped - dropped == 1);
+    check("encode failure: token kept", targets[0].tokens == NOTIFICATION_BURST);
+    report("encode failure", 1, sent_num, 0, notificationsDropped - dropped, 0);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * An unacknowledged InformRequest is retransmitted NOTIFICATION_INFORM_RETRIES times,
+ * an acknowledged one is released.
+ */
+static void bench_inform()
+{
+    static u8t response[MAX_BUF_SIZE];
+    uip_ipaddr_t addr;
+    varbind_t varbind;
+    ptr_t trap_oid;
+    u8t i, pdu_type, num, retransmitted, *community;
+    s32t id;
+    u16t pos, length;
+
+    uip_ipaddr(&addr, 10, 0, 0, 2);
+    targets_num = 0;
+    check("inform: target", notification_target_add(&addr, NOTIFICATION_PORT, BER_TYPE_SNMP_INFORM, SNMP_VERSION_2C, 0, 0) == 0);
+
+    varbind.oid_ptr = &oid_if_index;
+    varbind.value_type = BER_TYPE_INTEGER;
+    varbind.value.i_value = 1;
+
+    /* no response */
+    sent_num = 0;
+    snmp_notify(&oid_link_down, &varbind, 1);
+    advance(NOTIFICATION_BATCH_WINDOW + NOTIFICATION_INFORM_TIMEOUT * 16);
+    retransmitted = sent_num - 1;
+    check("inform: retransmissions", retransmitted == NOTIFICATION_INFORM_RETRIES);
+    for (i = 0; i < sent_num; i++) {
+        check("inform: decode", decode(&sent[i], &pdu_type, &id, &trap_oid, &num, &oid_if_index) &&
+                pdu_type == BER_TYPE_SNMP_INFORM && num == 1);
+    }
+    check("inform: timed out", informsTimedOut == 1 && !informs[0].target && !informs[1].target);
+    report("inform, no response", 1, 1, 1, 0, retransmitted);
+
+    /* the response of the receiver arrives before the timeout */
+    sent_num = 0;
+    snmp_notify(&oid_link_down, &varbind, 1);
+    advance(NOTIFICATION_BATCH_WINDOW);
+    check("inform: sent", sent_num == 1);
+    memcpy(response, sent[0].data, sent[0].len);
+    pos = 0;
+    ber_decode_sequence(response, sent[0].len, &pos);
+    ber_decode_integer(response, sent[0].len, &pos, &id);
+    ber_decode_string(response, sent[0].len, &pos, &community, &length);
+    response[pos] = BER_TYPE_SNMP_RESPONSE;
+    uip_appdata = response;
+    uip_len = sent[0].len;
+    uip_flags = UIP_NEWDATA;
+    uip_ipaddr_copy(&UDP_IP_BUF->srcipaddr, &addr);
+    process_post_synch(&notification_process, tcpip_event, NULL);
+    advance(NOTIFICATION_INFORM_TIMEOUT * 16);
+    retransmitted = sent_num - 1;
+    check("inform: released", retransmitted == 0 && informsTimedOut == 1 && !informs[0].target && !informs[1].target);
+    report("inform, response", 1, 1, 1, 0, retransmitted);
+}
+
+/*-----------------------------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+    uip_ipaddr_t addr;
+
+    process_init();
+    process_start(&etimer_process, NULL);
+    process_start(&notification_process, NULL);
+    advance(0);
+
+    uip_ipaddr(&addr, 10, 0, 0, 1);
+    if (notification_target_add(&addr, NOTIFICATION_PORT, BER_TYPE_SNMP_TRAP, SNMP_VERSION_2C, 0, 0) != 0) {
+        printf("cannot add a notification destination\n");
+        return 1;
+    }
+
+    printf("%-24s %8s %6s %9s %8s %14s\n", "scenario", "raised", "pdus", "varbinds", "dropped", "retransmitted");
+    bench_coalesce();
+    bench_rate_limit();
+    bench_encode_failure();
+    bench_inform();
+    return failures ? 1 : 0;
+}
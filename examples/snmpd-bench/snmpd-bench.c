@@ -0,0 +1,295 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         Replays request corpora through dispatch() on the host and reports
+ *         requests/s, allocations per request and the peak stack depth.
+ *
+ *         usage: snmpd-bench [-n iterations] corpus...
+ *
+ *         A corpus file holds one request per line as hex digits,
+ *         lines starting with # are ignored.
+ *
+ *         Then the table of the synthetic MIB is walked with GetNext requests,
+ *         each for the oid of the previous response, and the steps/s and
+ *         allocations per step of the walk are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "bench-arch.h"
+#include "ber.h"
+
+/** \brief maximum number of requests in a corpus. */
+#define BENCH_REQUESTS      1024
+
+/** \brief number of words of the painted stack the first pass runs on to find the peak stack depth. */
+#define STACK_PAINT_WORDS   16384
+
+#define STACK_PATTERN       0xAAAAAAAA
+
+typedef struct {
+    u8t data[BENCH_BUFSIZE];
+    u16t len;
+} bench_request_t;
+
+static bench_request_t requests[BENCH_REQUESTS];
+
+/** \brief stack of the pass that measures the stack depth, painted before it runs. */
+static u32t replay_stack[STACK_PAINT_WORDS] __attribute__((aligned(16)));
+
+/** \brief the table of the synthetic MIB, 1.3.6.1.4.1.99999.2.1 */
+static const u8t walk_table[] = {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01};
+
+static ucontext_t main_context, replay_context;
+static u16t replay_num, replay_dropped;
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Load a corpus, returns the number of requests.
+ */
+static u16t load_corpus(const char* file)
+{
+    static char line[2 * BENCH_BUFSIZE + 2];
+    u16t num = 0;
+    FILE* f = fopen(file, "r");
+    if (!f) {
+        perror(file);
+        exit(1);
+    }
+    while (num < BENCH_REQUESTS && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        requests[num].len = bench_hex_decode(line);
+        if (requests[num].len) {
+            memcpy(requests[num].data, line, requests[num].len);
+            num++;
+        }
+    }
+    fclose(f);
+    return num;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Replay every request once, returns the number of requests without a response.
+ */
+static u16t __attribute__((noinline)) replay(const u16t num)
+{
+    u16t i, dropped = 0, resp_len;
+    u8t* response;
+    for (i = 0; i < num; i++) {
+        if (bench_dispatch(requests[i].data, requests[i].len, &response, &resp_len) != ERR_NO_ERROR) {
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Runs the first pass on the painted stack.
+ */
+static void replay_on_stack()
+{
+    replay_dropped = replay(replay_num);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Replay every request once on a painted stack of its own, the same way the snmpd
+ * process checks its stack with CHECK_STACK_SIZE. Returns the number of bytes of the
+ * stack overwritten, the stack grows down from the end of the array.
+ */
+static u32t stack_replay(const u16t num, u16t* dropped)
+{
+    u32t i;
+    for (i = 0; i < STACK_PAINT_WORDS; i++) {
+        replay_stack[i] = STACK_PATTERN;
+    }
+
+    getcontext(&replay_context);
+    replay_context.uc_stack.ss_sp = replay_stack;
+    replay_context.uc_stack.ss_size = sizeof(replay_stack);
+    replay_context.uc_link = &main_context;
+    makecontext(&replay_context, replay_on_stack, 0);
+    replay_num = num;
+    swapcontext(&main_context, &replay_context);
+    *dropped = replay_dropped;
+
+    for (i = 0; i < STACK_PAINT_WORDS && replay_stack[i] == STACK_PATTERN; i++);
+    return (STACK_PAINT_WORDS - i) * sizeof(u32t);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Returns the content of the TLV at ptr and its length, ptr is set past the TLV.
+ */
+static u8t* tlv_content(u8t** ptr, u16t* len)
+{
+    u8t* p = *ptr + 1;
+    if (*p == 0x81) {
+        *len = p[1];
+        p += 2;
+    } else if (*p == 0x82) {
+        *len = (p[1] << 8) | p[2];
+        p += 3;
+    } else {
+        *len = *p++;
+    }
+    *ptr = p + *len;
+    return p;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Writes a SNMPv2c GetNext request for the oid, the oid is short enough for single
+ * byte lengths. Returns the length of the request.
+ */
+static u16t walk_request(u8t* buf, const u8t* oid, const u8t oid_len)
+{
+    static const u8t header[] = {0x02, 0x01, 0x01, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c'};
+    static const u8t ids[] = {0x02, 0x01, 0x00, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00};
+    u8t* p = buf;
+
+    *p++ = 0x30;
+    *p++ = sizeof(header) + 2 + sizeof(ids) + 4 + 2 + oid_len + 2;
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+    *p++ = BER_TYPE_SNMP_GETNEXT;
+    *p++ = sizeof(ids) + 4 + 2 + oid_len + 2;
+    memcpy(p, ids, sizeof(ids));
+    p += sizeof(ids);
+    *p++ = 0x30;
+    *p++ = 2 + 2 + oid_len + 2;
+    *p++ = 0x30;
+    *p++ = 2 + oid_len + 2;
+    *p++ = BER_TYPE_OID;
+    *p++ = oid_len;
+    memcpy(p, oid, oid_len);
+    p += oid_len;
+    *p++ = BER_TYPE_NULL;
+    *p++ = 0;
+    return p - buf;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Walks the table of the synthetic MIB, returns the number of steps.
+ */
+static u32t walk()
+{
+    u8t request[64], oid[32], oid_len = sizeof(walk_table);
+    u8t *response, *p, *value;
+    u16t req_len, resp_len, len;
+    u32t steps = 0;
+
+    memcpy(oid, walk_table, oid_len);
+    for (;;) {
+        req_len = walk_request(request, oid, oid_len);
+        if (bench_dispatch(request, req_len, &response, &resp_len) != ERR_NO_ERROR) {
+            break;
+        }
+        /* message, version, community, pdu, 3 integers, varbind list, varbind, oid */
+        p = response;
+        p = tlv_content(&p, &len);
+        tlv_content(&p, &len);
+        tlv_content(&p, &len);
+        p = tlv_content(&p, &len);
+        tlv_content(&p, &len);
+        tlv_content(&p, &len);
+        tlv_content(&p, &len);
+        p = tlv_content(&p, &len);
+        p = tlv_content(&p, &len);
+        value = tlv_content(&p, &len);
+        if (*p == BER_TYPE_END_OF_MIB || len > sizeof(oid) || len <= sizeof(walk_table) ||
+                memcmp(value, walk_table, sizeof(walk_table))) {
+            break;
+        }
+        memcpy(oid, value, len);
+        oid_len = len;
+        steps++;
+    }
+    return steps;
+}
+
+int main(int argc, char** argv)
+{
+    u32t iterations = 1000, it, stack, steps;
+    u16t num, dropped;
+    struct timespec start, end;
+    double seconds;
+    int i = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "-n")) {
+        iterations = atol(argv[2]);
+        i = 3;
+    }
+    if (i >= argc || !iterations) {
+        fprintf(stderr, "usage: %s [-n iterations] corpus...\n", argv[0]);
+        return 1;
+    }
+    if (bench_init() != ERR_NO_ERROR) {
+        fprintf(stderr, "can not initialize the agent\n");
+        return 1;
+    }
+
+    printf("%-24s %8s %8s %12s %10s %10s %8s\n", "corpus", "requests", "dropped", "requests/s", "bytes/req", "allocs/req", "stack");
+    for (; i < argc; i++) {
+        if (!(num = load_corpus(argv[i]))) {
+            continue;
+        }
+
+        /* the first pass measures the stack, nothing else may run in between */
+        stack = stack_replay(num, &dropped);
+
+        bench_allocs = bench_alloc_bytes = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (it = 0; it < iterations; it++) {
+            replay(num);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        printf("%-24s %8u %8u %12.0f %10.1f %10.2f %8lu\n", argv[i], num, dropped,
+                (double)num * iterations / seconds,
+                (double)bench_alloc_bytes / num / iterations,
+                (double)bench_allocs / num / iterations, (unsigned long)stack);
+    }
+
+    bench_allocs = bench_alloc_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    steps = walk();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (!steps) {
+        fprintf(stderr, "can not walk the table\n");
+        return 1;
+    }
+    printf("\n%-24s %8s %12s %10s %10s\n", "walk", "steps", "steps/s", "bytes/step", "allocs/step");
+    printf("%-24s %8lu %12.0f %10.1f %10.2f\n", "table", (unsigned long)steps, steps / seconds,
+            (double)bench_alloc_bytes / steps, (double)bench_allocs / steps);
+    return 0;
+}
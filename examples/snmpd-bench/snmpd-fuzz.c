@@ -0,0 +1,84 @@
+/* -----------------------------------------------------------------------------
+ * SNMP implementation for Contiki
+ *
+ * This program is part of free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/**
+ * \file
+ *         libFuzzer entry point on dispatch(). Without LIBFUZZER the target is
+ *         linked with a driver that runs the corpus files given on the command line,
+ *         so that crashes can be reproduced with any compiler.
+ *
+ *         usage: snmpd-fuzz corpus...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench-arch.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    u16t resp_len;
+    u8t* response;
+    if (bench_init() != ERR_NO_ERROR) {
+        abort();
+    }
+    if (size <= BENCH_BUFSIZE) {
+        bench_dispatch(data, size, &response, &resp_len);
+    }
+    return 0;
+}
+
+#if !LIBFUZZER
+/*-----------------------------------------------------------------------------------*/
+/*
+ * Runs every line of a hex corpus, or a binary file as a single input.
+ */
+int main(int argc, char** argv)
+{
+    static char line[2 * BENCH_BUFSIZE + 2];
+    u32t inputs = 0;
+    u16t len;
+    int i;
+    FILE* f;
+
+    for (i = 1; i < argc; i++) {
+        if (!(f = fopen(argv[i], "r"))) {
+            perror(argv[i]);
+            return 1;
+        }
+        if (strstr(argv[i], ".txt")) {
+            while (fgets(line, sizeof(line), f)) {
+                if (line[0] != '#' && (len = bench_hex_decode(line))) {
+                    LLVMFuzzerTestOneInput((uint8_t*)line, len);
+                    inputs++;
+                }
+            }
+        } else {
+            len = fread(line, 1, sizeof(line), f);
+            LLVMFuzzerTestOneInput((uint8_t*)line, len);
+            inputs++;
+        }
+        fclose(f);
+    }
+    printf("%lu inputs\n", (unsigned long)inputs);
+    return 0;
+}
+#endif
@@ -80,6 +80,22 @@ typedef unsigned long clock_time_t;
 #define CLOCK_CONF_SECOND 1000
 #define INFINITE_TIME ULONG_MAX
 
+/* Keep the many pending timers of a router in a heap */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 1
+#endif /* ETIMER_CONF_HEAP */
+
+/* Serve network events ahead of the rest and drain the queue in batches */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+#ifndef PROCESS_CONF_BATCH
+#define PROCESS_CONF_BATCH 4
+#endif /* PROCESS_CONF_BATCH */
+#ifndef PROCESS_CONF_STATS
+#define PROCESS_CONF_STATS 1
+#endif /* PROCESS_CONF_STATS */
+
 #define LOG_CONF_ENABLED 1
 
 /* Not part of C99 but actually present */